@@ -0,0 +1,114 @@
+/*
+ *  This file is part of RawTherapee.
+ *
+ *  RawTherapee is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  RawTherapee is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Microbenchmark of gaussianBlur
+//
+// usage: gaussbench [width height [iterations [generic|avx2|avx512]]]
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "../rtengine/cpufeatures.h"
+#include "../rtengine/gauss.h"
+#include "../rtengine/mytime.h"
+
+namespace
+{
+
+std::vector<float*> makeRows (std::vector<float>& data, int width, int height)
+{
+    std::vector<float*> rows(height);
+
+    for (int i = 0; i < height; i++) {
+        rows[i] = data.data() + static_cast<std::size_t>(i) * width;
+    }
+
+    return rows;
+}
+
+}
+
+int main (int argc, char* argv[])
+{
+    const int width = argc > 2 ? std::atoi(argv[1]) : 6000;
+    const int height = argc > 2 ? std::atoi(argv[2]) : 4000;
+    const int iterations = argc > 3 ? std::atoi(argv[3]) : 5;
+
+    rtengine::initSimdLevel();
+
+    if (argc > 4) {
+        rtengine::SimdLevel level;
+
+        if (!rtengine::getSimdLevelFromName(argv[4], level) || !rtengine::setSimdLevel(level)) {
+            std::fprintf(stderr, "%s: unknown or unsupported instruction set\n", argv[4]);
+            return 1;
+        }
+    }
+
+    if (width < 8 || height < 8 || iterations < 1) {
+        std::fprintf(stderr, "usage: %s [width height [iterations [generic|avx2|avx512]]]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<float> srcData(static_cast<std::size_t>(width) * height);
+    std::vector<float> dstData(srcData.size());
+    std::vector<float> divData(srcData.size());
+
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<float> distribution(0.f, 65535.f);
+
+    for (auto& value : srcData) {
+        value = distribution(generator);
+    }
+
+    for (auto& value : divData) {
+        value = distribution(generator);
+    }
+
+    std::vector<float*> src = makeRows(srcData, width, height);
+    std::vector<float*> dst = makeRows(dstData, width, height);
+    std::vector<float*> div = makeRows(divData, width, height);
+
+    std::printf("%dx%d, %d iterations, %s kernels\n", width, height, iterations, rtengine::getSimdLevelName(rtengine::getSimdLevel()));
+    std::printf("%8s %12s %12s %12s\n", "sigma", "standard", "mult", "div");
+
+    for (double sigma : {0.5, 1.0, 2.0, 5.0, 10.0, 30.0, 60.0, 100.0}) {
+        std::printf("%8.1f", sigma);
+
+        for (eGaussType type : {GAUSS_STANDARD, GAUSS_MULT, GAUSS_DIV}) {
+            MyTime t1, t2;
+            t1.set();
+
+            for (int i = 0; i < iterations; i++) {
+#ifdef _OPENMP
+                #pragma omp parallel
+#endif
+                gaussianBlur(src.data(), dst.data(), width, height, sigma, nullptr, type, div.data());
+            }
+
+            t2.set();
+            const double seconds = t2.etime(t1) / 1000000.0;
+            std::printf(" %7.1f MP/s", static_cast<double>(width) * height * iterations / seconds / 1000000.0);
+        }
+
+        std::printf("\n");
+    }
+
+    return 0;
+}
@@ -38,6 +38,7 @@
 #include "cplx_wavelet_dec.h"
 #include "median.h"
 #include "iccstore.h"
+#include "StopWatch.h"
 #ifdef _OPENMP
 #include <omp.h>
 #endif
@@ -426,6 +427,7 @@ enum nrquality {QUALITY_STANDARD, QUALITY_HIGH};
 
 SSEFUNCTION void ImProcFunctions::RGB_denoise(int kall, Imagefloat * src, Imagefloat * dst, Imagefloat * calclum, float * ch_M, float *max_r, float *max_b, bool isRAW, const procparams::DirPyrDenoiseParams & dnparams, const double expcomp, const NoiseCurve & noiseLCurve, const NoiseCurve & noiseCCurve, float &chaut, float &redaut, float &blueaut, float &maxredaut, float &maxblueaut, float &nresi, float &highresi)
 {
+    BENCHSTAGE("denoise")
 //#ifdef _DEBUG
     MyTime t1e, t2e;
     t1e.set();
@@ -785,6 +787,7 @@ SSEFUNCTION void ImProcFunctions::RGB_denoise(int kall, Imagefloat * src, Imagef
             #pragma omp parallel num_threads(numthreads) if (numthreads>1)
 #endif
             {
+                TRACE_SPAN("RGB_denoise worker")
                 int pos;
                 float* noisevarlum;
                 float* noisevarchrom;
@@ -803,6 +806,10 @@ SSEFUNCTION void ImProcFunctions::RGB_denoise(int kall, Imagefloat * src, Imagef
 
                 for (int tiletop = 0; tiletop < imheight; tiletop += tileHskip) {
                     for (int tileleft = 0; tileleft < imwidth ; tileleft += tileWskip) {
+                        if (isCancelled()) {
+                            continue;
+                        }
+
                         //printf("titop=%d tileft=%d\n",tiletop/tileHskip, tileleft/tileWskip);
                         pos = (tiletop / tileHskip) * numtiles_W + tileleft / tileWskip ;
                         int tileright = MIN(imwidth, tileleft + tilewidth);
@@ -1381,6 +1388,9 @@ SSEFUNCTION void ImProcFunctions::RGB_denoise(int kall, Imagefloat * src, Imagef
 #endif
 
                                     for (int vblk = 0; vblk < numblox_H; ++vblk) {
+                                        if (isCancelled()) {
+                                            continue;
+                                        }
 
                                         int top = (vblk - blkrad) * offset;
                                         float * datarow = pBuf + blkrad * offset;
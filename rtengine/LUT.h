@@ -288,72 +288,35 @@ public:
     }
 
 #if defined( __SSE2__ ) && defined( __x86_64__ )
-/*
+    // use with float indices, 4 at once, with the same interpolation and clipping as operator[](float)
+    template<typename U = T, typename = typename std::enable_if<std::is_same<U, float>::value>::type>
     vfloat operator[](vfloat indexv ) const
     {
-//      printf("don't use this operator. It's not ready for production");
-        return _mm_setzero_ps();
-
-        // convert floats to ints
-        vint idxv =  _mm_cvttps_epi32( indexv );
-        vfloat tempv, resultv, p1v, p2v;
-        vmask maxmask = vmaskf_gt(indexv, maxsv);
-        idxv = _mm_castps_si128(vself(maxmask, maxsv, _mm_castsi128_ps(idxv)));
-        vmask minmask = vmaskf_lt(indexv, _mm_setzero_ps());
-        idxv = _mm_castps_si128(vself(minmask, _mm_setzero_ps(), _mm_castsi128_ps(idxv)));
-        // access the LUT 4 times and shuffle the values into p1v and p2v
-
-        int idx;
-
-        // get 4th value
-        idx = _mm_cvtsi128_si32 (_mm_shuffle_epi32(idxv, _MM_SHUFFLE(3, 3, 3, 3)));
-        tempv = LVFU(data[idx]);
-        p1v = _mm_shuffle_ps(tempv, tempv, _MM_SHUFFLE(0, 0, 0, 0));
-        p2v = _mm_shuffle_ps(tempv, tempv, _MM_SHUFFLE(1, 1, 1, 1));
-        // now p1v is 3 3 3 3
-        //     p2v is 3 3 3 3
+        // don't use floor! The difference in negative space is no problems here
+        vint idxv = _mm_cvttps_epi32(vmaxf(ZEROV, vminf(indexv, maxsv)));
+        vfloat diffv = indexv - _mm_cvtepi32_ps(idxv);
 
-        // get 3rd value
-        idx = _mm_cvtsi128_si32 (_mm_shuffle_epi32(idxv, _MM_SHUFFLE(2, 2, 2, 2)));
-        tempv = LVFU(data[idx]);
-        p1v = _mm_move_ss( p1v, tempv);
-        tempv = _mm_shuffle_ps(tempv, tempv, _MM_SHUFFLE(1, 1, 1, 1));
-        p2v = _mm_move_ss( p2v, tempv);
-        // now p1v is 3 3 3 2
-        //     p2v is 3 3 3 2
+        if (clip & LUT_CLIP_BELOW) {
+            diffv = vself(vmaskf_lt(indexv, ZEROV), ZEROV, diffv);
+        }
 
-        // get 2nd value
-        idx = _mm_cvtsi128_si32 (_mm_shuffle_epi32(idxv, _MM_SHUFFLE(1, 1, 1, 1)));
-        tempv = LVFU(data[idx]);
-        p1v = _mm_shuffle_ps( p1v, p1v, _MM_SHUFFLE(1, 0, 1, 0));
-        p2v = _mm_shuffle_ps( p2v, p2v, _MM_SHUFFLE(1, 0, 1, 0));
-        // now p1v is 3 2 3 2
-        // now p2v is 3 2 3 2
-        p1v = _mm_move_ss( p1v, tempv );
-        // now p1v is 3 2 3 1
-        tempv = _mm_shuffle_ps(tempv, tempv, _MM_SHUFFLE(1, 1, 1, 1));
-        p2v = _mm_move_ss( p2v, tempv);
-        // now p1v is 3 2 3 1
+        if (clip & LUT_CLIP_ABOVE) {
+            // data[maxs] + (data[maxs + 1] - data[maxs]) is data[upperBound]
+            diffv = vself(vmaskf_gt(indexv, maxsv), F2V(1.f), diffv);
+        }
 
-        // get 1st value
-        idx = _mm_cvtsi128_si32 (_mm_shuffle_epi32(idxv, _MM_SHUFFLE(0, 0, 0, 0)));
-        tempv = LVFU(data[idx]);
-        p1v = _mm_shuffle_ps( p1v, p1v, _MM_SHUFFLE(3, 2, 0, 0));
-        // now p1v is 3 2 1 1
-        p2v = _mm_shuffle_ps( p2v, p2v, _MM_SHUFFLE(3, 2, 0, 0));
-        // now p2v is 3 2 1 1
-        p1v = _mm_move_ss( p1v, tempv );
-        // now p1v is 3 2 1 0
-        tempv = _mm_shuffle_ps(tempv, tempv, _MM_SHUFFLE(1, 1, 1, 1));
-        p2v = _mm_move_ss( p2v, tempv);
-        // now p2v is 3 2 1 0
-
-        vfloat diffv = indexv - _mm_cvtepi32_ps ( idxv );
-        diffv = vself(vorm(maxmask, minmask), _mm_setzero_ps(), diffv);
-        resultv = p1v + p2v * diffv;
-        return resultv  ;
+#ifdef __AVX2__
+        vfloat p1v = _mm_i32gather_ps(data, idxv, sizeof(float));
+        vfloat p2v = _mm_i32gather_ps(data + 1, idxv, sizeof(float));
+#else
+        int idx[4] ALIGNED16;
+        _mm_store_si128((vint*)idx, idxv);
+        vfloat p1v = _mm_setr_ps(data[idx[0]], data[idx[1]], data[idx[2]], data[idx[3]]);
+        vfloat p2v = _mm_setr_ps(data[idx[0] + 1], data[idx[1] + 1], data[idx[2] + 1], data[idx[3] + 1]);
+#endif
+        return p1v + (p2v - p1v) * diffv;
     }
-*/
+
 #ifdef __SSE4_1__
     template<typename U = T, typename = typename std::enable_if<std::is_same<U, float>::value>::type>
     vfloat operator[](vint idxv ) const
@@ -465,6 +428,24 @@ public:
         return (p1 + p2 * diff);
     }
 
+    // Applies the LUT to the n values of src, like operator[](float); src and dst may be the same buffer
+    template<typename U = T, typename = typename std::enable_if<std::is_same<U, float>::value>::type>
+    void apply(const float* src, float* dst, int n) const
+    {
+        int i = 0;
+#if defined( __SSE2__ ) && defined( __x86_64__ )
+
+        for (; i < n - 3; i += 4) {
+            STVFU(dst[i], (*this)[LVFU(src[i])]);
+        }
+
+#endif
+
+        for (; i < n; i++) {
+            dst[i] = (*this)[src[i]];
+        }
+    }
+
     // Return the value for "index" that is in the [0-1] range.
     template<typename U = T, typename = typename std::enable_if<std::is_same<U, float>::value>::type>
     T getVal01 (float index) const
@@ -23,6 +23,7 @@
 #define STOPWATCH_H
 #include <iostream>
 #include "mytime.h"
+#include "tracing.h"
 
 #ifdef BENCHMARK
     #define BENCHFUN StopWatch StopFun(__func__);
@@ -32,6 +33,9 @@
     #define BENCHFUNMICRO
 #endif
 
+// Pipeline stages are always instrumented, they are only timed when rtengine::StageTimings or rtengine::Tracer is enabled
+#define BENCHSTAGE(name) rtengine::TraceSpan StopStage(name, true);
+
 class StopWatch
 {
 public:
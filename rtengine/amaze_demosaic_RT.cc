@@ -34,10 +34,42 @@
 #include "opthelper.h"
 #include "median.h"
 #include "StopWatch.h"
+#include "cpufeatures.h"
+#include "settings.h"
+
+// this allows to pass AMAZETS to the code. On some machines larger AMAZETS is faster
+// If AMAZETS is undefined it will be set to 160, which is the fastest on modern x86/64 machines
+#ifndef AMAZETS
+#define AMAZETS 160
+#endif
 
 namespace rtengine
 {
 
+extern const Settings* settings;
+
+namespace
+{
+
+// Tile size, settings->amazeTileSize or, if it is 0, chosen from the size of the L2 cache.
+// We assure that Tile size is a multiple of 32 in the range [96;992]
+int getAmazeTileSize ()
+{
+    int ts = settings->amazeTileSize;
+
+    if (ts <= 0) {
+        // the buffers of a tile take about 58 * ts * ts bytes; as each step only uses a few of them,
+        // AMAZETS is still the fastest when they are somewhat larger than the cache
+        const std::size_t cacheSize = getL2CacheSize();
+
+        for (ts = AMAZETS; cacheSize && ts < 512 && 58 * (ts + 32) * (ts + 32) <= cacheSize * 3 / 2; ts += 32);
+    }
+
+    return (ts & 992) < 96 ? 96 : (ts & 992);
+}
+
+}
+
 SSEFUNCTION void RawImageSource::amaze_demosaic_RT(int winx, int winy, int winw, int winh)
 {
     BENCHFUN
@@ -53,15 +85,9 @@ SSEFUNCTION void RawImageSource::amaze_demosaic_RT(int winx, int winy, int winw,
     const float clip_pt = 1.0 / initialGain;
     const float clip_pt8 = 0.8 / initialGain;
 
-// this allows to pass AMAZETS to the code. On some machines larger AMAZETS is faster
-// If AMAZETS is undefined it will be set to 160, which is the fastest on modern x86/64 machines
-#ifndef AMAZETS
-#define AMAZETS 160
-#endif
     // Tile size; the image is processed in square tiles to lower memory requirements and facilitate multi-threading
-    // We assure that Tile size is a multiple of 32 in the range [96;992]
-    constexpr int ts = (AMAZETS & 992) < 96 ? 96 : (AMAZETS & 992);
-    constexpr int tsh = ts / 2; // half of Tile size
+    const int ts = getAmazeTileSize();
+    const int tsh = ts / 2; // half of Tile size
 
     //offset of R pixel within a Bayer quartet
     int ex, ey;
@@ -86,7 +112,7 @@ SSEFUNCTION void RawImageSource::amaze_demosaic_RT(int winx, int winy, int winw,
     }
 
     //shifts of pointer value to access pixels in vertical and diagonal directions
-    constexpr int v1 = ts, v2 = 2 * ts, v3 = 3 * ts, p1 = -ts + 1, p2 = -2 * ts + 2, p3 = -3 * ts + 3, m1 = ts + 1, m2 = 2 * ts + 2, m3 = 3 * ts + 3;
+    const int v1 = ts, v2 = 2 * ts, v3 = 3 * ts, p1 = -ts + 1, p2 = -2 * ts + 2, p3 = -3 * ts + 3, m1 = ts + 1, m2 = 2 * ts + 2, m3 = 3 * ts + 3;
 
     //tolerance to avoid dividing by zero
     constexpr float eps = 1e-5, epssq = 1e-10;       //tolerance to avoid dividing by zero
@@ -117,6 +143,7 @@ SSEFUNCTION void RawImageSource::amaze_demosaic_RT(int winx, int winy, int winw,
     #pragma omp parallel
 #endif
     {
+        TRACE_SPAN("amaze_demosaic_RT worker")
         int progresscounter = 0;
 
         constexpr int cldf = 2; // factor to multiply cache line distance. 1 = 64 bytes, 2 = 128 bytes ...
@@ -145,7 +172,7 @@ SSEFUNCTION void RawImageSource::amaze_demosaic_RT(int winx, int winy, int winw,
         // weight to give horizontal vs vertical interpolation
         float *hvwt             = (float (*))         ((char*)cddiffsq + sizeof(float) * ts * ts + 2 * cldf * 64);   // 1
         // final interpolated colour difference
-        float (*Dgrb)[ts * tsh] = (float (*)[ts * tsh])vcdalt; // there is no overlap in buffer usage => share
+        float *Dgrb[2] = {vcdalt, vcdalt + ts * tsh}; // there is no overlap in buffer usage => share
         // gradient in plus (NE/SW) direction
         float *delp             = (float (*))cddiffsq; // there is no overlap in buffer usage => share
         // gradient in minus (NW/SE) direction
@@ -181,6 +208,10 @@ SSEFUNCTION void RawImageSource::amaze_demosaic_RT(int winx, int winy, int winw,
 
         for (int top = winy - 16; top < winy + height; top += ts - 32) {
             for (int left = winx - 16; left < winx + width; left += ts - 32) {
+                if (isCancelled()) {
+                    continue;
+                }
+
                 memset(&nyquist[3 * tsh], 0, sizeof(unsigned char) * (ts - 6) * tsh);
                 //location of tile bottom edge
                 int bottom = min(top + ts, winy + height + 16);
@@ -0,0 +1,104 @@
+/*
+ *  This file is part of RawTherapee.
+ *
+ *  RawTherapee is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  RawTherapee is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <utility>
+
+#include <glibmm/threads.h>
+
+#include "noncopyable.h"
+
+namespace rtengine
+{
+
+/**
+ * @brief Blocking FIFO of limited capacity, used to connect the stages of a processing pipeline
+ *
+ * push() blocks while the queue is full, pop() blocks while it is empty. Once close() has been
+ * called, push() refuses new items and pop() returns false as soon as the queue is drained.
+ */
+template<typename T>
+class BoundedQueue :
+    public NonCopyable
+{
+public:
+    explicit BoundedQueue (std::size_t _capacity) :
+        capacity(std::max<std::size_t>(_capacity, 1)),
+        closed(false)
+    {
+    }
+
+    /** @return false if the queue has been closed, in which case the item is not queued */
+    bool push (T item)
+    {
+        Glib::Threads::Mutex::Lock lock(mutex);
+
+        while (!closed && items.size() >= capacity) {
+            notFull.wait(mutex);
+        }
+
+        if (closed) {
+            return false;
+        }
+
+        items.push_back(std::move(item));
+        notEmpty.signal();
+        return true;
+    }
+
+    /** @return false if the queue has been closed and is empty */
+    bool pop (T& item)
+    {
+        Glib::Threads::Mutex::Lock lock(mutex);
+
+        while (!closed && items.empty()) {
+            notEmpty.wait(mutex);
+        }
+
+        if (items.empty()) {
+            return false;
+        }
+
+        item = std::move(items.front());
+        items.pop_front();
+        notFull.signal();
+        return true;
+    }
+
+    /** Wakes up all the waiting threads; the items already queued can still be popped */
+    void close ()
+    {
+        Glib::Threads::Mutex::Lock lock(mutex);
+        closed = true;
+        notFull.broadcast();
+        notEmpty.broadcast();
+    }
+
+private:
+    const std::size_t capacity;
+    bool closed;
+    std::deque<T> items;
+
+    Glib::Threads::Mutex mutex;
+    Glib::Threads::Cond notFull;
+    Glib::Threads::Cond notEmpty;
+};
+
+}
@@ -0,0 +1,58 @@
+/*
+ *  This file is part of RawTherapee.
+ *
+ *  RawTherapee is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  RawTherapee is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <atomic>
+
+#include "noncopyable.h"
+
+namespace rtengine
+{
+
+/**
+ * @brief Tells a running processing that its result is not wanted anymore
+ *
+ * The token is raised by the thread which supersedes the processing, and polled by the long loops, which then skip
+ * their remaining iterations. The output of a step which returns while its token is raised is garbage, and must be
+ * discarded by the caller.
+ */
+class CancellationToken final :
+    public NonCopyable
+{
+public:
+    CancellationToken () : cancelled(false) {}
+
+    void cancel ()
+    {
+        cancelled.store(true, std::memory_order_relaxed);
+    }
+
+    void reset ()
+    {
+        cancelled.store(false, std::memory_order_relaxed);
+    }
+
+    bool isCancelled () const
+    {
+        return cancelled.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<bool> cancelled;
+};
+
+}
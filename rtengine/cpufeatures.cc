@@ -0,0 +1,118 @@
+/*
+ *  This file is part of RawTherapee.
+ *
+ *  RawTherapee is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  RawTherapee is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "cpufeatures.h"
+
+#ifdef __APPLE__
+#include <cstdint>
+#include <sys/sysctl.h>
+#elif !defined(WIN32)
+#include <unistd.h>
+#endif
+
+namespace
+{
+
+// written once by rtengine::init (or by the command line), before any processing starts
+rtengine::SimdLevel simdLevel = rtengine::SimdLevel::GENERIC;
+
+}
+
+namespace rtengine
+{
+
+void initSimdLevel ()
+{
+    simdLevel = getSupportedSimdLevel();
+}
+
+SimdLevel getSimdLevel ()
+{
+    return simdLevel;
+}
+
+SimdLevel getSupportedSimdLevel ()
+{
+#ifdef RT_MULTIVERSIONING
+    __builtin_cpu_init();
+
+#ifdef RT_MULTIVERSIONING_AVX512
+
+    if (__builtin_cpu_supports("avx512f")) {
+        return SimdLevel::AVX512;
+    }
+
+#endif
+
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return SimdLevel::AVX2;
+    }
+
+#endif
+    return SimdLevel::GENERIC;
+}
+
+bool setSimdLevel (SimdLevel level)
+{
+    if (level > getSupportedSimdLevel()) {
+        return false;
+    }
+
+    simdLevel = level;
+    return true;
+}
+
+const char* getSimdLevelName (SimdLevel level)
+{
+    switch (level) {
+    case SimdLevel::AVX2:
+        return "avx2";
+
+    case SimdLevel::AVX512:
+        return "avx512";
+
+    default:
+        return "generic";
+    }
+}
+
+bool getSimdLevelFromName (const std::string& name, SimdLevel& level)
+{
+    for (auto candidate : {SimdLevel::GENERIC, SimdLevel::AVX2, SimdLevel::AVX512}) {
+        if (name == getSimdLevelName(candidate)) {
+            level = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+std::size_t getL2CacheSize ()
+{
+#if defined(_SC_LEVEL2_CACHE_SIZE)
+    const long size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    return size > 0 ? size : 0;
+#elif defined(__APPLE__)
+    std::uint64_t size = 0;
+    std::size_t length = sizeof(size);
+    return sysctlbyname("hw.l2cachesize", &size, &length, nullptr, 0) == 0 ? size : 0;
+#else
+    return 0;
+#endif
+}
+
+}
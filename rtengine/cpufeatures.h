@@ -0,0 +1,63 @@
+/*
+ *  This file is part of RawTherapee.
+ *
+ *  RawTherapee is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  RawTherapee is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Hot kernels can be compiled several times in the same binary, once for the instruction set selected by
+// PROC_TARGET_NUMBER and once per level below, and dispatched with getSimdLevel(). This needs the target
+// attribute of gcc (or clang) on x86.
+#if defined(__SSE2__) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RT_MULTIVERSIONING
+#define RT_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#if __GNUC__ >= 5 || defined(__clang__)
+#define RT_MULTIVERSIONING_AVX512
+#define RT_TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+#endif
+
+namespace rtengine
+{
+
+enum class SimdLevel {
+    GENERIC, // code compiled for the PROC_TARGET_NUMBER instruction set
+    AVX2,    // avx2 and fma
+    AVX512   // avx512f
+};
+
+/** Selects the best level supported by the cpu, called by rtengine::init */
+void initSimdLevel ();
+
+/** @return the level the kernels have to use */
+SimdLevel getSimdLevel ();
+
+/** @return the best level supported by the cpu and by this build */
+SimdLevel getSupportedSimdLevel ();
+
+/** Forces the level of the kernels, e.g. for benchmarking. @return false if the level is not supported, in which case nothing changes */
+bool setSimdLevel (SimdLevel level);
+
+const char* getSimdLevelName (SimdLevel level);
+
+/** @return false if name is not one of "generic", "avx2" or "avx512" */
+bool getSimdLevelFromName (const std::string& name, SimdLevel& level);
+
+/** @return the size of the L2 cache of a core in bytes, or 0 if it is unknown */
+std::size_t getL2CacheSize ();
+
+}
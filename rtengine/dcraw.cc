@@ -11,6 +11,10 @@
 /*RT*/#define DJGPP
 
 #include "opthelper.h"
+/*RT*/#include "cpufeatures.h"
+/*RT*/#ifdef RT_MULTIVERSIONING
+/*RT*/#include <immintrin.h>
+/*RT*/#endif
 /*
    dcraw.c -- Dave Coffin's raw photo decoder
    Copyright 1997-2016 by Dave Coffin, dcoffin a cybercom o net
@@ -53,6 +57,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
+#include <vector>
 #include <sys/types.h>
 
 #if defined(DJGPP) || defined(__MINGW32__)
@@ -323,6 +328,12 @@ double CLASS getreal (int type)
 
 void CLASS read_shorts (ushort *pixel, int count)
 {
+/*RT swap the bytes while copying them out of the file, instead of in a second pass */
+  if ((order == 0x4949) == (ntohs(0x1234) == 0x1234) && ftell(ifp) + count*2 <= ifp->size) {
+    swab ((char*)fdata(ftell(ifp), ifp), (char*)pixel, count*2);
+    fskip (ifp, count*2);
+    return;
+  }
   if (fread (pixel, 2, count, ifp) < count) derror();
   if ((order == 0x4949) == (ntohs(0x1234) == 0x1234))
 	  swab ((char*)pixel, (char*)pixel, count*2);
@@ -562,6 +573,15 @@ inline unsigned CLASS getbithuff_t::operator() (int nbits, ushort *huff)
   if (nbits < 0)
     return bitbuf = vbits = reset = 0;
   if (nbits == 0 || vbits < 0) return 0;
+/*RT take the bytes straight from the memory of the file, up to a 0xff which needs the checks of the loop below */
+  if (!reset && vbits < nbits && ftell(ifp) + 4 <= ifp->size) {
+    const uchar *p = fdata(ftell(ifp), ifp);
+    int n = (nbits - vbits + 7) >> 3, i = 0;
+    for (; i < n && !(zero_after_ff && p[i] == 0xff); i++)
+      bitbuf = (bitbuf << 8) + p[i];
+    vbits += i << 3;
+    fskip (ifp, i);
+  }
   while (!reset && vbits < nbits && (c = fgetc(ifp)) != EOF &&
     !(reset = zero_after_ff && c == 0xff && fgetc(ifp))) {
     bitbuf = (bitbuf << 8) + (uchar) c;
@@ -778,6 +798,13 @@ struct jhead {
 };
 
 int CLASS ljpeg_start (struct jhead *jh, int info_only)
+{
+  if (!ljpeg_start (jh, info_only, ifp)) return 0;
+  if (info_only) return 1;
+  return zero_after_ff = 1;
+}
+
+int CLASS ljpeg_start (struct jhead *jh, int info_only, IMFILE *ifp)
 {
   ushort c, tag, len;
   uchar data[0x10000];
@@ -831,7 +858,7 @@ int CLASS ljpeg_start (struct jhead *jh, int info_only)
   }
   jh->row = (ushort *) calloc (2 * jh->wide*jh->clrs, 4);
   merror (jh->row, "ljpeg_start()");
-  return zero_after_ff = 1;
+  return 1;
 }
 
 void CLASS ljpeg_end (struct jhead *jh)
@@ -842,6 +869,11 @@ void CLASS ljpeg_end (struct jhead *jh)
 }
 
 inline int CLASS ljpeg_diff (ushort *huff)
+{
+  return ljpeg_diff (huff, getbithuff);
+}
+
+inline int CLASS ljpeg_diff (ushort *huff, getbithuff_t &getbithuff)
 {
   int len, diff;
 
@@ -855,6 +887,11 @@ inline int CLASS ljpeg_diff (ushort *huff)
 }
 
 ushort * CLASS ljpeg_row (int jrow, struct jhead *jh)
+{
+  return ljpeg_row (jrow, jh, ifp, getbithuff);
+}
+
+ushort * CLASS ljpeg_row (int jrow, struct jhead *jh, IMFILE *ifp, getbithuff_t &getbithuff)
 {
   int col, c, diff, pred, spred=0;
   ushort mark=0, *row[3];
@@ -871,7 +908,7 @@ ushort * CLASS ljpeg_row (int jrow, struct jhead *jh)
   FORC3 row[c] = (jh->row + ((jrow & 1) + 1) * (jh->wide*jh->clrs*((jrow+c) & 1)));
   for (col=0; col < jh->wide; col++)
     FORC(jh->clrs) {
-      diff = ljpeg_diff (jh->huff[c]);
+      diff = ljpeg_diff (jh->huff[c], getbithuff);
       if (jh->sraw && c <= jh->sraw && (col | c))
 		    pred = spred;
       else if (col) pred = row[0][-jh->clrs];
@@ -885,7 +922,7 @@ ushort * CLASS ljpeg_row (int jrow, struct jhead *jh)
 	case 7: pred = (pred + row[1][0]) >> 1;				break;
 	default: pred = 0;
       }
-      if (UNLIKELY((**row = pred + diff) >> jh->bits)) derror();
+      if (UNLIKELY((**row = pred + diff) >> jh->bits)) getbithuff.derror();
       if (c <= jh->sraw) spred = **row;
       row[0]++; row[1]++;
     }
@@ -1035,20 +1072,28 @@ void CLASS adobe_copy_pixel (unsigned row, unsigned col, ushort **rp)
 }
 
 void CLASS ljpeg_idct (struct jhead *jh)
+{
+  ljpeg_idct (jh, getbithuff);
+}
+
+void CLASS ljpeg_idct (struct jhead *jh, getbithuff_t &getbithuff)
 {
   int c, i, j, len, skip, coef;
   float work[3][8][8];
-  static float cs[106] = { 0 };
+  /*RT initialized once, the tiles of a DNG may be decoded in parallel */
+  static const struct cs_table {
+    float v[106];
+    cs_table() { FORC(106) v[c] = cos((c & 31)*M_PI/16)/2; }
+  } cs_init;
+  const float *cs = cs_init.v;
   static const uchar zigzag[80] =
   {  0, 1, 8,16, 9, 2, 3,10,17,24,32,25,18,11, 4, 5,12,19,26,33,
     40,48,41,34,27,20,13, 6, 7,14,21,28,35,42,49,56,57,50,43,36,
     29,22,15,23,30,37,44,51,58,59,52,45,38,31,39,46,53,60,61,54,
     47,55,62,63,63,63,63,63,63,63,63,63,63,63,63,63,63,63,63,63 };
 
-  if (!cs[0])
-    FORC(106) cs[c] = cos((c & 31)*M_PI/16)/2;
   memset (work, 0, sizeof work);
-  work[0][0][0] = jh->vpred[0] += ljpeg_diff (jh->huff[0]) * jh->quant[0];
+  work[0][0][0] = jh->vpred[0] += ljpeg_diff (jh->huff[0], getbithuff) * jh->quant[0];
   for (i=1; i < 64; i++ ) {
     len = gethuff (jh->huff[16]);
     i += skip = len >> 4;
@@ -1072,47 +1117,135 @@ void CLASS ljpeg_idct (struct jhead *jh)
 
 void CLASS lossless_dng_load_raw()
 {
-  unsigned save, trow=0, tcol=0, jwide, jrow, jcol, row, col, i, j;
-  struct jhead jh;
-  ushort *rp;
+  struct tile { unsigned offset, row, col; };
+  std::vector<tile> tiles;
+  unsigned save, trow=0, tcol=0;
 
   while (trow < raw_height) {
     save = ftell(ifp);
-    if (tile_length < INT_MAX)
-      fseek (ifp, get4(), SEEK_SET);
-    if (!ljpeg_start (&jh, 0)) break;
-    jwide = jh.wide;
-    if (filters) jwide *= jh.clrs;
-    jwide /= MIN (is_raw, tiff_samples);
-    switch (jh.algo) {
-      case 0xc1:
-	jh.vpred[0] = 16384;
-	getbits(-1);
-	for (jrow=0; jrow+7 < jh.high; jrow += 8) {
-	  for (jcol=0; jcol+7 < jh.wide; jcol += 8) {
-	    ljpeg_idct (&jh);
-	    rp = jh.idct;
-	    row = trow + jcol/tile_width + jrow*2;
-	    col = tcol + jcol%tile_width;
-	    for (i=0; i < 16; i+=2)
-	      for (j=0; j < 8; j++)
-		adobe_copy_pixel (row+i, col+j, &rp);
-	  }
-	}
-	break;
-      case 0xc3:
-	for (row=col=jrow=0; jrow < jh.high; jrow++) {
-	  rp = ljpeg_row (jrow, &jh);
-	  for (jcol=0; jcol < jwide; jcol++) {
-	    adobe_copy_pixel (trow+row, tcol+col, &rp);
-	    if (++col >= tile_width || col >= raw_width)
-	      row += 1 + (col = 0);
-	  }
-	}    }
+    tiles.push_back ({tile_length < INT_MAX ? get4() : save, trow, tcol});
     fseek (ifp, save+4, SEEK_SET);
     if ((tcol += tile_width) >= raw_width)
       trow += tile_length + (tcol = 0);
-    ljpeg_end (&jh);
+  }
+
+  /*RT each tile is a separate JPEG stream, so the tiles are decoded in parallel, each one reading the memory
+       of the file from its own position. The data errors are counted and reported once decoded */
+  int errors = 0;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) reduction(+:errors) if (tiles.size() > 1)
+#endif
+  for (size_t t = 0; t < tiles.size(); t++) {
+    IMFILE tfile = *ifp;
+    tfile.plistener = nullptr;
+    IMFILE *tifp = &tfile;
+    unsigned tzero_after_ff = 1;
+    getbithuff_t tgetbithuff (this, tifp, tzero_after_ff, &errors);
+    fseek (tifp, tiles[t].offset, SEEK_SET);
+    lossless_dng_load_tile (tiles[t].row, tiles[t].col, tifp, tgetbithuff);
+  }
+  if (errors) derror();
+}
+
+void CLASS lossless_dng_load_tile (unsigned trow, unsigned tcol, IMFILE *ifp, getbithuff_t &getbithuff)
+{
+  unsigned jwide, jrow, jcol, row, col, i, j;
+  struct jhead jh;
+  ushort *rp;
+
+  if (!ljpeg_start (&jh, 0, ifp)) return;
+  jwide = jh.wide;
+  if (filters) jwide *= jh.clrs;
+  jwide /= MIN (is_raw, tiff_samples);
+  switch (jh.algo) {
+    case 0xc1:
+      jh.vpred[0] = 16384;
+      getbits(-1);
+      for (jrow=0; jrow+7 < jh.high; jrow += 8) {
+	for (jcol=0; jcol+7 < jh.wide; jcol += 8) {
+	  ljpeg_idct (&jh, getbithuff);
+	  rp = jh.idct;
+	  row = trow + jcol/tile_width + jrow*2;
+	  col = tcol + jcol%tile_width;
+	  for (i=0; i < 16; i+=2)
+	    for (j=0; j < 8; j++)
+	      adobe_copy_pixel (row+i, col+j, &rp);
+	}
+      }
+      break;
+    case 0xc3:
+      for (row=col=jrow=0; jrow < jh.high; jrow++) {
+	rp = ljpeg_row (jrow, &jh, ifp, getbithuff);
+	for (jcol=0; jcol < jwide; jcol++) {
+	  adobe_copy_pixel (trow+row, tcol+col, &rp);
+	  if (++col >= tile_width || col >= raw_width)
+	    row += 1 + (col = 0);
+	}
+      }
+  }
+  ljpeg_end (&jh);
+}
+
+/*RT The byte shuffle and the 32 bit multiplication of unpack_msb need SSE4.1. They are compiled for it when the
+     whole build targets it, otherwise with the avx2 target and used when rtengine::init selected a vector level */
+#if defined(__SSE4_1__)
+#define UNPACK_MSB_SIMD
+#define UNPACK_MSB_TARGET
+#elif defined(RT_MULTIVERSIONING)
+#define UNPACK_MSB_SIMD
+#define UNPACK_MSB_TARGET RT_TARGET_AVX2
+#endif
+
+#ifdef UNPACK_MSB_SIMD
+/*RT The 32 bit words holding 8 samples, which take bps bytes, are gathered by a byte shuffle, then each sample is
+     moved to the top of its word by a multiplication and down by a shift. A sample starts at most 7 bits into its
+     word, so any bps up to 16 fits; for bps > 14 the low byte of the last words lies past the 16 loaded bytes, but
+     holds no bit of the sample, so it is zeroed. @return the number of samples unpacked */
+UNPACK_MSB_TARGET static int unpack_msb_simd (const uchar *src, ushort *dst, int count, int bps)
+{
+  const int nbytes = (count * bps + 7) / 8;
+  char shuffle[2][16] ALIGNED16;
+  int mul[2][4] ALIGNED16;
+  for (int k = 0; k < 8; k++) {
+    const int o = k * bps;
+    for (int b = 0; b < 4; b++) {
+      const int byte = (o >> 3) + 3 - b;
+      shuffle[k >> 2][(k & 3) * 4 + b] = byte < 16 ? byte : -128;
+    }
+    mul[k >> 2][k & 3] = 1 << (o & 7);
+  }
+  const __m128i shuffle0 = _mm_load_si128((const __m128i*)shuffle[0]);
+  const __m128i shuffle1 = _mm_load_si128((const __m128i*)shuffle[1]);
+  const __m128i mul0 = _mm_load_si128((const __m128i*)mul[0]);
+  const __m128i mul1 = _mm_load_si128((const __m128i*)mul[1]);
+  int col = 0;
+  for (; col + 8 <= count && col / 8 * bps + 16 <= nbytes; col += 8) {
+    const __m128i in = _mm_loadu_si128((const __m128i*)(src + col / 8 * bps));
+    const __m128i lo = _mm_srli_epi32(_mm_mullo_epi32(_mm_shuffle_epi8(in, shuffle0), mul0), 32 - bps);
+    const __m128i hi = _mm_srli_epi32(_mm_mullo_epi32(_mm_shuffle_epi8(in, shuffle1), mul1), 32 - bps);
+    _mm_storeu_si128((__m128i*)(dst + col), _mm_packus_epi32(lo, hi));
+  }
+  return col;
+}
+#endif
+
+/*RT Unpacks count samples of bps bits (at most 16) from a big endian bit stream starting at src */
+static void unpack_msb (const uchar *src, ushort *dst, int count, int bps)
+{
+  int col = 0;
+#if defined(__SSE4_1__)
+  col = unpack_msb_simd (src, dst, count, bps);
+#elif defined(UNPACK_MSB_SIMD)
+  if (rtengine::getSimdLevel() != rtengine::SimdLevel::GENERIC)
+    col = unpack_msb_simd (src, dst, count, bps);
+#endif
+  UINT64 bitbuf = 0;
+  int vbits = 0;
+  for (src += col / 8 * bps; col < count; col++) {
+    for (; vbits < bps; vbits += 8)
+      bitbuf = bitbuf << 8 | *src++;
+    dst[col] = bitbuf << (64 - vbits) >> (64 - bps);
+    vbits -= bps;
   }
 }
 
@@ -1126,7 +1259,11 @@ void CLASS packed_dng_load_raw()
   for (row=0; row < raw_height; row++) {
     if (tiff_bps == 16)
       read_shorts (pixel, raw_width * tiff_samples);
-    else {
+    else if (tiff_bps < 16 && !zero_after_ff &&
+	     ftell(ifp) + (raw_width * tiff_samples * tiff_bps + 7) / 8 <= ifp->size) {
+      unpack_msb (fdata(ftell(ifp), ifp), pixel, raw_width * tiff_samples, tiff_bps);
+      fskip (ifp, (raw_width * tiff_samples * tiff_bps + 7) / 8);
+    } else {
       getbits(-1);
       for (col=0; col < raw_width * tiff_samples; col++)
 	pixel[col] = getbits(tiff_bps);
@@ -1731,34 +1868,58 @@ void CLASS phase_one_load_raw_c()
     read_shorts ((ushort *) rblack[0], raw_width*2);
   for (i=0; i < 256; i++)
     curve[i] = i*i / 3.969 + 0.5;
+  bool failed = false, corrupt = false;
+
+  /*RT each row starts at its own offset with an empty bit buffer, so the rows are decoded in parallel, each thread
+       reading the memory of the file from its own position. The data errors are reported once decoded */
+#ifdef _OPENMP
+#pragma omp parallel private(len, pred, row, col, i, j) reduction(||:failed,corrupt)
+#endif
+{
+  IMFILE tfile = *ifp;
+  tfile.plistener = nullptr;
+  IMFILE *tifp = &tfile;
+  ph1_bithuff_t tph1_bithuff (this, tifp, order);
+  ushort *rowpixel = (ushort *) malloc (raw_width * 2);
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic,16)
+#endif
   for (row=0; row < raw_height; row++) {
-    fseek (ifp, data_offset + offset[row], SEEK_SET);
-    ph1_bits(-1);
+    if (!rowpixel) {
+      failed = true;
+      continue;
+    }
+    fseek (tifp, data_offset + offset[row], SEEK_SET);
+    tph1_bithuff(-1,0);
     pred[0] = pred[1] = 0;
     for (col=0; col < raw_width; col++) {
       if (col >= (raw_width & -8))
 	len[0] = len[1] = 14;
       else if ((col & 7) == 0)
 	for (i=0; i < 2; i++) {
-	  for (j=0; j < 5 && !ph1_bits(1); j++);
-	  if (j--) len[i] = length[j*2 + ph1_bits(1)];
+	  for (j=0; j < 5 && !tph1_bithuff(1,0); j++);
+	  if (j--) len[i] = length[j*2 + tph1_bithuff(1,0)];
 	}
       if ((i = len[col & 1]) == 14)
-	pixel[col] = pred[col & 1] = ph1_bits(16);
+	rowpixel[col] = pred[col & 1] = tph1_bithuff(16,0);
       else
-	pixel[col] = pred[col & 1] += ph1_bits(i) + 1 - (1 << (i - 1));
-      if (pred[col & 1] >> 16) derror();
-      if (ph1.format == 5 && pixel[col] < 256)
-	pixel[col] = curve[pixel[col]];
+	rowpixel[col] = pred[col & 1] += tph1_bithuff(i,0) + 1 - (1 << (i - 1));
+      if (pred[col & 1] >> 16) corrupt = true;
+      if (ph1.format == 5 && rowpixel[col] < 256)
+	rowpixel[col] = curve[rowpixel[col]];
     }
     for (col=0; col < raw_width; col++) {
-      i = (pixel[col] << 2*(ph1.format != 8)) - ph1.black
+      i = (rowpixel[col] << 2*(ph1.format != 8)) - ph1.black
 	+ cblack[row][col >= ph1.split_col]
 	+ rblack[col][row >= ph1.split_row];
       if (i > 0) RAW(row,col) = i;
     }
   }
+  free (rowpixel);
+}
   free (pixel);
+  if (failed) merror (nullptr, "phase_one_load_raw_c()");
+  if (corrupt) derror();
   maximum = 0xfffc - ph1.black;
 }
 
@@ -2238,6 +2399,15 @@ void CLASS packed_load_raw()
   UINT64 bitbuf=0;
 
   bwide = raw_width * tiff_bps / 8;
+/*RT rows of a plain big endian bit stream, starting on byte boundaries */
+  if (!load_flags && tiff_bps <= 16 && raw_width * tiff_bps % 8 == 0 &&
+      ftell(ifp) + (INT64) bwide * raw_height <= ifp->size) {
+    for (row=0; row < raw_height; row++) {
+      unpack_msb (fdata(ftell(ifp), ifp), &RAW(row,0), raw_width, tiff_bps);
+      fskip (ifp, bwide);
+    }
+    return;
+  }
   bwide += bwide & load_flags >> 7;
   rbits = bwide * 8 - raw_width * tiff_bps;
   if (load_flags & 1) bwide = bwide * 16 / 15;
@@ -3026,15 +3196,34 @@ void CLASS sony_arw_load_raw()
 }
 
 void CLASS sony_arw2_load_raw()
+{
+  const int start = ftell(ifp);
+  bool failed = false;
+
+  /*RT each row takes raw_width bytes, so the rows are decoded in parallel, each thread reading the memory of the
+       file from its own position */
+#ifdef _OPENMP
+#pragma omp parallel reduction(||:failed)
+#endif
 {
   uchar *data, *dp;
   ushort pix[16];
   int row, col, val, max, min, imax, imin, sh, bit, i;
+  IMFILE tfile = *ifp;
+  tfile.plistener = nullptr;
+  IMFILE *tifp = &tfile;
 
   data = (uchar *) malloc (raw_width+1);
-  merror (data, "sony_arw2_load_raw()");
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic,16)
+#endif
   for (row=0; row < height; row++) {
-    fread (data, 1, raw_width, ifp);
+    if (!data) {
+      failed = true;
+      continue;
+    }
+    fseek (tifp, start + row * raw_width, SEEK_SET);
+    fread (data, 1, raw_width, tifp);
     for (dp=data, col=0; col < raw_width-30; dp+=16) {
       max = 0x7ff & (val = sget4(dp));
       min = 0x7ff & val >> 11;
@@ -3055,6 +3244,8 @@ void CLASS sony_arw2_load_raw()
     }
   }
   free (data);
+}
+  if (failed) merror (nullptr, "sony_arw2_load_raw()");
   maximum = curve[0x7ff << 1]; // RT: fix maximum.
   maximum = 16300; // RT: conservative white level tested on various ARW2 cameras. This constant was set in 2013-12-17, may need re-evaluation in the future.
 }
@@ -9791,27 +9982,28 @@ void CLASS deflate_dng_load_raw() {
     }
     uLongf dstLen = tile_width * tile_length * 4;
 
-#if defined(_OPENMP) && ZLIB_VER_REVISION == 8
-#pragma omp parallel
+  /*RT each tile is a separate deflate stream, so the tiles are decoded in parallel, each thread reading the memory
+       of the file from its own position */
+#ifdef _OPENMP
+#pragma omp parallel if (tileCount > 1)
 #endif
 {
+    IMFILE tfile = *ifp;
+    tfile.plistener = nullptr;
+    IMFILE *tifp = &tfile;
     Bytef * cBuffer = new Bytef[maxCompressed];
     Bytef * uBuffer = new Bytef[dstLen];
 
-#if defined(_OPENMP) && ZLIB_VER_REVISION == 8
-#pragma omp for collapse(2) nowait
+#ifdef _OPENMP
+#pragma omp for collapse(2) schedule(dynamic) nowait
 #endif
     for (size_t y = 0; y < raw_height; y += tile_length) {
       for (size_t x = 0; x < raw_width; x += tile_width) {
 		size_t t = (y / tile_length) * tilesWide + (x / tile_width);
-#if defined(_OPENMP) && ZLIB_VER_REVISION == 8
-#pragma omp critical
-#endif
-{
-        fseek(ifp, tileOffsets[t], SEEK_SET);
-        fread(cBuffer, 1, tileBytes[t], ifp);
-}
-        int err = uncompress(uBuffer, &dstLen, cBuffer, tileBytes[t]);
+        fseek(tifp, tileOffsets[t], SEEK_SET);
+        fread(cBuffer, 1, tileBytes[t], tifp);
+        uLongf uLen = dstLen;
+        int err = uncompress(uBuffer, &uLen, cBuffer, tileBytes[t]);
         if (err != Z_OK) {
           fprintf(stderr, "DNG Deflate: Failed uncompressing tile %d, with error %d\n", (int)t, err);
         } else if (ifd->sample_format == 3) {  // Floating point data
@@ -193,18 +193,23 @@ void parse_redcine();
 class getbithuff_t
 {
 public:
-   getbithuff_t(DCraw *p,IMFILE *&i, unsigned &z):parent(p),bitbuf(0),vbits(0),reset(0),ifp(i),zero_after_ff(z){}
+   // with errors, the data errors are counted there instead of being reported, e.g. by a thread decoding in parallel
+   getbithuff_t(DCraw *p,IMFILE *&i, unsigned &z, int *e = nullptr):parent(p),bitbuf(0),vbits(0),reset(0),ifp(i),zero_after_ff(z),errors(e){}
    unsigned operator()(int nbits, ushort *huff);
-
-private:
    void derror(){
-	   parent->derror();
+	   if (errors)
+	     ++*errors;
+	   else
+	     parent->derror();
    }
+
+private:
    DCraw *parent;
    unsigned bitbuf;
    int vbits, reset;
    IMFILE *&ifp;
    unsigned &zero_after_ff;
+   int *errors;
 };
 getbithuff_t getbithuff;
 
@@ -219,11 +224,17 @@ int ljpeg_diff (ushort *huff);
 ushort * ljpeg_row (int jrow, struct jhead *jh);
 void lossless_jpeg_load_raw();
 void ljpeg_idct (struct jhead *jh);
+// variants reading the stream from their own file and bit buffer, for decoding several streams in parallel
+int ljpeg_start (struct jhead *jh, int info_only, IMFILE *ifp);
+int ljpeg_diff (ushort *huff, getbithuff_t &getbithuff);
+ushort * ljpeg_row (int jrow, struct jhead *jh, IMFILE *ifp, getbithuff_t &getbithuff);
+void ljpeg_idct (struct jhead *jh, getbithuff_t &getbithuff);
 
 
 void canon_sraw_load_raw();
 void adobe_copy_pixel (unsigned row, unsigned col, ushort **rp);
 void lossless_dng_load_raw();
+void lossless_dng_load_tile (unsigned trow, unsigned tcol, IMFILE *ifp, getbithuff_t &getbithuff);
 void packed_dng_load_raw();
 void deflate_dng_load_raw();
 void pentax_load_raw();
@@ -254,8 +265,11 @@ public:
    ph1_bithuff_t(DCraw *p,IMFILE *&i,short &o):parent(p),order(o),ifp(i),bitbuf(0),vbits(0){}
    unsigned operator()(int nbits, ushort *huff);
 private:
+   // reads its own file, so that several rows can be decoded in parallel
    unsigned get4(){
-	 return parent->get4();
+	 uchar str[4] = { 0xff,0xff,0xff,0xff };
+	 fread (str, 1, 4, ifp);
+	 return parent->sget4(str);
    }
    DCraw *parent;
    short &order;
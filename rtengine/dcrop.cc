@@ -22,6 +22,7 @@
 #include "mytime.h"
 #include "refreshmap.h"
 #include "rt_math.h"
+#include "tracing.h"
 
 namespace
 {
@@ -43,7 +44,7 @@ extern const Settings* settings;
 Crop::Crop (ImProcCoordinator* parent, EditDataProvider *editDataProvider, bool isDetailWindow)
     : PipetteBuffer(editDataProvider), origCrop(nullptr), laboCrop(nullptr), labnCrop(nullptr),
       cropImg(nullptr), cbuf_real(nullptr), cshmap(nullptr), transCrop(nullptr), cieCrop(nullptr), cbuffer(nullptr),
-      updating(false), newUpdatePending(false), skip(10),
+      updating(false), newUpdatePending(false), refineTodo(0), pendingTodo(0), skip(10),
       cropx(0), cropy(0), cropw(-1), croph(-1),
       trafx(0), trafy(0), trafw(-1), trafh(-1),
       rqcropx(0), rqcropy(0), rqcropw(-1), rqcroph(-1),
@@ -130,10 +131,24 @@ bool Crop::hasListener()
 void Crop::update (int todo)
 {
     MyMutex::MyLock cropLock(cropMutex);
+    TRACE_SPAN("Crop::update")
 
     ProcParams& params = parent->params;
 //       CropGUIListener* cropgl;
 
+    const bool draft = todo & M_DRAFT;
+
+    todo |= pendingTodo;
+    pendingTodo = 0;
+
+    if (!draft) {
+        todo |= refineTodo;
+        refineTodo = 0;
+    }
+
+    // labnCrop is about to change
+    parent->unshareLab (this);
+
     // No need to update todo here, since it has already been changed in ImprocCoordinator::updatePreviewImage,
     // and Crop::update ask to do ALL anyway
 
@@ -162,6 +177,24 @@ void Crop::update (int todo)
     // Tells to the ImProcFunctions' tool what is the preview scale, which may lead to some simplifications
     parent->ipf.setScale (skip);
 
+    // the visible part may be copied from the preview or from another crop computed for the same parameters, but the
+    // pipette buffers are only filled by the processing
+    if ((todo & (M_LUMINANCE | M_COLOR | M_WAVELET | M_CIECAM)) && getCurrEditID() == EUID_None && isAligned()) {
+        int visibleW, visibleH;
+        getVisibleSize (visibleW, visibleH);
+
+        if (parent->copySharedLab (skip, cropx, cropy, labnCrop, leftBorder, upperBorder, visibleW, visibleH)) {
+            if (settings->verbose) {
+                printf ("Detail crop copied from a shared image\n");
+            }
+
+            pendingTodo = ALL;
+            refineTodo = 0;
+            sendImage ();
+            return;
+        }
+    }
+
     Imagefloat* baseCrop = origCrop;
     int widIm = parent->fw;//full image
     int heiIm = parent->fh;
@@ -653,7 +686,10 @@ void Crop::update (int todo)
             }
 
         if (todo & M_LINDENOISE) {
-            if (skip == 1 && denoiseParams.enabled) {
+            if (skip == 1 && denoiseParams.enabled && draft) {
+                // the noise reduction is redone from the source crop by refine
+                refineTodo |= todo & ~M_DRAFT;
+            } else if (skip == 1 && denoiseParams.enabled) {
                 int kall = 0;
 
                 float chaut, redaut, blueaut, maxredaut, maxblueaut, nresi, highresi;
@@ -690,6 +726,10 @@ void Crop::update (int todo)
 
     }
 
+    if (abortIfCancelled (todo)) {
+        return;
+    }
+
     // has to be called after setCropSizes! Tools prior to this point can't handle the Edit mechanism, but that shouldn't be a problem.
     createBuffer(cropw, croph);
 
@@ -791,7 +831,7 @@ void Crop::update (int todo)
     }*/
 
     // apply luminance operations
-    if (todo & (M_LUMINANCE + M_COLOR)) {
+    if (todo & (M_LUMINANCE + M_COLOR + M_WAVELET + M_CIECAM)) {
         //I made a little change here. Rather than have luminanceCurve (and others) use in/out lab images, we can do more if we copy right here.
         labnCrop->CopyFrom(laboCrop);
 
@@ -817,7 +857,11 @@ void Crop::update (int todo)
 
         //parent->ipf.EPDToneMap(labnCrop, 5, 1);    //Go with much fewer than normal iterates for fast redisplay.
         // for all treatments Defringe, Sharpening, Contrast detail , Microcontrast they are activated if "CIECAM" function are disabled
-        if (skip == 1) {
+        if (skip == 1 && draft) {
+            if (params.impulseDenoise.enabled || params.defringe.enabled || params.sharpenEdge.enabled || params.sharpenMicro.enabled || params.sharpening.enabled) {
+                refineTodo |= M_LUMINANCE | M_COLOR;
+            }
+        } else if (skip == 1) {
             if((params.colorappearance.enabled && !settings->autocielab)  || (!params.colorappearance.enabled)) {
                 parent->ipf.impulsedenoise (labnCrop);
             }
@@ -978,6 +1022,34 @@ void Crop::update (int todo)
         }
     }
 
+    if (abortIfCancelled (todo)) {
+        return;
+    }
+
+    if (!refineTodo && isAligned()) {
+        int visibleW, visibleH;
+        getVisibleSize (visibleW, visibleH);
+        parent->shareLab (this, skip, cropx, cropy, labnCrop, leftBorder, upperBorder, visibleW, visibleH);
+    }
+
+    sendImage ();
+}
+
+bool Crop::isAligned () const
+{
+    return cropx % skip == 0 && cropy % skip == 0 && trafx % skip == 0 && trafy % skip == 0;
+}
+
+void Crop::getVisibleSize (int& w, int& h) const
+{
+    w = min(rqcropw, cropw - leftBorder);
+    h = min(rqcroph, croph - upperBorder);
+}
+
+void Crop::sendImage ()
+{
+    ProcParams& params = parent->params;
+
     // all pipette buffer processing should be finished now
     PipetteBuffer::setReady();
 
@@ -990,17 +1062,8 @@ void Crop::update (int todo)
         // internal image in output color space for analysis
         Image8 *cropImgtrue = parent->ipf.lab2rgb (labnCrop, 0, 0, cropw, croph, params.icm);
 
-        int finalW = rqcropw;
-
-        if (cropImg->getWidth() - leftBorder < finalW) {
-            finalW = cropImg->getWidth() - leftBorder;
-        }
-
-        int finalH = rqcroph;
-
-        if (cropImg->getHeight() - upperBorder < finalH) {
-            finalH = cropImg->getHeight() - upperBorder;
-        }
+        int finalW, finalH;
+        getVisibleSize (finalW, finalH);
 
         Image8* final = new Image8 (finalW, finalH);
         Image8* finaltrue = new Image8 (finalW, finalH);
@@ -1024,6 +1087,8 @@ void Crop::freeAll ()
         printf ("freeallcrop starts %d\n", (int)cropAllocated);
     }
 
+    parent->unshareLab (this);
+
     if (cropAllocated) {
         if (origCrop ) {
             delete    origCrop;
@@ -1089,6 +1154,7 @@ bool Crop::setCropSizes (int rcx, int rcy, int rcw, int rch, int skip, bool inte
 
     if (!internal) {
         cropMutex.lock ();
+        parent->unshareLab (this);
     }
 
     bool changed = false;
@@ -1262,6 +1328,31 @@ bool Crop::tryUpdate()
     return needsNewThread;
 }
 
+bool Crop::abortIfCancelled (int todo)
+{
+    if (!parent->cancelToken.isCancelled()) {
+        return false;
+    }
+
+    // the intermediate images are garbage now, they are computed again by the next update
+    pendingTodo |= todo & ~M_DRAFT;
+    return true;
+}
+
+void Crop::refine ()
+{
+    int todo;
+
+    {
+        MyMutex::MyLock cropLock(cropMutex);
+        todo = refineTodo;
+    }
+
+    if (todo) {
+        update (todo);
+    }
+}
+
 /* @brief Handles Crop updating in its own thread
  *
  * This method will cycle updates as long as Crop::newUpdatePending will be true. During the processing,
@@ -55,6 +55,8 @@ protected:
 
     bool updating;         /// Flag telling if an updater thread is currently processing
     bool newUpdatePending; /// Flag telling the updater thread that a new update is pending
+    int refineTodo;        /// Processing steps skipped by the draft updates, redone by the next full quality update
+    int pendingTodo;       /// Processing steps missing from the intermediate images (cancelled update, or image copied from another one), done by the next update
     int skip;
     int cropx, cropy, cropw, croph;         /// size of the detail crop image ('skip' taken into account), with border
     int trafx, trafy, trafw, trafh;         /// the size and position to get from the imagesource that is transformed to the requested crop area
@@ -71,6 +73,12 @@ protected:
     EditUniqueID getCurrEditID();
     bool setCropSizes (int cropX, int cropY, int cropW, int cropH, int skip, bool internal);
     void freeAll ();
+    // Returns true if the update has been superseded by newer parameters, see ImProcCoordinator::cancelToken
+    bool abortIfCancelled (int todo);
+    // True if the pixels are on the sampling grid of the preview, which they then share with the other crops of the same skip
+    bool isAligned () const;
+    void getVisibleSize (int& w, int& h) const;
+    void sendImage ();
 
 public:
     Crop             (ImProcCoordinator* parent, EditDataProvider *editDataProvider, bool isDetailWindow);
@@ -79,6 +87,8 @@ public:
     void setEditSubscriber(EditSubscriber* newSubscriber);
     bool hasListener();
     void update      (int todo);
+    /** @brief Redo at full quality what the draft updates have skipped, if anything */
+    void refine      ();
     void setWindow   (int cropX, int cropY, int cropW, int cropH, int skip)
     {
         setCropSizes (cropX, cropY, cropW, cropH, skip, false);
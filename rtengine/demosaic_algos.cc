@@ -4085,6 +4085,10 @@ void RawImageSource::xtrans_interpolate (const int passes, const bool useCieLab)
 
         for (int top = 3; top < height - 19; top += ts - 16)
             for (int left = 3; left < width - 19; left += ts - 16) {
+                if (isCancelled()) {
+                    continue;
+                }
+
                 int mrow = MIN (top + ts, height - 3);
                 int mcol = MIN (left + ts, width - 3);
 
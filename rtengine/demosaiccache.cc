@@ -0,0 +1,393 @@
+/*
+ *  This file is part of RawTherapee.
+ *
+ *  RawTherapee is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  RawTherapee is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "demosaiccache.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <glibmm.h>
+#include <giomm.h>
+#include <glib/gstdio.h>
+#include <zlib.h>
+
+#include "settings.h"
+
+namespace rtengine
+{
+
+extern const Settings* settings;
+
+namespace
+{
+
+constexpr char cacheMagic[4] = {'R', 'T', 'D', 'C'};
+constexpr std::uint32_t cacheVersion = 1;
+constexpr int rowsPerChunk = 64;
+
+// Values are stored divided by 65536, so that the raw range doesn't hit the 65504 limit of half floats
+constexpr float storeScale = 1.f / 65536.f;
+
+std::uint16_t floatToHalf (float value)
+{
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    const std::uint16_t sign = (bits >> 16) & 0x8000;
+    const int floatExponent = (bits >> 23) & 0xff;
+    const int exponent = floatExponent - 127 + 15;
+    std::uint32_t mantissa = bits & 0x7fffff;
+
+    if (floatExponent == 0xff) { // inf or nan
+        return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+    }
+
+    if (exponent >= 31) { // clamp to the highest finite value
+        return sign | 0x7bff;
+    }
+
+    if (exponent <= 0) { // denormal or zero
+        if (exponent < -10) {
+            return sign;
+        }
+
+        mantissa |= 0x800000;
+        const int shift = 14 - exponent;
+        std::uint32_t half = mantissa >> shift;
+
+        if ((mantissa >> (shift - 1)) & 1) {
+            ++half;
+        }
+
+        return sign | half;
+    }
+
+    std::uint32_t half = (exponent << 10) | (mantissa >> 13);
+
+    if (mantissa & 0x1000) {
+        ++half; // a carry into the exponent is the correct result
+    }
+
+    return sign | std::min<std::uint32_t>(half, 0x7bff);
+}
+
+float decodeHalf (std::uint16_t half)
+{
+    const std::uint32_t sign = static_cast<std::uint32_t>(half & 0x8000) << 16;
+    const std::uint32_t exponent = (half >> 10) & 0x1f;
+    const std::uint32_t mantissa = half & 0x3ff;
+
+    if (exponent == 0) {
+        const float value = mantissa * (1.f / 16777216.f);
+        return sign ? -value : value;
+    }
+
+    const std::uint32_t bits = sign | (exponent == 31 ? 0x7f800000 : (exponent + 112) << 23) | (mantissa << 13);
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Each row is delta coded before deflating, which roughly halves the size of the compressed data
+bool compressPlane (array2D<float>& plane, int width, int height, std::vector<unsigned char>& out)
+{
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+
+    if (deflateInit(&stream, Z_BEST_SPEED) != Z_OK) {
+        return false;
+    }
+
+    std::vector<std::uint16_t> buffer(static_cast<std::size_t>(width) * rowsPerChunk);
+    out.resize(deflateBound(&stream, static_cast<uLong>(width) * height * sizeof(std::uint16_t)));
+    stream.next_out = out.data();
+    stream.avail_out = static_cast<uInt>(out.size());
+
+    bool ok = true;
+
+    for (int row = 0; row < height && ok; row += rowsPerChunk) {
+        const int rows = std::min(rowsPerChunk, height - row);
+
+        for (int i = 0; i < rows; ++i) {
+            const float* const src = plane[row + i];
+            std::uint16_t* const dst = buffer.data() + static_cast<std::size_t>(i) * width;
+            std::uint16_t previous = 0;
+
+            for (int j = 0; j < width; ++j) {
+                const std::uint16_t half = floatToHalf(src[j] * storeScale);
+                dst[j] = half - previous;
+                previous = half;
+            }
+        }
+
+        const bool last = row + rows >= height;
+        stream.next_in = reinterpret_cast<Bytef*>(buffer.data());
+        stream.avail_in = static_cast<uInt>(rows) * width * sizeof(std::uint16_t);
+
+        // the output buffer is large enough for the whole plane, so deflate always consumes all the input
+        const int result = deflate(&stream, last ? Z_FINISH : Z_NO_FLUSH);
+        ok = (last ? result == Z_STREAM_END : result == Z_OK) && stream.avail_in == 0;
+    }
+
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return ok;
+}
+
+bool decompressPlane (const std::vector<unsigned char>& in, const float* halfToFloat, int width, int height, array2D<float>& plane)
+{
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+
+    if (inflateInit(&stream) != Z_OK) {
+        return false;
+    }
+
+    std::vector<std::uint16_t> buffer(static_cast<std::size_t>(width) * rowsPerChunk);
+    stream.next_in = const_cast<Bytef*>(in.data());
+    stream.avail_in = static_cast<uInt>(in.size());
+
+    bool ok = true;
+
+    for (int row = 0; row < height && ok; row += rowsPerChunk) {
+        const int rows = std::min(rowsPerChunk, height - row);
+
+        stream.next_out = reinterpret_cast<Bytef*>(buffer.data());
+        stream.avail_out = static_cast<uInt>(rows) * width * sizeof(std::uint16_t);
+
+        const int result = inflate(&stream, Z_SYNC_FLUSH);
+        ok = (result == Z_OK || result == Z_STREAM_END) && stream.avail_out == 0;
+
+        for (int i = 0; i < rows && ok; ++i) {
+            const std::uint16_t* const src = buffer.data() + static_cast<std::size_t>(i) * width;
+            float* const dst = plane[row + i];
+            std::uint16_t half = 0;
+
+            for (int j = 0; j < width; ++j) {
+                half += src[j];
+                dst[j] = halfToFloat[half];
+            }
+        }
+    }
+
+    inflateEnd(&stream);
+    return ok;
+}
+
+}
+
+DemosaicCache& DemosaicCache::getInstance()
+{
+    static DemosaicCache instance;
+    return instance;
+}
+
+DemosaicCache::DemosaicCache()
+{
+    for (int i = 0; i < 65536; ++i) {
+        halfToFloat[i] = decodeHalf(i) / storeScale;
+    }
+}
+
+bool DemosaicCache::isEnabled() const
+{
+    return settings->demosaicCache && !settings->demosaicCacheDir.empty();
+}
+
+bool DemosaicCache::get(const Glib::ustring& key, int width, int height, array2D<float>& red, array2D<float>& green, array2D<float>& blue)
+{
+    const Glib::ustring fileName = getFileName(key);
+    FILE* const file = g_fopen(fileName.c_str(), "rb");
+
+    if (!file) {
+        return false;
+    }
+
+    char magic[4];
+    std::uint32_t version;
+    std::int32_t fileWidth, fileHeight;
+    std::uint64_t sizes[3];
+
+    bool ok =
+        fread(magic, sizeof(magic), 1, file) == 1
+        && fread(&version, sizeof(version), 1, file) == 1
+        && fread(&fileWidth, sizeof(fileWidth), 1, file) == 1
+        && fread(&fileHeight, sizeof(fileHeight), 1, file) == 1
+        && fread(sizes, sizeof(sizes), 1, file) == 1
+        && std::memcmp(magic, cacheMagic, sizeof(magic)) == 0
+        && version == cacheVersion
+        && fileWidth == width
+        && fileHeight == height;
+
+    std::vector<unsigned char> payloads[3];
+
+    for (int c = 0; c < 3 && ok; ++c) {
+        if (sizes[c] > compressBound(static_cast<uLong>(width) * height * sizeof(std::uint16_t))) {
+            ok = false;
+            break;
+        }
+
+        payloads[c].resize(sizes[c]);
+        ok = fread(payloads[c].data(), 1, sizes[c], file) == sizes[c];
+    }
+
+    fclose(file);
+
+    if (ok) {
+        array2D<float>* const planes[3] = {&red, &green, &blue};
+        bool planeOk[3];
+
+        for (int c = 0; c < 3; ++c) {
+            if (planes[c]->width() != width || planes[c]->height() != height) {
+                (*planes[c])(width, height);
+            }
+        }
+
+#ifdef _OPENMP
+        #pragma omp parallel for num_threads(3)
+#endif
+
+        for (int c = 0; c < 3; ++c) {
+            planeOk[c] = decompressPlane(payloads[c], halfToFloat, width, height, *planes[c]);
+        }
+
+        ok = planeOk[0] && planeOk[1] && planeOk[2];
+    }
+
+    if (ok) {
+        // Entries are evicted by modification time, so a hit makes the entry the most recent one
+        g_utime(fileName.c_str(), nullptr);
+    } else {
+        if (settings->verbose) {
+            printf("Removing invalid demosaic cache entry %s\n", fileName.c_str());
+        }
+
+        g_remove(fileName.c_str());
+    }
+
+    return ok;
+}
+
+void DemosaicCache::put(const Glib::ustring& key, int width, int height, array2D<float>& red, array2D<float>& green, array2D<float>& blue)
+{
+    if (g_mkdir_with_parents(settings->demosaicCacheDir.c_str(), 0755) != 0) {
+        return;
+    }
+
+    array2D<float>* const planes[3] = {&red, &green, &blue};
+    std::vector<unsigned char> payloads[3];
+    bool planeOk[3];
+
+#ifdef _OPENMP
+    #pragma omp parallel for num_threads(3)
+#endif
+
+    for (int c = 0; c < 3; ++c) {
+        planeOk[c] = compressPlane(*planes[c], width, height, payloads[c]);
+    }
+
+    if (!planeOk[0] || !planeOk[1] || !planeOk[2]) {
+        return;
+    }
+
+    // Written under a temporary name and then renamed, so that concurrent jobs never read a partial entry
+    const Glib::ustring fileName = getFileName(key);
+    const Glib::ustring tmpFileName = Glib::ustring::compose("%1.%2-%3.tmp", fileName, g_get_real_time(), reinterpret_cast<std::uintptr_t>(&payloads));
+    FILE* const file = g_fopen(tmpFileName.c_str(), "wb");
+
+    if (!file) {
+        return;
+    }
+
+    const std::int32_t fileWidth = width;
+    const std::int32_t fileHeight = height;
+    const std::uint64_t sizes[3] = {payloads[0].size(), payloads[1].size(), payloads[2].size()};
+
+    bool ok =
+        fwrite(cacheMagic, sizeof(cacheMagic), 1, file) == 1
+        && fwrite(&cacheVersion, sizeof(cacheVersion), 1, file) == 1
+        && fwrite(&fileWidth, sizeof(fileWidth), 1, file) == 1
+        && fwrite(&fileHeight, sizeof(fileHeight), 1, file) == 1
+        && fwrite(sizes, sizeof(sizes), 1, file) == 1;
+
+    for (int c = 0; c < 3 && ok; ++c) {
+        ok = fwrite(payloads[c].data(), 1, payloads[c].size(), file) == payloads[c].size();
+    }
+
+    ok = fclose(file) == 0 && ok;
+
+    if (!ok || g_rename(tmpFileName.c_str(), fileName.c_str()) != 0) {
+        g_remove(tmpFileName.c_str());
+        return;
+    }
+
+    applySizeLimitation();
+}
+
+Glib::ustring DemosaicCache::getFileName(const Glib::ustring& key) const
+{
+    return Glib::build_filename(settings->demosaicCacheDir, Glib::Checksum::compute_checksum(Glib::Checksum::CHECKSUM_MD5, key) + ".rtdc");
+}
+
+void DemosaicCache::applySizeLimitation()
+{
+    MyMutex::MyLock lock(sizeLimitationMutex);
+
+    struct Entry {
+        Glib::ustring name;
+        goffset size;
+        Glib::TimeVal mtime;
+    };
+    std::vector<Entry> entries;
+    goffset totalSize = 0;
+
+    try {
+        const auto dir = Gio::File::create_for_path(settings->demosaicCacheDir);
+        auto enumerator = dir->enumerate_children("standard::name,standard::size,time::modified");
+
+        while (auto file = enumerator->next_file()) {
+            const Glib::ustring name = file->get_name();
+
+            if (name.size() > 5 && name.substr(name.size() - 5) == ".rtdc") {
+                entries.push_back({name, file->get_size(), file->modification_time()});
+                totalSize += file->get_size();
+            }
+        }
+    } catch (Glib::Exception&) {
+        return;
+    }
+
+    const goffset maxSize = static_cast<goffset>(settings->demosaicCacheSize) << 20;
+
+    if (totalSize <= maxSize) {
+        return;
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& lhs, const Entry& rhs) {
+        return lhs.mtime < rhs.mtime;
+    });
+
+    for (auto entry = entries.begin(); entry != entries.end() && totalSize > maxSize; ++entry) {
+        if (g_remove(Glib::build_filename(settings->demosaicCacheDir, entry->name).c_str()) == 0) {
+            totalSize -= entry->size;
+        }
+    }
+}
+
+}
@@ -0,0 +1,61 @@
+/*
+ *  This file is part of RawTherapee.
+ *
+ *  RawTherapee is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  RawTherapee is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <glibmm/ustring.h>
+
+#include "array2D.h"
+#include "noncopyable.h"
+#include "../rtgui/threadutils.h"
+
+namespace rtengine
+{
+
+/**
+ * @brief Persistent cache of the demosaiced red, green and blue planes of raw images
+ *
+ * The entries are stored in Settings::demosaicCacheDir as zlib compressed half floats, one file per
+ * key. The key has to identify the raw file and every parameter having an influence on the output of
+ * the demosaicing. The least recently used entries are removed when the cache exceeds
+ * Settings::demosaicCacheSize MiB.
+ */
+class DemosaicCache final :
+    public NonCopyable
+{
+public:
+    static DemosaicCache& getInstance();
+
+    /** @return true if the cache is enabled in the settings */
+    bool isEnabled() const;
+
+    /** Fills the planes (allocating them if needed) from the entry of key. @return false if there is no valid entry */
+    bool get(const Glib::ustring& key, int width, int height, array2D<float>& red, array2D<float>& green, array2D<float>& blue);
+    /** Stores the planes under key */
+    void put(const Glib::ustring& key, int width, int height, array2D<float>& red, array2D<float>& green, array2D<float>& blue);
+
+private:
+    DemosaicCache();
+
+    Glib::ustring getFileName(const Glib::ustring& key) const;
+    void applySizeLimitation();
+
+    float halfToFloat[65536]; // already scaled back to the [0;65535] range
+
+    MyMutex sizeLimitationMutex;
+};
+
+}
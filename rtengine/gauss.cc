@@ -21,6 +21,7 @@
 #include <cstdlib>
 #include "opthelper.h"
 #include "boxblur.h"
+#include "cpufeatures.h"
 
 namespace
 {
@@ -903,6 +904,188 @@ template<class T> SSEFUNCTION void gaussVerticalSsediv (T** RESTRICT src, T** RE
 
 #endif
 
+#ifdef RT_MULTIVERSIONING
+
+// Vertical pass for a strip of N columns starting at column i. The kernel is written without intrinsics, so that each of
+// the target specific functions below gets it vectorized for its own register width. With 32 floats per row,
+// the strip is read, buffered and written in whole cache lines.
+template<int N, class T, class C, eGaussType gausstype>
+inline __attribute__((always_inline)) void gaussVerticalStrip (T** src, T** dst, T** divBuffer, const int i, const int H, const C B, const C b1, const C b2, const C b3, const C (&M)[3][3], C* RESTRICT tmp)
+{
+    for (int k = 0; k < N; k++) {
+        tmp[k] = src[0][i + k] * (B + b1 + b2 + b3);
+    }
+
+    for (int k = 0; k < N; k++) {
+        tmp[N + k] = B * src[1][i + k] + b1 * tmp[k] + (b2 + b3) * src[0][i + k];
+    }
+
+    for (int k = 0; k < N; k++) {
+        tmp[2 * N + k] = B * src[2][i + k] + b1 * tmp[N + k] + b2 * tmp[k] + b3 * src[0][i + k];
+    }
+
+    for (int j = 3; j < H; j++) {
+        const T* const srcRow = src[j] + i;
+        C* const cur = tmp + j * N;
+
+        for (int k = 0; k < N; k++) {
+            cur[k] = B * srcRow[k] + b1 * cur[k - N] + b2 * cur[k - 2 * N] + b3 * cur[k - 3 * N];
+        }
+    }
+
+    // boundary conditions of the backward pass
+    C temp2H[N], temp2Hp1[N];
+    C* const last = tmp + (H - 1) * N;
+
+    for (int k = 0; k < N; k++) {
+        const C v = src[H - 1][i + k];
+        temp2Hp1[k] = v + M[2][0] * (last[k] - v) + M[2][1] * (last[k - N] - v) + M[2][2] * (last[k - 2 * N] - v);
+        temp2H[k]   = v + M[1][0] * (last[k] - v) + M[1][1] * (last[k - N] - v) + M[1][2] * (last[k - 2 * N] - v);
+        last[k]     = v + M[0][0] * (last[k] - v) + M[0][1] * (last[k - N] - v) + M[0][2] * (last[k - 2 * N] - v);
+    }
+
+    for (int k = 0; k < N; k++) {
+        last[k - N] = B * last[k - N] + b1 * last[k] + b2 * temp2H[k] + b3 * temp2Hp1[k];
+    }
+
+    for (int k = 0; k < N; k++) {
+        last[k - 2 * N] = B * last[k - 2 * N] + b1 * last[k - N] + b2 * last[k] + b3 * temp2H[k];
+    }
+
+    for (int j = H - 4; j >= 0; j--) {
+        C* const cur = tmp + j * N;
+
+        for (int k = 0; k < N; k++) {
+            cur[k] = B * cur[k] + b1 * cur[k + N] + b2 * cur[k + 2 * N] + b3 * cur[k + 3 * N];
+        }
+    }
+
+    // src and dst may be the same buffer, so dst is written only when the whole strip has been read
+    for (int j = 0; j < H; j++) {
+        const C* const cur = tmp + j * N;
+        T* const dstRow = dst[j] + i;
+
+        if (gausstype == GAUSS_MULT) {
+            for (int k = 0; k < N; k++) {
+                dstRow[k] *= cur[k];
+            }
+        } else if (gausstype == GAUSS_DIV) {
+            const T* const divRow = divBuffer[j] + i;
+
+            for (int k = 0; k < N; k++) {
+                dstRow[k] = divRow[k] / (cur[k] > 0 ? cur[k] : 1);
+            }
+        } else {
+            for (int k = 0; k < N; k++) {
+                dstRow[k] = cur[k];
+            }
+        }
+    }
+}
+
+template<int N, class T, eGaussType gausstype>
+inline __attribute__((always_inline)) void gaussVerticalStrips (T** src, T** dst, T** divBuffer, const int W, const int H, const double sigma)
+{
+    double b1, b2, b3, B, M[3][3];
+    calculateYvVFactors<double>(sigma, b1, b2, b3, B, M);
+
+    float Bf = B, b1f = b1, b2f = b2, b3f = b3, Mf[3][3];
+
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++) {
+            M[i][j] *= (1.0 + b2 + (b1 - b3) * b3);
+            M[i][j] /= (1.0 + b1 - b2 + b3) * (1.0 - b1 - b2 - b3);
+            Mf[i][j] = M[i][j];
+        }
+
+    float* const tmp = new float[H * N];
+
+#ifdef _OPENMP
+    #pragma omp for nowait
+#endif
+
+    for (int i = 0; i < W - N + 1; i += N) {
+        gaussVerticalStrip<N, T, float, gausstype>(src, dst, divBuffer, i, H, Bf, b1f, b2f, b3f, Mf, tmp);
+    }
+
+    delete [] tmp;
+
+    // remaining columns are done in double precision, like the borders of the sse version
+    if (W % N) {
+        double* const tmpd = new double[H];
+
+#ifdef _OPENMP
+        #pragma omp for nowait
+#endif
+
+        for (int i = W - (W % N); i < W; i++) {
+            gaussVerticalStrip<1, T, double, gausstype>(src, dst, divBuffer, i, H, B, b1, b2, b3, M, tmpd);
+        }
+
+        delete [] tmpd;
+    }
+
+    // the callers chain passes inside one parallel region, so all the columns must be done before returning
+#ifdef _OPENMP
+    #pragma omp barrier
+#endif
+}
+
+template<class T, eGaussType gausstype>
+RT_TARGET_AVX2 void gaussVerticalAvx2 (T** src, T** dst, T** divBuffer, const int W, const int H, const double sigma)
+{
+    gaussVerticalStrips<32, T, gausstype>(src, dst, divBuffer, W, H, sigma);
+}
+
+#ifdef RT_MULTIVERSIONING_AVX512
+template<class T, eGaussType gausstype>
+RT_TARGET_AVX512 void gaussVerticalAvx512 (T** src, T** dst, T** divBuffer, const int W, const int H, const double sigma)
+{
+    gaussVerticalStrips<32, T, gausstype>(src, dst, divBuffer, W, H, sigma);
+}
+#endif
+#endif
+
+#ifdef __SSE2__
+// Runs the vertical pass with the instruction set selected by rtengine::init
+template<class T, eGaussType gausstype> void gaussVerticalSimd (T** src, T** dst, T** divBuffer, const int W, const int H, const double sigma)
+{
+#ifdef RT_MULTIVERSIONING
+
+    switch (rtengine::getSimdLevel()) {
+#ifdef RT_MULTIVERSIONING_AVX512
+
+    case rtengine::SimdLevel::AVX512:
+        gaussVerticalAvx512<T, gausstype>(src, dst, divBuffer, W, H, sigma);
+        return;
+#endif
+
+    case rtengine::SimdLevel::AVX2:
+        gaussVerticalAvx2<T, gausstype>(src, dst, divBuffer, W, H, sigma);
+        return;
+
+    default:
+        break;
+    }
+
+#endif
+
+    switch (gausstype) {
+    case GAUSS_MULT:
+        gaussVerticalSsemult<T> (src, dst, W, H, sigma);
+        break;
+
+    case GAUSS_DIV:
+        gaussVerticalSsediv<T> (src, dst, divBuffer, W, H, sigma);
+        break;
+
+    case GAUSS_STANDARD:
+        gaussVerticalSse<T> (src, dst, W, H, sigma);
+        break;
+    }
+}
+#endif
+
 template<class T> void gaussVertical (T** src, T** dst, const int W, const int H, const double sigma)
 {
     double b1, b2, b3, B, M[3][3];
@@ -1240,19 +1423,19 @@ template<class T> void gaussianBlurImpl(T** src, T** dst, const int W, const int
                 switch (gausstype) {
                 case GAUSS_MULT : {
                     gaussHorizontalSse<T> (src, src, W, H, sigma);
-                    gaussVerticalSsemult<T> (src, dst, W, H, sigma);
+                    gaussVerticalSimd<T, GAUSS_MULT> (src, dst, nullptr, W, H, sigma);
                     break;
                 }
 
                 case GAUSS_DIV : {
                     gaussHorizontalSse<T> (src, dst, W, H, sigma);
-                    gaussVerticalSsediv<T> (dst, dst, buffer2, W, H, sigma);
+                    gaussVerticalSimd<T, GAUSS_DIV> (dst, dst, buffer2, W, H, sigma);
                     break;
                 }
 
                 case GAUSS_STANDARD : {
                     gaussHorizontalSse<T> (src, dst, W, H, sigma);
-                    gaussVerticalSse<T> (dst, dst, W, H, sigma);
+                    gaussVerticalSimd<T, GAUSS_STANDARD> (dst, dst, nullptr, W, H, sigma);
                     break;
                 }
                 }
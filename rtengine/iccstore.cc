@@ -119,6 +119,9 @@ inline uint8_t getSupportedIntents (cmsHPROFILE profile, cmsUInt32Number directi
     return result;
 }
 
+// Number of transforms kept by ICCStore::getTransform
+constexpr std::size_t maxTransforms = 32;
+
 inline cmsHPROFILE createXYZProfile ()
 {
     double mat[3][3] = { {1.0, 0, 0}, {0, 1.0, 0}, {0, 0, 1.0} };
@@ -306,7 +309,9 @@ ICCStore* ICCStore::getInstance ()
 
 ICCStore::ICCStore () :
     xyz (createXYZProfile ()),
-    srgb (cmsCreate_sRGBProfile ())
+    srgb (cmsCreate_sRGBProfile ()),
+    lab (cmsCreateLab4Profile (nullptr)),
+    transformUse (0)
 {
     //cmsErrorAction (LCMS_ERROR_SHOW);
 
@@ -766,6 +771,68 @@ uint8_t ICCStore::getProofIntents (cmsHPROFILE profile) const
     return getSupportedIntents (profile, LCMS_USED_AS_PROOF);
 }
 
+std::string ICCStore::getProfileChecksum (cmsHPROFILE profile)
+{
+    if (!profile) {
+        return std::string ();
+    }
+
+    const ProfileContent content (profile);
+
+    // the creation date and the profile ID are ignored, they differ between identical profiles
+    if (content.length >= 128) {
+        std::memset (content.data + 24, 0, 12);
+        std::memset (content.data + 84, 0, 16);
+    }
+
+    return Glib::Checksum::compute_checksum (Glib::Checksum::CHECKSUM_MD5, reinterpret_cast<const guchar*> (content.data), content.length);
+}
+
+ICCStore::Transform ICCStore::getTransform (cmsHPROFILE input, cmsUInt32Number inputFormat, cmsHPROFILE output, cmsUInt32Number outputFormat,
+                                            cmsUInt32Number intent, cmsUInt32Number flags, cmsHPROFILE proofing, cmsUInt32Number proofingIntent)
+{
+    flags |= cmsFLAGS_NOCACHE; // for thread safety
+
+    MyMutex::MyLock lcmsLock (*lcmsMutex);
+
+    const std::string key = getProfileChecksum (input) + ':' + getProfileChecksum (output) + ':' + getProfileChecksum (proofing) + ':'
+                            + std::to_string (inputFormat) + ':' + std::to_string (outputFormat) + ':'
+                            + std::to_string (intent) + ':' + std::to_string (proofingIntent) + ':' + std::to_string (flags);
+
+    const TransformMap::iterator r = transforms.find (key);
+
+    if (r != transforms.end ()) {
+        r->second.second = ++transformUse;
+        return r->second.first;
+    }
+
+    const cmsHTRANSFORM hTransform = proofing
+                                     ? cmsCreateProofingTransform (input, inputFormat, output, outputFormat, proofing, intent, proofingIntent, flags)
+                                     : cmsCreateTransform (input, inputFormat, output, outputFormat, intent, flags);
+
+    if (!hTransform) {
+        return Transform ();
+    }
+
+    if (transforms.size () >= maxTransforms) {
+        // the users of the evicted transform keep it alive until they are done
+        TransformMap::iterator oldest = transforms.begin ();
+
+        for (TransformMap::iterator it = transforms.begin (); it != transforms.end (); ++it) {
+            if (it->second.second < oldest->second.second) {
+                oldest = it;
+            }
+        }
+
+        transforms.erase (oldest);
+    }
+
+    const Transform transform (hTransform, cmsDeleteTransform);
+    transforms[key] = std::make_pair (transform, ++transformUse);
+
+    return transform;
+}
+
 // Reads all profiles from the given profiles dir
 void ICCStore::init (const Glib::ustring& usrICCDir, const Glib::ustring& rtICCDir)
 {
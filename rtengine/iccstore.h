@@ -22,6 +22,7 @@
 #include <lcms2.h>
 #include <glibmm.h>
 #include <map>
+#include <memory>
 #include <string>
 #include <cstdint>
 #include "procparams.h"
@@ -57,6 +58,7 @@ class ICCStore
     typedef std::map<Glib::ustring, TMatrix> MatrixMap;
     typedef std::map<Glib::ustring, ProfileContent> ContentMap;
     typedef std::map<Glib::ustring, Glib::ustring> NameMap;
+    typedef std::map<std::string, std::pair<std::shared_ptr<void>, unsigned long>> TransformMap;
 
     ProfileMap wProfiles;
     ProfileMap wProfilesGamma;
@@ -77,13 +79,22 @@ class ICCStore
 
     const cmsHPROFILE xyz;
     const cmsHPROFILE srgb;
+    const cmsHPROFILE lab;
 
     mutable MyMutex mutex_;
 
+    // transforms shared by all the processing jobs, guarded by lcmsMutex.
+    // the second member of the pair is the last use, to evict the oldest ones
+    TransformMap transforms;
+    unsigned long transformUse;
+
     ICCStore ();
 
 public:
 
+    // A cached transform; it is deleted when both the cache and its users release it
+    typedef std::shared_ptr<void> Transform;
+
     enum class ProfileType {
         MONITOR,
         PRINTER,
@@ -117,6 +128,17 @@ public:
 
     cmsHPROFILE      getXYZProfile  () const;
     cmsHPROFILE      getsRGBProfile () const;
+    cmsHPROFILE      getLabProfile  () const;
+
+    // Identifies a profile by its content, as many of them are rebuilt for each image. The caller must lock lcmsMutex
+    static std::string getProfileChecksum (cmsHPROFILE profile);
+
+    // Returns a transform shared with all the callers using the same profiles (compared by content), formats, intents and flags.
+    // cmsFLAGS_NOCACHE is always added, so the transform can be used by several threads at once.
+    // WARNING: the caller must not lock lcmsMutex
+    Transform        getTransform   (cmsHPROFILE input, cmsUInt32Number inputFormat, cmsHPROFILE output, cmsUInt32Number outputFormat,
+                                     cmsUInt32Number intent, cmsUInt32Number flags,
+                                     cmsHPROFILE proofing = nullptr, cmsUInt32Number proofingIntent = INTENT_RELATIVE_COLORIMETRIC);
 
     std::vector<Glib::ustring> getProfiles (const ProfileType type = ProfileType::MONITOR) const;
     std::vector<Glib::ustring> getProfilesFromDir (const Glib::ustring& dirName) const;
@@ -178,6 +200,11 @@ inline cmsHPROFILE ICCStore::getsRGBProfile () const
     return srgb;
 }
 
+inline cmsHPROFILE ICCStore::getLabProfile () const
+{
+    return lab;
+}
+
 }
 
 #endif
@@ -39,6 +39,7 @@
 #include "iptcpairs.h"
 #include "iccjpeg.h"
 #include "color.h"
+#include "StopWatch.h"
 
 #include "jpeg.h"
 
@@ -441,7 +442,7 @@ void my_error_exit (j_common_ptr cinfo)
 }
 
 
-int ImageIO::loadJPEGFromMemory (const char* buffer, int bufsize)
+int ImageIO::loadJPEGFromMemory (const char* buffer, int bufsize, int minWidth, int minHeight, int* fullWidth, int* fullHeight)
 {
     jpeg_decompress_struct cinfo;
     jpeg_create_decompress(&cinfo);
@@ -492,6 +493,25 @@ int ImageIO::loadJPEGFromMemory (const char* buffer, int bufsize)
         embProfile = nullptr;
     }
 
+    if (fullWidth) {
+        *fullWidth = cinfo.image_width;
+    }
+
+    if (fullHeight) {
+        *fullHeight = cinfo.image_height;
+    }
+
+    // libjpeg scales down while decoding, which takes a fraction of the time of a full decode
+    if (minWidth > 0 || minHeight > 0) {
+        for (unsigned int denom = 8; denom > 1; denom /= 2) {
+            if ((cinfo.image_width + denom - 1) / denom >= (unsigned int)minWidth && (cinfo.image_height + denom - 1) / denom >= (unsigned int)minHeight) {
+                cinfo.scale_num = 1;
+                cinfo.scale_denom = denom;
+                break;
+            }
+        }
+    }
+
     jpeg_start_decompress(&cinfo);
 
     unsigned int width = cinfo.output_width;
@@ -909,6 +929,7 @@ int ImageIO::loadPPMFromMemory(const char* buffer, int width, int height, bool s
 
 int ImageIO::savePNG  (Glib::ustring fname, int compression, volatile int bps)
 {
+    BENCHSTAGE("encode")
     if (getW() < 1 || getH() < 1) {
         return IMIO_HEADERERROR;
     }
@@ -1006,6 +1027,7 @@ int ImageIO::savePNG  (Glib::ustring fname, int compression, volatile int bps)
 // Quality 0..100, subsampling: 1=low quality, 2=medium, 3=high
 int ImageIO::saveJPEG (Glib::ustring fname, int quality, int subSamp)
 {
+    BENCHSTAGE("encode")
     if (getW() < 1 || getH() < 1) {
         return IMIO_HEADERERROR;
     }
@@ -1196,6 +1218,7 @@ int ImageIO::saveJPEG (Glib::ustring fname, int quality, int subSamp)
 
 int ImageIO::saveTIFF (Glib::ustring fname, int bps, bool uncompressed)
 {
+    BENCHSTAGE("encode")
     if (getW() < 1 || getH() < 1) {
         return IMIO_HEADERERROR;
     }
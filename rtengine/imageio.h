@@ -157,7 +157,9 @@ public:
     static int getPNGSampleFormat  (Glib::ustring fname, IIOSampleFormat &sFormat, IIOSampleArrangement &sArrangement);
     static int getTIFFSampleFormat (Glib::ustring fname, IIOSampleFormat &sFormat, IIOSampleArrangement &sArrangement);
 
-    int loadJPEGFromMemory (const char* buffer, int bufsize);
+    // The image is decoded at the smallest of the 1/1, 1/2, 1/4 and 1/8 scales which is at least minWidth x minHeight,
+    // the size of the full image is returned in fullWidth and fullHeight when they aren't null
+    int loadJPEGFromMemory (const char* buffer, int bufsize, int minWidth = 0, int minHeight = 0, int* fullWidth = nullptr, int* fullHeight = nullptr);
     int loadPPMFromMemory(const char* buffer, int width, int height, bool swap, int bps);
 
     int savePNG  (Glib::ustring fname, int compression = -1, volatile int bps = -1);
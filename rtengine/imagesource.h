@@ -31,6 +31,7 @@
 #include "image8.h"
 #include "image16.h"
 #include "imagefloat.h"
+#include "cancellation.h"
 
 namespace rtengine
 {
@@ -60,10 +61,21 @@ protected:
     ImageData* idata;
     ImageMatrices imatrices;
     double dirpyrdenoiseExpComp;
+    const CancellationToken* cancelToken;
 
 public:
     ImageSource () : references (1), redAWBMul(-1.), greenAWBMul(-1.), blueAWBMul(-1.),
-        embProfile(nullptr), idata(nullptr), dirpyrdenoiseExpComp(INFINITY) {}
+        embProfile(nullptr), idata(nullptr), dirpyrdenoiseExpComp(INFINITY), cancelToken(nullptr) {}
+
+    // The demosaicing and retinex skip their remaining work when the token is raised, see CancellationToken
+    void setCancellationToken (const CancellationToken* token)
+    {
+        cancelToken = token;
+    }
+    bool isCancelled () const
+    {
+        return cancelToken && cancelToken->isCancelled();
+    }
 
     virtual ~ImageSource            () {}
     virtual int         load        (const Glib::ustring &fname, bool batch = false) = 0;
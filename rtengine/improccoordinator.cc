@@ -24,6 +24,7 @@
 #include "colortemp.h"
 #include "improcfun.h"
 #include "iccstore.h"
+#include "tracing.h"
 #ifdef _OPENMP
 #include <omp.h>
 #endif
@@ -34,7 +35,7 @@ extern const Settings* settings;
 
 ImProcCoordinator::ImProcCoordinator ()
     : orig_prev(nullptr), oprevi(nullptr), oprevl(nullptr), nprevl(nullptr), previmg(nullptr), workimg(nullptr),
-      ncie(nullptr), imgsrc(nullptr), shmap(nullptr), lastAwbEqual(0.), ipf(&params, true), monitorIntent(RI_RELATIVE),
+      ncie(nullptr), labCache{}, imgsrc(nullptr), shmap(nullptr), lastAwbEqual(0.), ipf(&params, true), monitorIntent(RI_RELATIVE),
       softProof(false), gamutCheck(false), scale(10), highDetailPreprocessComputed(false), highDetailRawComputed(false),
       allocated(false), bwAutoR(-9000.f), bwAutoG(-9000.f), bwAutoB(-9000.f), CAMMean(NAN),
 
@@ -88,9 +89,12 @@ ImProcCoordinator::ImProcCoordinator ()
       fullw(1), fullh(1),
       pW(-1), pH(-1),
       plistener(nullptr), imageListener(nullptr), aeListener(nullptr), acListener(nullptr), abwListener(nullptr), actListener(nullptr), adnListener(nullptr), awavListener(nullptr), dehaListener(nullptr), hListener(nullptr),
+      sharedLabsGeneration(0), paramsGeneration(0),
       resultValid(false), lastOutputProfile("BADFOOD"), lastOutputIntent(RI__COUNT), lastOutputBPC(false), thread(nullptr), changeSinceLast(0), updaterRunning(false), destroying(false), utili(false), autili(false), wavcontlutili(false),
       butili(false), ccutili(false), cclutili(false), clcutili(false), opautili(false), conversionBuffer(1, 1), colourToningSatLimit(0.f), colourToningSatLimitOpacity(0.f)
-{}
+{
+    ipf.setCancellationToken (&cancelToken);
+}
 
 void ImProcCoordinator::assign (ImageSource* imgsrc)
 {
@@ -134,6 +138,14 @@ void ImProcCoordinator::updatePreviewImage (int todo, Crop* cropCall)
 {
 
     MyMutex::MyLock processingLock(mProcessing);
+    TRACE_SPAN("updatePreviewImage")
+
+    // the draft flag only concerns the detail crops
+    const int cropDraft = todo & M_DRAFT;
+    todo &= ~M_DRAFT;
+
+    unshareLab (nullptr);
+
     int numofphases = 14;
     int readyphase = 0;
 
@@ -220,7 +232,15 @@ void ImProcCoordinator::updatePreviewImage (int todo, Crop* cropCall)
             }
         }
 
+        // the image source may be shared with a batch processing, so it only sees the token during our own calls
+        imgsrc->setCancellationToken (&cancelToken);
         imgsrc->demosaic( rp);//enabled demosaic
+        imgsrc->setCancellationToken (nullptr);
+
+        if (abortIfCancelled (todo | DEMOSAIC)) {
+            return;
+        }
+
         // if a demosaic happened we should also call getimage later, so we need to set the M_INIT flag
         todo |= M_INIT;
 
@@ -247,7 +267,13 @@ void ImProcCoordinator::updatePreviewImage (int todo, Crop* cropCall)
 
         imgsrc->retinexPrepareCurves(params.retinex, cdcurve, mapcurve, dehatransmissionCurve, dehagaintransmissionCurve, dehacontlutili, mapcontlutili, useHsl, lhist16RETI, histLRETI);
         float minCD, maxCD, mini, maxi, Tmean, Tsigma, Tmin, Tmax;
+        imgsrc->setCancellationToken (&cancelToken);
         imgsrc->retinex( params.icm, params.retinex,  params.toneCurve, cdcurve, mapcurve, dehatransmissionCurve, dehagaintransmissionCurve, conversionBuffer, dehacontlutili, mapcontlutili, useHsl, minCD, maxCD, mini, maxi, Tmean, Tsigma, Tmin, Tmax, histLRETI);//enabled Retinex
+        imgsrc->setCancellationToken (nullptr);
+
+        if (abortIfCancelled (todo | RETINEX)) {
+            return;
+        }
 
         if(dehaListener) {
             dehaListener->minmaxChanged(maxCD, minCD, mini, maxi, Tmean, Tsigma, Tmin, Tmax);
@@ -603,179 +629,212 @@ void ImProcCoordinator::updatePreviewImage (int todo, Crop* cropCall)
                                        params.labCurve.lccurve, chroma_acurve, chroma_bcurve, satcurve, lhskcurve, scale == 1 ? 1 : 16);
     }
 
-    if (todo & (M_LUMINANCE + M_COLOR) ) {
-        nprevl->CopyFrom(oprevl);
+    // The Lab pipeline is resumed from the first stage whose parameters changed
+    LabStage entryStage = LAB_DONE;
 
-        progress ("Applying Color Boost...", 100 * readyphase / numofphases);
-        //   ipf.MSR(nprevl, nprevl->W, nprevl->H, 1);
-        histCCurve.clear();
-        histLCurve.clear();
-        ipf.chromiLuminanceCurve (nullptr, pW, nprevl, nprevl, chroma_acurve, chroma_bcurve, satcurve, lhskcurve, clcurve, lumacurve, utili, autili, butili, ccutili, cclutili, clcutili, histCCurve, histLCurve);
-        ipf.vibrance(nprevl);
+    if (todo & (M_LUMINANCE + M_COLOR)) {
+        entryStage = LAB_CURVES;
+    } else if (todo & M_WAVELET) {
+        entryStage = getLabEntryStage (LAB_WAVELET);
+    } else if (todo & M_CIECAM) {
+        entryStage = getLabEntryStage (LAB_CIECAM);
+    }
 
-        if((params.colorappearance.enabled && !params.colorappearance.tonecie) ||  (!params.colorappearance.enabled)) {
-            ipf.EPDToneMap(nprevl, 5, 1);
-        }
+    if (entryStage < LAB_DONE) {
+        if (entryStage == LAB_CURVES) {
+            nprevl->CopyFrom(oprevl);
 
-        // for all treatments Defringe, Sharpening, Contrast detail , Microcontrast they are activated if "CIECAM" function are disabled
-        readyphase++;
+            progress ("Applying Color Boost...", 100 * readyphase / numofphases);
+            //   ipf.MSR(nprevl, nprevl->W, nprevl->H, 1);
+            histCCurve.clear();
+            histLCurve.clear();
+            ipf.chromiLuminanceCurve (nullptr, pW, nprevl, nprevl, chroma_acurve, chroma_bcurve, satcurve, lhskcurve, clcurve, lumacurve, utili, autili, butili, ccutili, cclutili, clcutili, histCCurve, histLCurve);
+            ipf.vibrance(nprevl);
 
-        /* Issue 2785, disabled some 1:1 tools
-                if (scale==1) {
-                    if((params.colorappearance.enabled && !settings->autocielab) || (!params.colorappearance.enabled)){
-                        progress ("Denoising luminance impulse...",100*readyphase/numofphases);
-                        ipf.impulsedenoise (nprevl);
-                        readyphase++;
-                    }
-                    if((params.colorappearance.enabled && !settings->autocielab) || (!params.colorappearance.enabled)){
-                        progress ("Defringing...",100*readyphase/numofphases);
-                        ipf.defringe (nprevl);
-                        readyphase++;
-                    }
-                    if (params.sharpenEdge.enabled) {
-                        progress ("Edge sharpening...",100*readyphase/numofphases);
-                        ipf.MLsharpen (nprevl);
-                        readyphase++;
-                    }
-                    if (params.sharpenMicro.enabled) {
-                        if(( params.colorappearance.enabled && !settings->autocielab) || (!params.colorappearance.enabled)){
-                            progress ("Microcontrast...",100*readyphase/numofphases);
-                            ipf.MLmicrocontrast (nprevl);
+            if((params.colorappearance.enabled && !params.colorappearance.tonecie) ||  (!params.colorappearance.enabled)) {
+                ipf.EPDToneMap(nprevl, 5, 1);
+            }
+
+            // for all treatments Defringe, Sharpening, Contrast detail , Microcontrast they are activated if "CIECAM" function are disabled
+            readyphase++;
+
+            /* Issue 2785, disabled some 1:1 tools
+                    if (scale==1) {
+                        if((params.colorappearance.enabled && !settings->autocielab) || (!params.colorappearance.enabled)){
+                            progress ("Denoising luminance impulse...",100*readyphase/numofphases);
+                            ipf.impulsedenoise (nprevl);
                             readyphase++;
                         }
-                    }
-                    if(((params.colorappearance.enabled && !settings->autocielab) || (!params.colorappearance.enabled)) && params.sharpening.enabled) {
-                        progress ("Sharpening...",100*readyphase/numofphases);
+                        if((params.colorappearance.enabled && !settings->autocielab) || (!params.colorappearance.enabled)){
+                            progress ("Defringing...",100*readyphase/numofphases);
+                            ipf.defringe (nprevl);
+                            readyphase++;
+                        }
+                        if (params.sharpenEdge.enabled) {
+                            progress ("Edge sharpening...",100*readyphase/numofphases);
+                            ipf.MLsharpen (nprevl);
+                            readyphase++;
+                        }
+                        if (params.sharpenMicro.enabled) {
+                            if(( params.colorappearance.enabled && !settings->autocielab) || (!params.colorappearance.enabled)){
+                                progress ("Microcontrast...",100*readyphase/numofphases);
+                                ipf.MLmicrocontrast (nprevl);
+                                readyphase++;
+                            }
+                        }
+                        if(((params.colorappearance.enabled && !settings->autocielab) || (!params.colorappearance.enabled)) && params.sharpening.enabled) {
+                            progress ("Sharpening...",100*readyphase/numofphases);
 
-                        float **buffer = new float*[pH];
-                        for (int i=0; i<pH; i++)
-                            buffer[i] = new float[pW];
+                            float **buffer = new float*[pH];
+                            for (int i=0; i<pH; i++)
+                                buffer[i] = new float[pW];
 
-                        ipf.sharpening (nprevl, (float**)buffer);
+                            ipf.sharpening (nprevl, (float**)buffer);
 
-                        for (int i=0; i<pH; i++)
-                            delete [] buffer[i];
-                        delete [] buffer;
-                        readyphase++;
+                            for (int i=0; i<pH; i++)
+                                delete [] buffer[i];
+                            delete [] buffer;
+                            readyphase++;
+                        }
                     }
+            */
+            if(params.dirpyrequalizer.cbdlMethod == "aft") {
+                if(((params.colorappearance.enabled && !settings->autocielab) || (!params.colorappearance.enabled)) ) {
+                    progress ("Pyramid wavelet...", 100 * readyphase / numofphases);
+                    ipf.dirpyrequalizer (nprevl, scale);
+                    //ipf.Lanczoslab (ip_wavelet(LabImage * lab, LabImage * dst, const procparams::EqualizerParams & eqparams), nprevl, 1.f/scale);
+                    readyphase++;
                 }
-        */
-        if(params.dirpyrequalizer.cbdlMethod == "aft") {
-            if(((params.colorappearance.enabled && !settings->autocielab) || (!params.colorappearance.enabled)) ) {
-                progress ("Pyramid wavelet...", 100 * readyphase / numofphases);
-                ipf.dirpyrequalizer (nprevl, scale);
-                //ipf.Lanczoslab (ip_wavelet(LabImage * lab, LabImage * dst, const procparams::EqualizerParams & eqparams), nprevl, 1.f/scale);
-                readyphase++;
+            }
+
+            cacheLabStage (LAB_WAVELET);
+        } else {
+            nprevl->CopyFrom (labCache[entryStage]);
+
+            if (settings->verbose) {
+                printf ("Lab pipeline of the preview resumed at stage %d\n", (int)entryStage);
             }
         }
 
+        if (entryStage <= LAB_WAVELET) {
+            wavcontlutili = false;
+            //CurveFactory::curveWavContL ( wavcontlutili,params.wavelet.lcurve, wavclCurve, LUTu & histogramwavcl, LUTu & outBeforeWavCLurveHistogram,int skip);
+            CurveFactory::curveWavContL(wavcontlutili, params.wavelet.wavclCurve, wavclCurve, scale == 1 ? 1 : 16);
 
-        wavcontlutili = false;
-        //CurveFactory::curveWavContL ( wavcontlutili,params.wavelet.lcurve, wavclCurve, LUTu & histogramwavcl, LUTu & outBeforeWavCLurveHistogram,int skip);
-        CurveFactory::curveWavContL(wavcontlutili, params.wavelet.wavclCurve, wavclCurve, scale == 1 ? 1 : 16);
 
+            if((params.wavelet.enabled)) {
+                WaveletParams WaveParams = params.wavelet;
+                //      WaveParams.getCurves(wavCLVCurve, waOpacityCurveRG, waOpacityCurveBY);
+                WaveParams.getCurves(wavCLVCurve, waOpacityCurveRG, waOpacityCurveBY, waOpacityCurveW, waOpacityCurveWL);
 
-        if((params.wavelet.enabled)) {
-            WaveletParams WaveParams = params.wavelet;
-            //      WaveParams.getCurves(wavCLVCurve, waOpacityCurveRG, waOpacityCurveBY);
-            WaveParams.getCurves(wavCLVCurve, waOpacityCurveRG, waOpacityCurveBY, waOpacityCurveW, waOpacityCurveWL);
+                int kall = 0;
+                progress ("Wavelet...", 100 * readyphase / numofphases);
+                //  ipf.ip_wavelet(nprevl, nprevl, kall, WaveParams, wavCLVCurve, waOpacityCurveRG, waOpacityCurveBY, scale);
+                ipf.ip_wavelet(nprevl, nprevl, kall, WaveParams, wavCLVCurve, waOpacityCurveRG, waOpacityCurveBY, waOpacityCurveW, waOpacityCurveWL, wavclCurve, wavcontlutili, scale);
 
-            int kall = 0;
-            progress ("Wavelet...", 100 * readyphase / numofphases);
-            //  ipf.ip_wavelet(nprevl, nprevl, kall, WaveParams, wavCLVCurve, waOpacityCurveRG, waOpacityCurveBY, scale);
-            ipf.ip_wavelet(nprevl, nprevl, kall, WaveParams, wavCLVCurve, waOpacityCurveRG, waOpacityCurveBY, waOpacityCurveW, waOpacityCurveWL, wavclCurve, wavcontlutili, scale);
+                if (abortIfCancelled (todo)) {
+                    return;
+                }
+            }
 
+            cacheLabStage (LAB_CIECAM);
         }
 
+        if (entryStage <= LAB_CIECAM) {
+            if(params.colorappearance.enabled) {
+                //L histo  and Chroma histo for ciecam
+                // histogram well be for Lab (Lch) values, because very difficult to do with J,Q, M, s, C
+                int x1, y1, x2, y2;
+                params.crop.mapToResized(pW, pH, scale, x1, x2,  y1, y2);
+                lhist16CAM.clear();
+                lhist16CCAM.clear();
+
+                if(!params.colorappearance.datacie) {
+                    for (int x = 0; x < pH; x++)
+                        for (int y = 0; y < pW; y++) {
+                            int pos = CLIP((int)(nprevl->L[x][y]));
+                            int posc = CLIP((int)sqrt(nprevl->a[x][y] * nprevl->a[x][y] + nprevl->b[x][y] * nprevl->b[x][y]));
+                            lhist16CAM[pos]++;
+                            lhist16CCAM[posc]++;
+                        }
+                }
 
-        if(params.colorappearance.enabled) {
-            //L histo  and Chroma histo for ciecam
-            // histogram well be for Lab (Lch) values, because very difficult to do with J,Q, M, s, C
-            int x1, y1, x2, y2;
-            params.crop.mapToResized(pW, pH, scale, x1, x2,  y1, y2);
-            lhist16CAM.clear();
-            lhist16CCAM.clear();
-
-            if(!params.colorappearance.datacie) {
-                for (int x = 0; x < pH; x++)
-                    for (int y = 0; y < pW; y++) {
-                        int pos = CLIP((int)(nprevl->L[x][y]));
-                        int posc = CLIP((int)sqrt(nprevl->a[x][y] * nprevl->a[x][y] + nprevl->b[x][y] * nprevl->b[x][y]));
-                        lhist16CAM[pos]++;
-                        lhist16CCAM[posc]++;
-                    }
-            }
-
-            CurveFactory::curveLightBrightColor (params.colorappearance.curve, params.colorappearance.curve2, params.colorappearance.curve3,
-                                                 lhist16CAM, histLCAM, lhist16CCAM, histCCAM,
-                                                 customColCurve1, customColCurve2, customColCurve3, 1);
-            float fnum = imgsrc->getMetaData()->getFNumber  ();        // F number
-            float fiso = imgsrc->getMetaData()->getISOSpeed () ;       // ISO
-            float fspeed = imgsrc->getMetaData()->getShutterSpeed () ; // Speed
-            double fcomp = imgsrc->getMetaData()->getExpComp  ();      // Compensation +/-
-            double adap;
-
-            if(fnum < 0.3f || fiso < 5.f || fspeed < 0.00001f) { //if no exif data or wrong
-                adap = 2000.;
-            } else {
-                double E_V = fcomp + log2 (double((fnum * fnum) / fspeed / (fiso / 100.f)));
-                E_V += params.toneCurve.expcomp;// exposure compensation in tonecurve ==> direct EV
-                E_V += log2(params.raw.expos);// exposure raw white point ; log2 ==> linear to EV
-                adap = powf(2.f, E_V - 3.f); // cd / m2
-                // end calculation adaptation scene luminosity
-            }
+                CurveFactory::curveLightBrightColor (params.colorappearance.curve, params.colorappearance.curve2, params.colorappearance.curve3,
+                                                     lhist16CAM, histLCAM, lhist16CCAM, histCCAM,
+                                                     customColCurve1, customColCurve2, customColCurve3, 1);
+                float fnum = imgsrc->getMetaData()->getFNumber  ();        // F number
+                float fiso = imgsrc->getMetaData()->getISOSpeed () ;       // ISO
+                float fspeed = imgsrc->getMetaData()->getShutterSpeed () ; // Speed
+                double fcomp = imgsrc->getMetaData()->getExpComp  ();      // Compensation +/-
+                double adap;
+
+                if(fnum < 0.3f || fiso < 5.f || fspeed < 0.00001f) { //if no exif data or wrong
+                    adap = 2000.;
+                } else {
+                    double E_V = fcomp + log2 (double((fnum * fnum) / fspeed / (fiso / 100.f)));
+                    E_V += params.toneCurve.expcomp;// exposure compensation in tonecurve ==> direct EV
+                    E_V += log2(params.raw.expos);// exposure raw white point ; log2 ==> linear to EV
+                    adap = powf(2.f, E_V - 3.f); // cd / m2
+                    // end calculation adaptation scene luminosity
+                }
 
-            int begh = 0;
-            int endh = pH;
-            float d;
-            bool execsharp = false;
+                int begh = 0;
+                int endh = pH;
+                float d;
+                bool execsharp = false;
 
-            if(!ncie) {
-                ncie = new CieImage (pW, pH);
-            }
+                if(!ncie) {
+                    ncie = new CieImage (pW, pH);
+                }
 
-            if (!CAMBrightCurveJ && (params.colorappearance.algo == "JC" || params.colorappearance.algo == "JS" || params.colorappearance.algo == "ALL")) {
-                CAMBrightCurveJ(32768, 0);
-            }
+                if (!CAMBrightCurveJ && (params.colorappearance.algo == "JC" || params.colorappearance.algo == "JS" || params.colorappearance.algo == "ALL")) {
+                    CAMBrightCurveJ(32768, 0);
+                }
 
-            if (!CAMBrightCurveQ && (params.colorappearance.algo == "QM" || params.colorappearance.algo == "ALL")) {
-                CAMBrightCurveQ(32768, 0);
-            }
+                if (!CAMBrightCurveQ && (params.colorappearance.algo == "QM" || params.colorappearance.algo == "ALL")) {
+                    CAMBrightCurveQ(32768, 0);
+                }
 
-            // Issue 2785, only float version of ciecam02 for navigator and pan background
-            CAMMean = NAN;
-            CAMBrightCurveJ.dirty = true;
-            CAMBrightCurveQ.dirty = true;
+                // Issue 2785, only float version of ciecam02 for navigator and pan background
+                CAMMean = NAN;
+                CAMBrightCurveJ.dirty = true;
+                CAMBrightCurveQ.dirty = true;
 
-            ipf.ciecam_02float (ncie, float(adap), begh, endh, pW, 2, nprevl, &params, customColCurve1, customColCurve2, customColCurve3, histLCAM, histCCAM, CAMBrightCurveJ, CAMBrightCurveQ, CAMMean, 5, 1, execsharp, d, scale, 1);
+                ipf.ciecam_02float (ncie, float(adap), begh, endh, pW, 2, nprevl, &params, customColCurve1, customColCurve2, customColCurve3, histLCAM, histCCAM, CAMBrightCurveJ, CAMBrightCurveQ, CAMMean, 5, 1, execsharp, d, scale, 1);
 
-            if(params.colorappearance.autodegree && acListener && params.colorappearance.enabled) {
-                acListener->autoCamChanged(100.*(double)d);
-            }
+                if(params.colorappearance.autodegree && acListener && params.colorappearance.enabled) {
+                    acListener->autoCamChanged(100.*(double)d);
+                }
 
-            if(params.colorappearance.autoadapscen && acListener && params.colorappearance.enabled) {
-                acListener->adapCamChanged(adap);    //real value of adapt scene luminosity
-            }
+                if(params.colorappearance.autoadapscen && acListener && params.colorappearance.enabled) {
+                    acListener->adapCamChanged(adap);    //real value of adapt scene luminosity
+                }
 
-            readyphase++;
-        } else {
-            // CIECAM is disabled, we free up its image buffer to save some space
-            if (ncie) {
-                delete ncie;
-            }
+                readyphase++;
+            } else {
+                // CIECAM is disabled, we free up its image buffer to save some space
+                if (ncie) {
+                    delete ncie;
+                }
 
-            ncie = nullptr;
+                ncie = nullptr;
 
-            if (CAMBrightCurveJ) {
-                CAMBrightCurveJ.reset();
-            }
+                if (CAMBrightCurveJ) {
+                    CAMBrightCurveJ.reset();
+                }
 
-            if (CAMBrightCurveQ) {
-                CAMBrightCurveQ.reset();
+                if (CAMBrightCurveQ) {
+                    CAMBrightCurveQ.reset();
+                }
             }
         }
     }
 
+    // the 1:1 tools are only applied by the crops, and the preview always uses the float version of CIECAM
+    if (scale > 1 && (settings->ciecamfloat || !params.colorappearance.enabled)) {
+        shareLab (nullptr, scale, 0, 0, nprevl, 0, 0, pW, pH);
+    }
+
     // Update the monitor color transform if necessary
     if ((todo & M_MONITOR) || (lastOutputProfile!=params.icm.output) || lastOutputIntent!=params.icm.outputIntent || lastOutputBPC!=params.icm.outputBPC) {
         lastOutputProfile = params.icm.output;
@@ -787,7 +846,7 @@ void ImProcCoordinator::updatePreviewImage (int todo, Crop* cropCall)
     // process crop, if needed
     for (size_t i = 0; i < crops.size(); i++)
         if (crops[i]->hasListener () && cropCall != crops[i] ) {
-            crops[i]->update (todo);    // may call ourselves
+            crops[i]->update (todo | cropDraft);    // may call ourselves
         }
 
     progress ("Conversion to RGB...", 100 * readyphase / numofphases);
@@ -871,11 +930,69 @@ void ImProcCoordinator::freeAll ()
 
         shmap = nullptr;
 
+        freeLabCache ();
+        unshareLab (nullptr);
     }
 
     allocated = false;
 }
 
+void ImProcCoordinator::freeLabCache ()
+{
+    for (int i = LAB_CURVES; i < LAB_DONE; i++) {
+        delete labCache[i];
+        labCache[i] = nullptr;
+    }
+}
+
+ImProcCoordinator::LabStage ImProcCoordinator::getLabEntryStage (LabStage stage) const
+{
+    // a disabled stage leaves nprevl untouched, so the pipeline starts at the next one
+    if (stage == LAB_WAVELET && !params.wavelet.enabled) {
+        stage = LAB_CIECAM;
+    }
+
+    if (stage == LAB_CIECAM && !params.colorappearance.enabled) {
+        stage = LAB_DONE;
+    }
+
+    // otherwise it falls back to the closest upstream stage whose input has been kept
+    while (stage > LAB_CURVES && stage < LAB_DONE && !labCache[stage]) {
+        stage = LabStage(stage - 1);
+    }
+
+    return stage;
+}
+
+void ImProcCoordinator::cacheLabStage (LabStage stage)
+{
+    bool keep = stage == LAB_WAVELET ? params.wavelet.enabled : params.colorappearance.enabled;
+
+    if (keep) {
+        const std::size_t imageSize = std::size_t(pW) * pH * 3 * sizeof(float);
+        std::size_t needed = imageSize;
+
+        // when there is only room for one image, the input of CIECAM has precedence as it skips the most processing
+        if (stage == LAB_WAVELET && params.colorappearance.enabled) {
+            needed += imageSize;
+        }
+
+        keep = needed <= (std::size_t(std::max(settings->previewCacheSize, 0)) << 20);
+    }
+
+    if (!keep) {
+        delete labCache[stage];
+        labCache[stage] = nullptr;
+        return;
+    }
+
+    if (!labCache[stage]) {
+        labCache[stage] = new LabImage (pW, pH);
+    }
+
+    labCache[stage]->CopyFrom (nprevl);
+}
+
 /** @brief Handles image buffer (re)allocation and trigger sizeChanged of SizeListener[s]
  * If the scale change, this method will free all buffers and reallocate ones of the new size.
  * It will then tell to the SizeListener that size has changed (sizeChanged)
@@ -1284,6 +1401,11 @@ void ImProcCoordinator::startProcessing(int changeCode)
 {
     paramsUpdateMutex.lock();
     changeSinceLast |= changeCode;
+
+    if (changeCode & (M_VOID - 1)) {
+        cancelToken.cancel ();
+    }
+
     paramsUpdateMutex.unlock();
 
     startProcessing ();
@@ -1301,14 +1423,26 @@ void ImProcCoordinator::process ()
         params = nextParams;
         int change = changeSinceLast;
         changeSinceLast = 0;
+        cancelToken.reset ();
+        {
+            MyMutex::MyLock lock(sharedLabsMutex);
+            paramsGeneration++;
+        }
         paramsUpdateMutex.unlock ();
 
         // M_VOID means no update, and is a bit higher that the rest
         if (change & (M_VOID - 1)) {
-            updatePreviewImage (change);
+            // the detail crops are drafted first, and refined once no other change is pending
+            updatePreviewImage (change | M_DRAFT);
         }
 
         paramsUpdateMutex.lock ();
+
+        if (!changeSinceLast) {
+            paramsUpdateMutex.unlock ();
+            refineCrops ();
+            paramsUpdateMutex.lock ();
+        }
     }
 
     paramsUpdateMutex.unlock ();
@@ -1319,6 +1453,106 @@ void ImProcCoordinator::process ()
     }
 }
 
+bool ImProcCoordinator::canShareLab () const
+{
+    // the wavelets and the shadows/highlights map compute statistics on the image (the crops only force some of them
+    // to the values of the preview), and the edge preserving tone mapping is a global solver
+    return !params.wavelet.enabled && !params.epd.enabled && !params.sh.enabled;
+}
+
+void ImProcCoordinator::shareLab (const Crop* owner, int skip, int x, int y, const LabImage* image, int validX, int validY, int validW, int validH)
+{
+    if (!canShareLab()) {
+        return;
+    }
+
+    MyMutex::MyLock lock(sharedLabsMutex);
+
+    if (sharedLabsGeneration != paramsGeneration) {
+        sharedLabs.clear();
+        sharedLabsGeneration = paramsGeneration;
+    }
+
+    for (auto& shared : sharedLabs) {
+        if (shared.owner == owner) {
+            shared = {owner, skip, x, y, image, validX, validY, validW, validH};
+            return;
+        }
+    }
+
+    sharedLabs.push_back({owner, skip, x, y, image, validX, validY, validW, validH});
+}
+
+void ImProcCoordinator::unshareLab (const Crop* owner)
+{
+    MyMutex::MyLock lock(sharedLabsMutex);
+
+    for (auto shared = sharedLabs.begin(); shared != sharedLabs.end(); ++shared) {
+        if (shared->owner == owner) {
+            sharedLabs.erase(shared);
+            return;
+        }
+    }
+}
+
+bool ImProcCoordinator::copySharedLab (int skip, int x, int y, LabImage* dst, int dstX, int dstY, int w, int h)
+{
+    if (!canShareLab()) {
+        return false;
+    }
+
+    MyMutex::MyLock lock(sharedLabsMutex);
+
+    if (sharedLabsGeneration != paramsGeneration) {
+        return false;
+    }
+
+    for (const auto& shared : sharedLabs) {
+        // the pixels have to be on the same sampling grid
+        if (shared.skip != skip || (x - shared.x) % skip || (y - shared.y) % skip) {
+            continue;
+        }
+
+        const int srcX = (x - shared.x) / skip + dstX;
+        const int srcY = (y - shared.y) / skip + dstY;
+
+        if (srcX < shared.validX || srcY < shared.validY || srcX + w > shared.validX + shared.validW || srcY + h > shared.validY + shared.validH) {
+            continue;
+        }
+
+        for (int i = 0; i < h; i++) {
+            memcpy(dst->L[dstY + i] + dstX, shared.image->L[srcY + i] + srcX, w * sizeof(float));
+            memcpy(dst->a[dstY + i] + dstX, shared.image->a[srcY + i] + srcX, w * sizeof(float));
+            memcpy(dst->b[dstY + i] + dstX, shared.image->b[srcY + i] + srcX, w * sizeof(float));
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+bool ImProcCoordinator::abortIfCancelled (int todo)
+{
+    if (!cancelToken.isCancelled()) {
+        return false;
+    }
+
+    MyMutex::MyLock lock(paramsUpdateMutex);
+    changeSinceLast |= todo;
+    return true;
+}
+
+void ImProcCoordinator::refineCrops ()
+{
+    MyMutex::MyLock processingLock(mProcessing);
+
+    for (size_t i = 0; i < crops.size(); i++)
+        if (crops[i]->hasListener ()) {
+            crops[i]->refine ();
+        }
+}
+
 ProcParams* ImProcCoordinator::beginUpdateParams ()
 {
     paramsUpdateMutex.lock ();
@@ -1335,6 +1569,11 @@ void ImProcCoordinator::endUpdateParams (int changeFlags)
 {
     changeSinceLast |= changeFlags;
 
+    // the running update is superseded, unless the change does not touch the image
+    if (changeFlags & (M_VOID - 1)) {
+        cancelToken.cancel ();
+    }
+
     paramsUpdateMutex.unlock ();
     startProcessing ();
 }
@@ -24,6 +24,7 @@
 #include "image8.h"
 #include "image16.h"
 #include "imagesource.h"
+#include "cancellation.h"
 #include "procevents.h"
 #include "dcrop.h"
 #include "LUT.h"
@@ -61,6 +62,15 @@ protected:
     Image8 *workimg;  // internal image in output color space for analysis
     CieImage *ncie;
 
+    // Stages of the Lab pipeline of the preview which can be resumed, in processing order
+    enum LabStage {
+        LAB_CURVES,     // input: oprevl
+        LAB_WAVELET,
+        LAB_CIECAM,
+        LAB_DONE
+    };
+    LabImage *labCache[LAB_DONE];   // cached input of each stage, nullptr if it has not been kept
+
     ImageSource* imgsrc;
 
     SHMap* shmap;
@@ -83,6 +93,11 @@ protected:
     bool allocated;
 
     void freeAll ();
+    void freeLabCache ();
+    // Returns the stage from which the Lab pipeline has to be rerun when the parameters of 'stage' changed
+    LabStage getLabEntryStage (LabStage stage) const;
+    // Keeps nprevl as the input of 'stage', if the stage is enabled and the image fits in the memory budget
+    void cacheLabStage (LabStage stage);
 
     // Precomputed values used by DetailedCrop ----------------------------------------------
 
@@ -166,6 +181,27 @@ protected:
 
     std::vector<Crop*> crops;
 
+    // A Lab image computed for the current parameters, from which the detail crops lying inside it copy their own
+    // image instead of processing it. The preview and the crops at full quality are shared, see Crop::update
+    struct SharedLab {
+        const Crop* owner;      // nullptr for the preview
+        int skip;
+        int x, y;               // position of the pixel (0, 0) of the image in the full image
+        const LabImage* image;
+        int validX, validY, validW, validH; // part of the image which is not a processing border
+    };
+    std::vector<SharedLab> sharedLabs;
+    unsigned int sharedLabsGeneration;
+    unsigned int paramsGeneration;  // incremented each time the updater takes new parameters
+    MyMutex sharedLabsMutex;
+
+    // false when a tool computes its result from the whole processed image, so that the same pixels differ between images
+    bool canShareLab   () const;
+    void shareLab      (const Crop* owner, int skip, int x, int y, const LabImage* image, int validX, int validY, int validW, int validH);
+    void unshareLab    (const Crop* owner);
+    // Copies the w*h pixels at (dstX, dstY) of dst, whose pixel (0, 0) is at (x, y) in the full image, from a shared image
+    bool copySharedLab (int skip, int x, int y, LabImage* dst, int dstX, int dstY, int w, int h);
+
     bool resultValid;
 
     MyMutex minit;  // to gain mutually exclusive access to ... to what exactly?
@@ -175,6 +211,10 @@ protected:
     void updateLRGBHistograms ();
     void setScale (int prevscale);
     void updatePreviewImage (int todo, Crop* cropCall = nullptr);
+    // Returns true if newer parameters superseded the running update; its steps 'todo' are then queued again
+    bool abortIfCancelled (int todo);
+    // Brings the detail crops drafted by updatePreviewImage to full quality
+    void refineCrops ();
 
     MyMutex mProcessing;
     ProcParams params;
@@ -191,6 +231,7 @@ protected:
     MyMutex updaterThreadStart;
     MyMutex paramsUpdateMutex;
     int  changeSinceLast;
+    CancellationToken cancelToken; // raised when changeSinceLast is set during an update
     bool updaterRunning;
     ProcParams nextParams;
     bool destroying;
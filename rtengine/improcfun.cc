@@ -40,6 +40,7 @@
 #include "improccoordinator.h"
 #include "clutstore.h"
 #include "ciecam02.h"
+#include "cpufeatures.h"
 //#define BENCHMARK
 #include "StopWatch.h"
 #include "../rtgui/ppversion.h"
@@ -55,14 +56,6 @@ using namespace procparams;
 
 extern const Settings* settings;
 
-ImProcFunctions::~ImProcFunctions ()
-{
-
-    if (monitorTransform) {
-        cmsDeleteTransform (monitorTransform);
-    }
-}
-
 void ImProcFunctions::setScale (double iscale)
 {
     scale = iscale;
@@ -71,11 +64,7 @@ void ImProcFunctions::setScale (double iscale)
 void ImProcFunctions::updateColorProfiles (const Glib::ustring& monitorProfile, RenderingIntent monitorIntent, bool softProof, bool gamutCheck)
 {
     // set up monitor transform
-    if (monitorTransform) {
-        cmsDeleteTransform (monitorTransform);
-    }
-
-    monitorTransform = nullptr;
+    monitorTransform.reset();
 
     cmsHPROFILE monitor = nullptr;
     if (!monitorProfile.empty()) {
@@ -87,10 +76,8 @@ void ImProcFunctions::updateColorProfiles (const Glib::ustring& monitorProfile,
     }
 
     if (monitor) {
-        MyMutex::MyLock lcmsLock (*lcmsMutex);
-
         cmsUInt32Number flags;
-        cmsHPROFILE iprof  = cmsCreateLab4Profile(nullptr);
+        cmsHPROFILE iprof = iccStore->getLabProfile();
 
         bool softProofCreated = false;
 
@@ -109,12 +96,11 @@ void ImProcFunctions::updateColorProfiles (const Glib::ustring& monitorProfile,
                 if (gamutCheck) {
                     flags |= cmsFLAGS_GAMUTCHECK;
                 }
-                monitorTransform = cmsCreateProofingTransform(
+                monitorTransform = iccStore->getTransform(
                                         iprof, TYPE_Lab_FLT,
                                         monitor, TYPE_RGB_8,
-                                        oprof,
-                                        monitorIntent, settings->printerIntent,
-                                        flags
+                                        monitorIntent, flags,
+                                        oprof, settings->printerIntent
                                     );
                 if (monitorTransform) {
                     softProofCreated = true;
@@ -127,10 +113,8 @@ void ImProcFunctions::updateColorProfiles (const Glib::ustring& monitorProfile,
             if (settings->monitorBPC) {
                 flags |= cmsFLAGS_BLACKPOINTCOMPENSATION;
             }
-            monitorTransform = cmsCreateTransform (iprof, TYPE_Lab_FLT, monitor, TYPE_RGB_8, monitorIntent, flags);
+            monitorTransform = iccStore->getTransform (iprof, TYPE_Lab_FLT, monitor, TYPE_RGB_8, monitorIntent, flags);
         }
-
-        cmsCloseProfile(iprof);
     }
 }
 
@@ -1454,6 +1438,7 @@ void ImProcFunctions::ciecam_02float (CieImage* ncie, float adap, int begh, int
                                       const ColorAppearance & customColCurve1, const ColorAppearance & customColCurve2, const ColorAppearance & customColCurve3,
                                       LUTu & histLCAM, LUTu & histCCAM, LUTf & CAMBrightCurveJ, LUTf & CAMBrightCurveQ, float &mean, int Iterates, int scale, bool execsharp, float &d, int scalecd, int rtt)
 {
+    BENCHSTAGE("ciecam")
     if(params->colorappearance.enabled) {
 
 #ifdef _DEBUG
@@ -3293,6 +3278,7 @@ void ImProcFunctions::rgbProc (Imagefloat* working, LabImage* lab, PipetteBuffer
     #pragma omp parallel if (multiThread)
 #endif
     {
+        TRACE_SPAN("rgbProc worker")
         char *buffer;
         char *editIFloatBuffer = nullptr;
         char *editWhateverBuffer = nullptr;
@@ -3478,13 +3464,13 @@ void ImProcFunctions::rgbProc (Imagefloat* working, LabImage* lab, PipetteBuffer
                 }
 
                 for (int i = istart, ti = 0; i < tH; i++, ti++) {
-                    for (int j = jstart, tj = 0; j < tW; j++, tj++) {
+                    //brightness/contrast
+                    tonecurve.apply(&rtemp[ti * TS], &rtemp[ti * TS], tW - jstart);
+                    tonecurve.apply(&gtemp[ti * TS], &gtemp[ti * TS], tW - jstart);
+                    tonecurve.apply(&btemp[ti * TS], &btemp[ti * TS], tW - jstart);
 
-                        //brightness/contrast
-                        rtemp[ti * TS + tj] = tonecurve[ rtemp[ti * TS + tj] ];
-                        gtemp[ti * TS + tj] = tonecurve[ gtemp[ti * TS + tj] ];
-                        btemp[ti * TS + tj] = tonecurve[ btemp[ti * TS + tj] ];
-                        if(histToneCurveThr) {
+                    if(histToneCurveThr) {
+                        for (int j = jstart, tj = 0; j < tW; j++, tj++) {
                             int y = CLIP<int>(lumimulf[0] * Color::gamma2curve[rtemp[ti * TS + tj]] + lumimulf[1] * Color::gamma2curve[gtemp[ti * TS + tj]] + lumimulf[2] * Color::gamma2curve[btemp[ti * TS + tj]]);
                             histToneCurveThr[y>>histToneCurveCompression]++;
                         }
@@ -5441,12 +5427,9 @@ void ImProcFunctions::luminanceCurve (LabImage* lold, LabImage* lnew, LUTf & cur
 
     #pragma omp parallel for if (multiThread)
 
-    for (int i = 0; i < H; i++)
-        for (int j = 0; j < W; j++) {
-            float Lin = lold->L[i][j];
-            //if (Lin>0 && Lin<65535)
-            lnew->L[i][j] = curve[Lin];
-        }
+    for (int i = 0; i < H; i++) {
+        curve.apply(lold->L[i], lnew->L[i], W);
+    }
 }
 
 
@@ -5665,6 +5648,7 @@ SSEFUNCTION void ImProcFunctions::chromiLuminanceCurve (PipetteBuffer *pipetteBu
 #ifdef __SSE2__
         float HHBuffer[W] ALIGNED16;
         float CCBuffer[W] ALIGNED16;
+        float LBuffer[W] ALIGNED16;
 #endif
         #pragma omp for schedule(dynamic, 16)
 
@@ -5697,6 +5681,8 @@ SSEFUNCTION void ImProcFunctions::chromiLuminanceCurve (PipetteBuffer *pipetteBu
                 }
             }
 
+            curve.apply(lold->L[i], LBuffer, W);
+
 #endif // __SSE2__
 
             for (int j = 0; j < W; j++) {
@@ -5737,7 +5723,11 @@ SSEFUNCTION void ImProcFunctions::chromiLuminanceCurve (PipetteBuffer *pipetteBu
                     editWhatever->v(i, j) = LIM01<float>(Lin / 32768.0f);    // Lab L pipette
                 }
 
+#ifdef __SSE2__
+                lnew->L[i][j] = LBuffer[j];
+#else
                 lnew->L[i][j] = curve[Lin];
+#endif
 
                 float Lprov1 = (lnew->L[i][j]) / 327.68f;
 
@@ -6981,6 +6971,66 @@ double ImProcFunctions::getAutoDistor  (const Glib::ustring &fname, int thumb_si
     }
 }
 
+#ifdef RT_MULTIVERSIONING
+namespace
+{
+
+// Same as Color::Lab2XYZ followed by Color::xyz2rgb, written without intrinsics so that the callers below get it
+// vectorized for their own instruction set
+inline __attribute__((always_inline)) void lab2rgbRow(const float* L, const float* a, const float* b, float* R, float* G, float* B, const int W, const float wip[3][3])
+{
+    const float epskap = Color::epskap;
+    const float kappa = Color::kappa;
+    const float D50x = Color::D50x;
+    const float D50z = Color::D50z;
+
+    for (int j = 0; j < W; j++) {
+        const float LL = L[j] / 327.68f;
+        const float fy = (0.00862069f * LL) + 0.137932f; // (L+16)/116
+        const float fx = (0.002f * (a[j] / 327.68f)) + fy;
+        const float fz = fy - (0.005f * (b[j] / 327.68f));
+        const float X = 65535.0f * Color::f2xyz(fx) * D50x;
+        const float Z = 65535.0f * Color::f2xyz(fz) * D50z;
+        const float Y = (LL > epskap) ? 65535.0f * fy * fy * fy : 65535.0f * LL / kappa;
+        R[j] = wip[0][0] * X + wip[0][1] * Y + wip[0][2] * Z;
+        G[j] = wip[1][0] * X + wip[1][1] * Y + wip[1][2] * Z;
+        B[j] = wip[2][0] * X + wip[2][1] * Y + wip[2][2] * Z;
+    }
+}
+
+RT_TARGET_AVX2 void lab2rgbAvx2(const LabImage &src, Imagefloat &dst, const float wip[3][3])
+{
+    const int W = dst.getWidth();
+    const int H = dst.getHeight();
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic,16)
+#endif
+
+    for(int i = 0; i < H; i++) {
+        lab2rgbRow(src.L[i], src.a[i], src.b[i], dst.r(i), dst.g(i), dst.b(i), W, wip);
+    }
+}
+
+#ifdef RT_MULTIVERSIONING_AVX512
+RT_TARGET_AVX512 void lab2rgbAvx512(const LabImage &src, Imagefloat &dst, const float wip[3][3])
+{
+    const int W = dst.getWidth();
+    const int H = dst.getHeight();
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic,16)
+#endif
+
+    for(int i = 0; i < H; i++) {
+        lab2rgbRow(src.L[i], src.a[i], src.b[i], dst.r(i), dst.g(i), dst.b(i), W, wip);
+    }
+}
+#endif
+
+}
+#endif
+
 void ImProcFunctions::rgb2lab(const Imagefloat &src, LabImage &dst, const Glib::ustring &workingSpace)
 {
     TMatrix wprof = iccStore->workingSpaceMatrix( workingSpace );
@@ -7016,6 +7066,26 @@ SSEFUNCTION void ImProcFunctions::lab2rgb(const LabImage &src, Imagefloat &dst,
         {static_cast<float>(wiprof[2][0]), static_cast<float>(wiprof[2][1]), static_cast<float>(wiprof[2][2])}
     };
 
+#ifdef RT_MULTIVERSIONING
+
+    switch (getSimdLevel()) {
+#ifdef RT_MULTIVERSIONING_AVX512
+
+    case SimdLevel::AVX512:
+        lab2rgbAvx512(src, dst, wip);
+        return;
+#endif
+
+    case SimdLevel::AVX2:
+        lab2rgbAvx2(src, dst, wip);
+        return;
+
+    default:
+        break;
+    }
+
+#endif
+
     const int W = dst.getWidth();
     const int H = dst.getHeight();
 #ifdef __SSE2__
@@ -34,6 +34,8 @@
 #include "curves.h"
 #include "cplx_wavelet_dec.h"
 #include "pipettebuffer.h"
+#include "iccstore.h"
+#include "cancellation.h"
 
 namespace rtengine
 {
@@ -44,13 +46,14 @@ class ImProcFunctions
 {
 
 
-    cmsHTRANSFORM monitorTransform;
+    ICCStore::Transform monitorTransform;
     cmsHTRANSFORM lab2outputTransform;
     cmsHTRANSFORM output2monitorTransform;
 
     const ProcParams* params;
     double scale;
     bool multiThread;
+    const CancellationToken* cancelToken;
 
     void calcVignettingParams(int oW, int oH, const VignettingParams& vignetting, double &w2, double &h2, double& maxRadius, double &v, double &b, double &mul);
 
@@ -196,10 +199,18 @@ public:
     double lumimul[3];
 
     ImProcFunctions       (const ProcParams* iparams, bool imultiThread = true)
-        : monitorTransform(nullptr), lab2outputTransform(nullptr), output2monitorTransform(nullptr), params(iparams), scale(1), multiThread(imultiThread), lumimul{} {}
-    ~ImProcFunctions      ();
+        : monitorTransform(), lab2outputTransform(nullptr), output2monitorTransform(nullptr), params(iparams), scale(1), multiThread(imultiThread), cancelToken(nullptr), lumimul{} {}
 
     void setScale         (double iscale);
+    // The long tools skip their remaining work when the token is raised, see CancellationToken
+    void setCancellationToken (const CancellationToken* token)
+    {
+        cancelToken = token;
+    }
+    bool isCancelled      () const
+    {
+        return cancelToken && cancelToken->isCancelled();
+    }
 
     bool needsTransform   ();
     bool needsPCVignetting ();
@@ -16,6 +16,8 @@
  *  You should have received a copy of the GNU General Public License
  *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <cstdio>
+
 #include "rtengine.h"
 #include "iccstore.h"
 #include "dcp.h"
@@ -27,6 +29,8 @@
 #include "dfmanager.h"
 #include "ffmanager.h"
 #include "rtthumbnail.h"
+#include "cpufeatures.h"
+#include "tracing.h"
 #include "../rtgui/profilestore.h"
 #include "../rtgui/threadutils.h"
 
@@ -40,6 +44,16 @@ MyMutex* lcmsMutex = nullptr;
 int init (const Settings* s, Glib::ustring baseDir, Glib::ustring userSettingsDir)
 {
     settings = s;
+    initSimdLevel ();
+
+    if (s->verbose) {
+        printf ("Using the %s kernels\n", getSimdLevelName (getSimdLevel ()));
+    }
+
+    if (s->tracing) {
+        Tracer::getInstance().start (s->traceFile);
+    }
+
     iccStore->init (s->iccDirectory, baseDir + "/iccprofiles");
     iccStore->findDefaultMonitorProfile();
     DCPStore::getInstance()->init (baseDir + "/dcpprofiles");
@@ -59,6 +73,9 @@ int init (const Settings* s, Glib::ustring baseDir, Glib::ustring userSettingsDi
 
 void cleanup ()
 {
+    if (settings->tracing && !Tracer::getInstance().stop ()) {
+        printf ("Error: the trace can't be written to %s\n", settings->traceFile.c_str ());
+    }
 
     ProcParams::cleanup ();
     Color::cleanup ();
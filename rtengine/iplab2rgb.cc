@@ -18,6 +18,10 @@
  */
 #include "rtengine.h"
 #include "improcfun.h"
+#include <cmath>
+#include <map>
+#include <memory>
+#include <string>
 #include <glibmm.h>
 #include "iccstore.h"
 #include "iccmatrices.h"
@@ -32,6 +36,184 @@ namespace rtengine
 
 extern const Settings* settings;
 
+namespace
+{
+
+// Output profiles made of a 3x3 matrix and one tone curve per channel (sRGB, Adobe RGB, ProPhoto, the gamma
+// profiles built by ICCStore...) are applied by this class instead of LittleCMS
+class MatrixShaper
+{
+    float xyz_rgb[3][3];
+    LUTf trc[3]; // inverse tone curves, from linear to encoded values, both in [0;65535]
+
+public:
+    // Returns false if LittleCMS would give another result than the matrix and the curves:
+    // LUT based profiles, absolute colorimetric intent, or black point compensation with an intent for which
+    // LittleCMS doesn't use the profile's own black point
+    bool init (cmsHPROFILE profile, cmsUInt32Number intent, bool bpc)
+    {
+        if (intent == INTENT_ABSOLUTE_COLORIMETRIC || (bpc && intent != INTENT_RELATIVE_COLORIMETRIC)) {
+            return false;
+        }
+
+        // reading the tags of a profile of the store is not thread safe
+        MyMutex::MyLock lcmsLock (*lcmsMutex);
+
+        if (cmsGetColorSpace (profile) != cmsSigRgbData || !cmsIsMatrixShaper (profile) || cmsIsCLUT (profile, intent, LCMS_USED_AS_OUTPUT)) {
+            return false;
+        }
+
+        const cmsCIEXYZ* colorants[3] = {
+            static_cast<const cmsCIEXYZ*> (cmsReadTag (profile, cmsSigRedColorantTag)),
+            static_cast<const cmsCIEXYZ*> (cmsReadTag (profile, cmsSigGreenColorantTag)),
+            static_cast<const cmsCIEXYZ*> (cmsReadTag (profile, cmsSigBlueColorantTag))
+        };
+        const cmsToneCurve* curves[3] = {
+            static_cast<const cmsToneCurve*> (cmsReadTag (profile, cmsSigRedTRCTag)),
+            static_cast<const cmsToneCurve*> (cmsReadTag (profile, cmsSigGreenTRCTag)),
+            static_cast<const cmsToneCurve*> (cmsReadTag (profile, cmsSigBlueTRCTag))
+        };
+
+        if (!colorants[0] || !colorants[1] || !colorants[2] || !curves[0] || !curves[1] || !curves[2]) {
+            return false;
+        }
+
+        // the colorants are the columns of the RGB to XYZ matrix
+        const double rgb_xyz[3][3] = {
+            {colorants[0]->X, colorants[1]->X, colorants[2]->X},
+            {colorants[0]->Y, colorants[1]->Y, colorants[2]->Y},
+            {colorants[0]->Z, colorants[1]->Z, colorants[2]->Z}
+        };
+        const double det = rgb_xyz[0][0] * (rgb_xyz[1][1] * rgb_xyz[2][2] - rgb_xyz[2][1] * rgb_xyz[1][2])
+                         - rgb_xyz[0][1] * (rgb_xyz[1][0] * rgb_xyz[2][2] - rgb_xyz[1][2] * rgb_xyz[2][0])
+                         + rgb_xyz[0][2] * (rgb_xyz[1][0] * rgb_xyz[2][1] - rgb_xyz[1][1] * rgb_xyz[2][0]);
+
+        if (std::fabs (det) < 1e-10) {
+            return false;
+        }
+
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) {
+                // cofactor of rgb_xyz[j][i]
+                const int j1 = (j + 1) % 3, j2 = (j + 2) % 3, i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+                xyz_rgb[i][j] = (rgb_xyz[j1][i1] * rgb_xyz[j2][i2] - rgb_xyz[j1][i2] * rgb_xyz[j2][i1]) / det;
+            }
+        }
+
+        for (int c = 0; c < 3; c++) {
+            cmsToneCurve* inverse = cmsReverseToneCurve (curves[c]);
+
+            if (!inverse) {
+                return false;
+            }
+
+            trc[c] (65536, LUT_CLIP_BELOW | LUT_CLIP_ABOVE);
+
+            for (int i = 0; i < 65536; i++) {
+                trc[c][i] = 65535.f * cmsEvalToneCurveFloat (inverse, i / 65535.f);
+            }
+
+            cmsFreeToneCurve (inverse);
+        }
+
+        return true;
+    }
+
+    // Converts a row of Lab values to RGB values in [0;65535], not rounded
+    void apply (const float* L, const float* a, const float* b, float* R, float* G, float* B, int W) const
+    {
+        int j = 0;
+#ifdef __SSE2__
+        vfloat xyz_rgbv[3][3];
+
+        for (int i = 0; i < 3; i++) {
+            for (int k = 0; k < 3; k++) {
+                xyz_rgbv[i][k] = F2V (xyz_rgb[i][k]);
+            }
+        }
+
+        for (; j < W - 3; j += 4) {
+            vfloat X, Y, Z;
+            vfloat Rv, Gv, Bv;
+            Color::Lab2XYZ (LVFU (L[j]), LVFU (a[j]), LVFU (b[j]), X, Y, Z);
+            Color::xyz2rgb (X, Y, Z, Rv, Gv, Bv, xyz_rgbv);
+            STVFU (R[j], Rv);
+            STVFU (G[j], Gv);
+            STVFU (B[j], Bv);
+        }
+
+#endif
+
+        for (; j < W; j++) {
+            float X, Y, Z;
+            Color::Lab2XYZ (L[j], a[j], b[j], X, Y, Z);
+            Color::xyz2rgb (X, Y, Z, R[j], G[j], B[j], xyz_rgb);
+        }
+
+        for (j = 0; j < W; j++) {
+            R[j] = trc[0][R[j]];
+            G[j] = trc[1][G[j]];
+            B[j] = trc[2][B[j]];
+        }
+    }
+};
+
+// Number of matrix shapers kept by getMatrixShaper
+constexpr std::size_t maxMatrixShapers = 8;
+
+// The shapers are shared by all the processing jobs, and guarded by lcmsMutex like the transforms of ICCStore.
+// The second member of the pair is the last use, to evict the oldest ones
+std::map<std::string, std::pair<std::shared_ptr<const MatrixShaper>, unsigned long>> matrixShapers;
+unsigned long matrixShaperUse = 0;
+
+// Returns the shaper of the profile, built on first use as its curves take longer to build than a small image takes
+// to convert, or nullptr if LittleCMS has to be used.
+// WARNING: the caller must not lock lcmsMutex
+std::shared_ptr<const MatrixShaper> getMatrixShaper (cmsHPROFILE profile, cmsUInt32Number intent, bool bpc)
+{
+    std::string key;
+
+    {
+        MyMutex::MyLock lcmsLock (*lcmsMutex);
+
+        key = ICCStore::getProfileChecksum (profile) + ':' + std::to_string (intent) + ':' + (bpc ? "1" : "0");
+
+        const auto r = matrixShapers.find (key);
+
+        if (r != matrixShapers.end ()) {
+            r->second.second = ++matrixShaperUse;
+            return r->second.first;
+        }
+    }
+
+    // built without the lock, which init takes to read the profile
+    std::shared_ptr<MatrixShaper> shaper (new MatrixShaper);
+
+    if (!shaper->init (profile, intent, bpc)) {
+        shaper.reset ();
+    }
+
+    MyMutex::MyLock lcmsLock (*lcmsMutex);
+
+    if (matrixShapers.size () >= maxMatrixShapers) {
+        auto oldest = matrixShapers.begin ();
+
+        for (auto it = matrixShapers.begin (); it != matrixShapers.end (); ++it) {
+            if (it->second.second < oldest->second.second) {
+                oldest = it;
+            }
+        }
+
+        matrixShapers.erase (oldest);
+    }
+
+    matrixShapers[key] = std::make_pair (shaper, ++matrixShaperUse);
+
+    return shaper;
+}
+
+}
+
 // Used in ImProcCoordinator::updatePreviewImage  (rtengine/improccoordinator.cc)
 //         Crop::update                           (rtengine/dcrop.cc)
 //         Thumbnail::processImage                (rtengine/rtthumbnail.cc)
@@ -73,7 +255,7 @@ void ImProcFunctions::lab2monitorRgb (LabImage* lab, Image8* image)
                     buffer[iy++] = rb[j] / 327.68f;
                 }
 
-                cmsDoTransform (monitorTransform, buffer, data + ix, W);
+                cmsDoTransform (monitorTransform.get(), buffer, data + ix, W);
             }
         } // End of parallelization
     } else {
@@ -167,17 +349,49 @@ Image8* ImProcFunctions::lab2rgb (LabImage* lab, int cx, int cy, int cw, int ch,
             oprofG = ICCStore::makeStdGammaProfile(oprof);
         }
 
+        const std::shared_ptr<const MatrixShaper> matrixShaper = getMatrixShaper (oprofG, icm.outputIntent, icm.outputBPC);
+        unsigned char *data = image->data;
+
+        if (matrixShaper) {
+#ifdef _OPENMP
+            #pragma omp parallel
+#endif
+            {
+                AlignedBuffer<float> pBuf(3 * cw);
+                float *R = pBuf.data;
+                float *G = R + cw;
+                float *B = G + cw;
+
+#ifdef _OPENMP
+                #pragma omp for schedule(dynamic,16)
+#endif
+
+                for (int i = cy; i < cy + ch; i++) {
+                    matrixShaper->apply (lab->L[i] + cx, lab->a[i] + cx, lab->b[i] + cx, R, G, B, cw);
+
+                    unsigned char *dest = data + (i - cy) * 3 * cw;
+
+                    for (int j = 0; j < cw; j++) {
+                        *(dest++) = uint16ToUint8Rounded(R[j] + 0.5f);
+                        *(dest++) = uint16ToUint8Rounded(G[j] + 0.5f);
+                        *(dest++) = uint16ToUint8Rounded(B[j] + 0.5f);
+                    }
+                }
+            }
+
+            if (oprofG != oprof) {
+                cmsCloseProfile(oprofG);
+            }
+
+            return image;
+        }
+
         cmsUInt32Number flags = cmsFLAGS_NOOPTIMIZE | cmsFLAGS_NOCACHE;
         if (icm.outputBPC) {
             flags |= cmsFLAGS_BLACKPOINTCOMPENSATION;
         }
-        lcmsMutex->lock ();
-        cmsHPROFILE LabIProf  = cmsCreateLab4Profile(nullptr);
-        cmsHTRANSFORM hTransform = cmsCreateTransform (LabIProf, TYPE_Lab_DBL, oprofG, TYPE_RGB_8, icm.outputIntent, flags);  // NOCACHE is important for thread safety
-        cmsCloseProfile(LabIProf);
-        lcmsMutex->unlock ();
-
-        unsigned char *data = image->data;
+        const ICCStore::Transform transform = iccStore->getTransform (iccStore->getLabProfile(), TYPE_Lab_DBL, oprofG, TYPE_RGB_8, icm.outputIntent, flags);
+        cmsHTRANSFORM hTransform = transform.get();
 
         // cmsDoTransform is relatively expensive
 #ifdef _OPENMP
@@ -209,8 +423,6 @@ Image8* ImProcFunctions::lab2rgb (LabImage* lab, int cx, int cy, int cw, int ch,
             }
         } // End of parallelization
 
-        cmsDeleteTransform(hTransform);
-
         if (oprofG != oprof) {
             cmsCloseProfile(oprofG);
         }
@@ -293,18 +505,44 @@ Image16* ImProcFunctions::lab2rgb16 (LabImage* lab, int cx, int cy, int cw, int
         oprof = iccStore->getProfile (icm.output);
     }
 
-    if (oprof) {
+    const std::shared_ptr<const MatrixShaper> matrixShaper = oprof ? getMatrixShaper (oprof, icm.outputIntent, icm.outputBPC) : nullptr;
+
+    if (matrixShaper) {
+#ifdef _OPENMP
+        #pragma omp parallel if (multiThread)
+#endif
+        {
+            AlignedBuffer<float> pBuf(3 * cw);
+            float *R = pBuf.data;
+            float *G = R + cw;
+            float *B = G + cw;
+
+#ifdef _OPENMP
+            #pragma omp for schedule(dynamic,16)
+#endif
+
+            for (int i = cy; i < cy + ch; i++) {
+                matrixShaper->apply (lab->L[i] + cx, lab->a[i] + cx, lab->b[i] + cx, R, G, B, cw);
+
+                unsigned short *pR = image->r(i - cy);
+                unsigned short *pG = image->g(i - cy);
+                unsigned short *pB = image->b(i - cy);
+
+                for (int j = 0; j < cw; j++) {
+                    pR[j] = R[j] + 0.5f;
+                    pG[j] = G[j] + 0.5f;
+                    pB[j] = B[j] + 0.5f;
+                }
+            }
+        }
+    } else if (oprof) {
         cmsUInt32Number flags = cmsFLAGS_NOOPTIMIZE | cmsFLAGS_NOCACHE;
         if (icm.outputBPC) {
             flags |= cmsFLAGS_BLACKPOINTCOMPENSATION;
         }
-        lcmsMutex->lock ();
-        cmsHPROFILE iprof = cmsCreateLab4Profile(nullptr);
-        cmsHTRANSFORM hTransform = cmsCreateTransform (iprof, TYPE_Lab_FLT, oprof, TYPE_RGB_16, icm.outputIntent, flags);
-        lcmsMutex->unlock ();
+        const ICCStore::Transform transform = iccStore->getTransform (iccStore->getLabProfile(), TYPE_Lab_FLT, oprof, TYPE_RGB_16, icm.outputIntent, flags);
 
-        image->ExecCMSTransform(hTransform, *lab, cx, cy);
-        cmsDeleteTransform(hTransform);
+        image->ExecCMSTransform(transform.get(), *lab, cx, cy);
     } else {
 #ifdef _OPENMP
         #pragma omp parallel for schedule(dynamic,16) if (multiThread)
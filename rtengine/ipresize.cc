@@ -21,6 +21,7 @@
 #include "rt_math.h"
 #include "sleef.c"
 #include "opthelper.h"
+#include "StopWatch.h"
 //#define PROFILE
 
 #ifdef PROFILE
@@ -52,6 +53,7 @@ void ImProcFunctions::Lanczos(const Image16* src, Image16* dst, float scale)
 
     #pragma omp parallel
     {
+        TRACE_SPAN("Lanczos worker")
         // storage for precomputed parameters for horisontal interpolation
         float * wwh = new float[support * dst->width];
         int * jj0 = new int[dst->width];
@@ -173,6 +175,7 @@ void ImProcFunctions::Lanczos(const Image16* src, Image16* dst, float scale)
 
 SSEFUNCTION void ImProcFunctions::Lanczos(const LabImage* src, LabImage* dst, float scale)
 {
+    BENCHSTAGE("resize")
     const float delta = 1.0f / scale;
     const float a = 3.0f;
     const float sc = min(scale, 1.0f);
@@ -216,6 +219,7 @@ SSEFUNCTION void ImProcFunctions::Lanczos(const LabImage* src, LabImage* dst, fl
     #pragma omp parallel
 #endif
     {
+        TRACE_SPAN("Lanczos worker")
         // temporal storage for vertically-interpolated row of pixels
         float * lL = new float[src->W];
         float * la = new float[src->W];
@@ -395,6 +399,7 @@ float ImProcFunctions::resizeScale (const ProcParams* params, int fw, int fh, in
 
 void ImProcFunctions::resize (Image16* src, Image16* dst, float dScale)
 {
+    BENCHSTAGE("resize")
 #ifdef PROFILE
     time_t t1 = clock();
 #endif
@@ -23,6 +23,7 @@
 #endif
 #include "mytime.h"
 #include "rt_math.h"
+#include "StopWatch.h"
 #include "sleef.c"
 
 using namespace std;
@@ -292,6 +293,7 @@ bool ImProcFunctions::transCoord (int W, int H, int x, int y, int w, int h, int&
 void ImProcFunctions::transform (Imagefloat* original, Imagefloat* transformed, int cx, int cy, int sx, int sy, int oW, int oH, int fW, int fH,
                                  double focalLen, double focalLen35mm, float focusDist, int rawRotationDeg, bool fullImage)
 {
+    BENCHSTAGE("transform")
 
     LCPMapper *pLCPMap = nullptr;
 
@@ -40,6 +40,7 @@
 #include "median.h"
 #include "EdgePreservingDecomposition.h"
 #include "iccstore.h"
+#include "StopWatch.h"
 
 #ifdef _OPENMP
 #include <omp.h>
@@ -144,6 +145,7 @@ SSEFUNCTION void ImProcFunctions::ip_wavelet(LabImage * lab, LabImage * dst, int
 
 
 {
+    BENCHSTAGE("wavelet")
 #ifdef _DEBUG
     // init variables to display Munsell corrections
     MunsellDebugInfo* MunsDebugInfo = new MunsellDebugInfo();
@@ -669,6 +671,7 @@ SSEFUNCTION void ImProcFunctions::ip_wavelet(LabImage * lab, LabImage * dst, int
     #pragma omp parallel num_threads(numthreads)
 #endif
     {
+        TRACE_SPAN("ip_wavelet worker")
         float *mean = new float [9];
         float *meanN = new float [9];
         float *sigma = new float [9];
@@ -694,6 +697,10 @@ SSEFUNCTION void ImProcFunctions::ip_wavelet(LabImage * lab, LabImage * dst, int
 
         for (int tiletop = 0; tiletop < imheight; tiletop += tileHskip) {
             for (int tileleft = 0; tileleft < imwidth ; tileleft += tileWskip) {
+                if (isCancelled()) {
+                    continue;
+                }
+
                 int tileright = MIN(imwidth, tileleft + tilewidth);
                 int tilebottom = MIN(imheight, tiletop + tileheight);
                 int width  = tileright - tileleft;
@@ -2029,6 +2036,9 @@ void ImProcFunctions::WaveletcontAllL(LabImage * labco, float ** varhue, float *
 
         for (int dir = 1; dir < 4; dir++) {
             for (int lvl = 0; lvl < maxlvl; lvl++) {
+                if (isCancelled()) {
+                    continue;
+                }
 
                 int Wlvl_L = WaveletCoeffs_L.level_W(lvl);
                 int Hlvl_L = WaveletCoeffs_L.level_H(lvl);
@@ -2246,6 +2256,9 @@ void ImProcFunctions::WaveletcontAllAB(LabImage * labco, float ** varhue, float
 
         for (int dir = 1; dir < 4; dir++) {
             for (int lvl = 0; lvl < maxlvl; lvl++) {
+                if (isCancelled()) {
+                    continue;
+                }
 
                 int Wlvl_ab = WaveletCoeffs_ab.level_W(lvl);
                 int Hlvl_ab = WaveletCoeffs_ab.level_H(lvl);
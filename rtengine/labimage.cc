@@ -1,13 +1,40 @@
 #include "labimage.h"
+#include "imagefloat.h"
 #include <memory.h>
 namespace rtengine
 {
 
-LabImage::LabImage (int w, int h) : fromImage(false), W(w), H(h)
+LabImage::LabImage (int w, int h) : fromImage(false), storage(nullptr), W(w), H(h)
 {
     allocLab(w, h);
 }
 
+LabImage::LabImage (Imagefloat* img) : fromImage(false), storage(img), W(img->getWidth()), H(img->getHeight())
+{
+    L = new float*[H];
+    a = new float*[H];
+    b = new float*[H];
+
+    data = img->r(0);
+
+    for (int i = 0; i < H; i++) {
+        L[i] = img->r(i);
+        a[i] = img->g(i);
+        b[i] = img->b(i);
+    }
+}
+
+bool LabImage::canWrap (Imagefloat* img)
+{
+    return img->getRowStride() == img->getWidth() * static_cast<int>(sizeof(float)) && img->getPlaneStride() == img->getRowStride() * img->getHeight();
+}
+
+void LabImage::releaseStorage()
+{
+    delete storage;
+    storage = nullptr;
+}
+
 LabImage::~LabImage ()
 {
     deleteLab();
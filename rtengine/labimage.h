@@ -22,10 +22,13 @@
 namespace rtengine
 {
 
+class Imagefloat;
+
 class LabImage
 {
 private:
     bool fromImage;
+    Imagefloat* storage;
     void allocLab(int w, int h)
     {
         L = new float*[H];
@@ -59,8 +62,14 @@ public:
     float** b;
 
     LabImage (int w, int h);
+    // Takes ownership of a float image whose 3 planes are stored contiguously (see canWrap) and uses them
+    // as L, a and b planes, so that a RGB to Lab conversion can be done in place
+    explicit LabImage (Imagefloat* img);
     ~LabImage ();
 
+    // Returns true if img has no row padding, i.e. if its data can be used by the LabImage (Imagefloat*) constructor
+    static bool canWrap (Imagefloat* img);
+
     //Copies image data in Img into this instance.
     void CopyFrom(LabImage *Img);
     void getPipetteData (float &L, float &a, float &b, int posX, int posY, int squareSize);
@@ -70,9 +79,15 @@ public:
             delete [] L;
             delete [] a;
             delete [] b;
-            delete [] data;
+
+            if (storage) {
+                releaseStorage();
+            } else {
+                delete [] data;
+            }
         }
     }
+    void releaseStorage();
     void reallocLab( )
     {
         allocLab(W, H);
@@ -129,6 +129,20 @@ inline unsigned char* fdata(int offset, IMFILE* f)
     return (unsigned char*)f->data + offset;
 }
 
+// Moves past the count bytes following the current position, which the caller has read in place with fdata()
+inline void fskip (IMFILE* f, int count)
+{
+    f->pos += count;
+
+    if (f->plistener) {
+        f->progress_current += count;
+
+        if (f->progress_current >= f->progress_next) {
+            imfile_update_progress(f);
+        }
+    }
+}
+
 int fscanf (IMFILE* f, const char* s ...);
 char* fgets (char* s, int n, IMFILE* f);
 
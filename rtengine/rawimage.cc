@@ -8,6 +8,7 @@
 #include "settings.h"
 #include "camconst.h"
 #include "utils.h"
+#include "StopWatch.h"
 #ifdef WIN32
 #include <winsock2.h>
 #else
@@ -482,7 +483,10 @@ int RawImage::loadRaw (bool loadData, bool closeFile, ProgressListener *plistene
         */
         // Load raw pixels data
         fseek (ifp, data_offset, SEEK_SET);
-        (this->*load_raw)();
+        {
+            BENCHSTAGE("decode")
+            (this->*load_raw)();
+        }
 
         if (plistener) {
             plistener->setProgress(0.9 * progressRange);
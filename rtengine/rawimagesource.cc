@@ -18,6 +18,9 @@
  */
 #include <cmath>
 #include <iostream>
+#include <memory>
+#include <sstream>
+#include <giomm.h>
 
 #include "rtengine.h"
 #include "rawimagesource.h"
@@ -33,6 +36,8 @@
 #include "dcp.h"
 #include "rt_math.h"
 #include "improcfun.h"
+#include "demosaiccache.h"
+#include "../rtgui/version.h"
 #ifdef _OPENMP
 #include <omp.h>
 #endif
@@ -408,6 +413,38 @@ void transLineD1x (const float* const red, const float* const green, const float
     }
 }
 
+// Builds the key of the demosaic cache from the identity of the raw file and from everything which has an influence on preprocess()
+Glib::ustring getDemosaicCacheKey (const Glib::ustring &fileName, const rtengine::procparams::RAWParams &raw, rtengine::RawImage *riDark, rtengine::RawImage *riFlatFile,
+                                   const rtengine::procparams::LensProfParams &lensProf, const rtengine::procparams::CoarseTransformParams &coarse)
+{
+    std::ostringstream key;
+    key.precision(17);
+
+    try {
+        const auto info = Gio::File::create_for_path (fileName)->query_info ("standard::size,time::modified");
+        key << fileName << '|' << info->get_size () << '|' << info->modification_time ().as_iso8601 ();
+    } catch (Glib::Exception&) {
+        return Glib::ustring ();
+    }
+
+    key << '|' << RTVERSION
+        << '|' << raw.bayersensor.method << ' ' << raw.bayersensor.ccSteps << ' ' << raw.bayersensor.black0 << ' ' << raw.bayersensor.black1
+        << ' ' << raw.bayersensor.black2 << ' ' << raw.bayersensor.black3 << ' ' << raw.bayersensor.twogreen << ' ' << raw.bayersensor.linenoise
+        << ' ' << raw.bayersensor.greenthresh << ' ' << raw.bayersensor.dcb_iterations << ' ' << raw.bayersensor.lmmse_iterations << ' ' << raw.bayersensor.dcb_enhance
+        << '|' << raw.xtranssensor.method << ' ' << raw.xtranssensor.ccSteps << ' ' << raw.xtranssensor.blackred << ' ' << raw.xtranssensor.blackgreen << ' ' << raw.xtranssensor.blackblue
+        << '|' << (riDark ? riDark->get_filename () : std::string ())
+        << '|' << (riFlatFile ? riFlatFile->get_filename () : std::string ()) << ' ' << raw.ff_BlurRadius << ' ' << raw.ff_BlurType << ' ' << raw.ff_AutoClipControl << ' ' << raw.ff_clipControl
+        << '|' << raw.ca_autocorrect << ' ' << raw.caautostrength << ' ' << raw.cared << ' ' << raw.cablue
+        << '|' << raw.expos << ' ' << raw.preser
+        << '|' << raw.hotPixelFilter << ' ' << raw.deadPixelFilter << ' ' << raw.hotdeadpix_thresh;
+
+    if (!riFlatFile && lensProf.useVign) {
+        key << '|' << lensProf.lcpFile << ' ' << coarse.rotate << ' ' << coarse.hflip << ' ' << coarse.vflip;
+    }
+
+    return key.str ();
+}
+
 }
 
 
@@ -1496,6 +1533,7 @@ void RawImageSource::vflip (Imagefloat* image)
 
 int RawImageSource::load (const Glib::ustring &fname, bool batch)
 {
+    BENCHSTAGE("load")
 
     MyTime t1, t2;
     t1.set();
@@ -1659,6 +1697,7 @@ int RawImageSource::load (const Glib::ustring &fname, bool batch)
 
 void RawImageSource::preprocess  (const RAWParams &raw, const LensProfParams &lensProf, const CoarseTransformParams& coarse, bool prepareDenoise)
 {
+    BENCHSTAGE("preprocess")
 //    BENCHFUN
     MyTime t1, t2;
     t1.set();
@@ -1719,9 +1758,21 @@ void RawImageSource::preprocess  (const RAWParams &raw, const LensProfParams &le
         printf( "Flat Field Correction:%s\n", rif->get_filename().c_str());
     }
 
-    copyOriginalPixels(raw, ri, rid, rif);
+    // the pixels are copied together with the scaling below, unless the auto clip control of the flat field needs the maximum of the corrected image first
+    const bool fusedCopy = (!hasFlatField || !raw.ff_AutoClipControl) && (ri->getSensorType() == ST_BAYER || ri->getSensorType() == ST_FUJI_XTRANS);
+
+    if (!fusedCopy) {
+        copyOriginalPixels(raw, ri, rid, rif);
+    }
+
     //FLATFIELD end
 
+    if (DemosaicCache::getInstance().isEnabled()) {
+        demosaicCacheKey = getDemosaicCacheKey(fileName, raw, rid, rif, lensProf, coarse);
+    } else {
+        demosaicCacheKey.clear();
+    }
+
 
     // Always correct camera badpixels from .badpixels file
     std::vector<badPix> *bp = dfm.getBadPixels( ri->get_maker(), ri->get_model(), idata->getSerialNumber() );
@@ -1760,15 +1811,23 @@ void RawImageSource::preprocess  (const RAWParams &raw, const LensProfParams &le
     }
 
 
-    scaleColors( 0, 0, W, H, raw); //+ + raw parameters for black level(raw.blackxx)
-
     // Correct vignetting of lens profile
+    std::unique_ptr<LCPMapper> vignetteMap;
+
     if (!hasFlatField && lensProf.useVign) {
         LCPProfile *pLCPProf = lcpStore->getProfile(lensProf.lcpFile);
 
         if (pLCPProf) { // don't check focal length to allow distortion correction for lenses without chip, also pass dummy focal length 1 in case of 0
-            LCPMapper map(pLCPProf, max(idata->getFocalLen(), 1.0), idata->getFocalLen35mm(), idata->getFocusDist(), idata->getFNumber(), true, false, W, H, coarse, -1);
+            vignetteMap.reset(new LCPMapper(pLCPProf, max(idata->getFocalLen(), 1.0), idata->getFocalLen35mm(), idata->getFocusDist(), idata->getFNumber(), true, false, W, H, coarse, -1));
+        }
+    }
+
+    if (fusedCopy) {
+        copyScaleOriginalPixels(raw, ri, rid, rif, vignetteMap.get());
+    } else {
+        scaleColors( 0, 0, W, H, raw); //+ + raw parameters for black level(raw.blackxx)
 
+        if (vignetteMap) {
 #ifdef _OPENMP
             #pragma omp parallel for
 #endif
@@ -1776,7 +1835,7 @@ void RawImageSource::preprocess  (const RAWParams &raw, const LensProfParams &le
             for (int y = 0; y < H; y++) {
                 for (int x = 0; x < W; x++) {
                     if (rawData[y][x] > 0) {
-                        rawData[y][x] *= map.calcVignetteFac(x, y);
+                        rawData[y][x] *= vignetteMap->calcVignetteFac(x, y);
                     }
                 }
             }
@@ -1908,9 +1967,36 @@ void RawImageSource::preprocess  (const RAWParams &raw, const LensProfParams &le
 
 void RawImageSource::demosaic(const RAWParams &raw)
 {
+    BENCHSTAGE("demosaic")
     MyTime t1, t2;
     t1.set();
 
+    // the cheap methods are faster than reading the cache
+    bool cacheable = !demosaicCacheKey.empty();
+
+    if (ri->getSensorType() == ST_BAYER) {
+        cacheable = cacheable && raw.bayersensor.method != RAWParams::BayerSensor::methodstring[RAWParams::BayerSensor::fast]
+                    && raw.bayersensor.method != RAWParams::BayerSensor::methodstring[RAWParams::BayerSensor::mono]
+                    && raw.bayersensor.method != RAWParams::BayerSensor::methodstring[RAWParams::BayerSensor::none];
+    } else if (ri->getSensorType() == ST_FUJI_XTRANS) {
+        cacheable = cacheable && raw.xtranssensor.method != RAWParams::XTransSensor::methodstring[RAWParams::XTransSensor::fast]
+                    && raw.xtranssensor.method != RAWParams::XTransSensor::methodstring[RAWParams::XTransSensor::mono]
+                    && raw.xtranssensor.method != RAWParams::XTransSensor::methodstring[RAWParams::XTransSensor::none];
+    } else {
+        cacheable = false;
+    }
+
+    if (cacheable && DemosaicCache::getInstance().get(demosaicCacheKey, W, H, red, green, blue)) {
+        rgbSourceModified = false;
+        t2.set();
+
+        if( settings->verbose ) {
+            printf("Demosaiced data read from cache - %d usec\n", t2.etime(t1));
+        }
+
+        return;
+    }
+
     if (ri->getSensorType() == ST_BAYER) {
         if ( raw.bayersensor.method == RAWParams::BayerSensor::methodstring[RAWParams::BayerSensor::hphd] ) {
             hphd_demosaic ();
@@ -1955,6 +2041,11 @@ void RawImageSource::demosaic(const RAWParams &raw)
         nodemosaic(true);
     }
 
+    // a cancelled demosaicing is incomplete
+    if (cacheable && !isCancelled()) {
+        DemosaicCache::getInstance().put(demosaicCacheKey, W, H, red, green, blue);
+    }
+
     t2.set();
 
 
@@ -2678,10 +2769,8 @@ void RawImageSource::HLRecovery_Global(ToneCurveParams hrp)
 }
 
 
-void RawImageSource::processFlatField(const RAWParams &raw, RawImage *riFlatFile, unsigned short black[4])
+void RawImageSource::flatFieldBlur(const RAWParams &raw, RawImage *riFlatFile, float *cfablur)
 {
-//    BENCHFUN
-    float *cfablur = (float (*)) malloc (H * W * sizeof * cfablur);
     int BS = raw.ff_BlurRadius;
     BS += BS & 1;
 
@@ -2696,6 +2785,16 @@ void RawImageSource::processFlatField(const RAWParams &raw, RawImage *riFlatFile
     } else { //(raw.ff_BlurType == RAWParams::ff_BlurTypestring[RAWParams::area_ff])
         cfaboxblur(riFlatFile, cfablur, BS, BS);
     }
+}
+
+void RawImageSource::processFlatField(const RAWParams &raw, RawImage *riFlatFile, unsigned short black[4])
+{
+//    BENCHFUN
+    float *cfablur = (float (*)) malloc (H * W * sizeof * cfablur);
+    int BS = raw.ff_BlurRadius;
+    BS += BS & 1;
+
+    flatFieldBlur(raw, riFlatFile, cfablur);
 
     if(ri->getSensorType() == ST_BAYER) {
         float refcolor[2][2];
@@ -2963,6 +3062,95 @@ void RawImageSource::processFlatField(const RAWParams &raw, RawImage *riFlatFile
 
 //%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 
+/* Same corrections as processFlatField, for Bayer and X-Trans sensors, but only computes the factor of each pixel
+ * minus black. The clip control comes from the slider, the auto clip control needs the corrected image.
+ */
+float* RawImageSource::flatFieldGains(const RAWParams &raw, RawImage *riFlatFile, const float black[4])
+{
+    float *gains = (float (*)) malloc (H * W * sizeof * gains);
+    flatFieldBlur(raw, riFlatFile, gains);
+
+    const bool xtrans = ri->getSensorType() == ST_FUJI_XTRANS;
+    const float limitFactor = max((float)(100 - raw.ff_clipControl) / 100.f, 0.01f);
+    float refcolor[2][3] = {};
+
+    if (xtrans) {
+        //find center ave values by channel
+        int cCount[3] = {0};
+
+        for (int m = -3; m < 3; m++)
+            for (int n = -3; n < 3; n++) {
+                int row = 2 * (H >> 2) + m;
+                int col = 2 * (W >> 2) + n;
+                int c  = riFlatFile->XTRANSFC(row, col);
+                refcolor[0][c] += max(0.0f, gains[row * W + col] - black[c]);
+                cCount[c] ++;
+            }
+
+        for(int c = 0; c < 3; c++) {
+            refcolor[0][c] = refcolor[0][c] / cCount[c] * limitFactor;
+        }
+    } else {
+        //find centre average values by channel
+        for (int m = 0; m < 2; m++)
+            for (int n = 0; n < 2; n++) {
+                int row = 2 * (H >> 2) + m;
+                int col = 2 * (W >> 2) + n;
+                int c  = FC(row, col);
+                int c4 = ( c == 1 && !(row & 1) ) ? 3 : c;
+                refcolor[m][n] = max(0.0f, gains[row * W + col] - black[c4]) * limitFactor;
+            }
+    }
+
+    float *cfablur1 = nullptr;
+    float *cfablur2 = nullptr;
+
+    if (raw.ff_BlurType == RAWParams::ff_BlurTypestring[RAWParams::vh_ff]) {
+        int BS = raw.ff_BlurRadius;
+        BS += BS & 1;
+        cfablur1 = (float (*)) malloc (H * W * sizeof * cfablur1);
+        cfablur2 = (float (*)) malloc (H * W * sizeof * cfablur2);
+        //slightly more complicated blur if trying to correct both vertical and horizontal anomalies
+        cfaboxblur(riFlatFile, cfablur1, 0, 2 * BS); //now do horizontal blur
+        cfaboxblur(riFlatFile, cfablur2, 2 * BS, 0); //now do vertical blur
+    }
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic,16)
+#endif
+
+    for (int row = 0; row < H; row++) {
+        for (int col = 0; col < W; col++) {
+            int c, c4;
+            float ref;
+
+            if (xtrans) {
+                c4 = c = ri->XTRANSFC(row, col);
+                ref = refcolor[0][c];
+            } else {
+                c  = FC(row, col);
+                c4 = ( c == 1 && !(row & 1) ) ? 3 : c;
+                ref = refcolor[row & 1][col & 1];
+            }
+
+            const float blur = max(1e-5f, gains[row * W + col] - black[c4]);
+            float gain = ref / blur;
+
+            if (cfablur1) {
+                gain *= SQR(blur) / (max(1e-5f, cfablur1[row * W + col] - black[c4]) * max(1e-5f, cfablur2[row * W + col] - black[c4]));
+            }
+
+            gains[row * W + col] = gain;
+        }
+    }
+
+    free (cfablur1);
+    free (cfablur2);
+    return gains;
+}
+
+//%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
 /* Copy original pixel data and
  * subtract dark frame (if present) from current image and apply flat field correction (if present)
  */
@@ -3300,39 +3488,8 @@ SSEFUNCTION void RawImageSource::cfaboxblur(RawImage *riFlatFile, float* cfablur
 void RawImageSource::scaleColors(int winx, int winy, int winw, int winh, const RAWParams &raw)
 {
     chmax[0] = chmax[1] = chmax[2] = chmax[3] = 0; //channel maxima
-    float black_lev[4] = {0.f};//black level
-
-    //adjust black level  (eg Canon)
-    bool isMono = false;
-
-    if (getSensorType() == ST_BAYER || getSensorType() == ST_FOVEON ) {
 
-        black_lev[0] = raw.bayersensor.black1; //R
-        black_lev[1] = raw.bayersensor.black0; //G1
-        black_lev[2] = raw.bayersensor.black2; //B
-        black_lev[3] = raw.bayersensor.black3; //G2
-
-        isMono = RAWParams::BayerSensor::methodstring[RAWParams::BayerSensor::mono] == raw.bayersensor.method;
-    } else if (getSensorType() == ST_FUJI_XTRANS) {
-
-        black_lev[0] = raw.xtranssensor.blackred; //R
-        black_lev[1] = raw.xtranssensor.blackgreen; //G1
-        black_lev[2] = raw.xtranssensor.blackblue; //B
-        black_lev[3] = raw.xtranssensor.blackgreen; //G2  (set, only used with a Bayer filter)
-
-        isMono = RAWParams::XTransSensor::methodstring[RAWParams::XTransSensor::mono] == raw.xtranssensor.method;
-    }
-
-    for(int i = 0; i < 4 ; i++) {
-        cblacksom[i] = max( c_black[i] + black_lev[i], 0.0f );    // adjust black level
-    }
-
-    initialGain = calculate_scale_mul(scale_mul, ref_pre_mul, c_white, cblacksom, isMono, ri->get_colors()); // recalculate scale colors with adjusted levels
-
-    //fprintf(stderr, "recalc: %f [%f %f %f %f]\n", initialGain, scale_mul[0], scale_mul[1], scale_mul[2], scale_mul[3]);
-    for(int i = 0; i < 4 ; i++) {
-        clmax[i] = (c_white[i] - cblacksom[i]) * scale_mul[i];    // raw clip level
-    }
+    initScaleColors(raw);
 
     // this seems strange, but it works
 
@@ -3472,6 +3629,136 @@ void RawImageSource::scaleColors(int winx, int winy, int winw, int winh, const R
 
 //%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 
+// Computes the black levels and the multipliers applied by scaleColors
+void RawImageSource::initScaleColors(const RAWParams &raw)
+{
+    float black_lev[4] = {0.f};//black level
+
+    //adjust black level  (eg Canon)
+    bool isMono = false;
+
+    if (getSensorType() == ST_BAYER || getSensorType() == ST_FOVEON ) {
+
+        black_lev[0] = raw.bayersensor.black1; //R
+        black_lev[1] = raw.bayersensor.black0; //G1
+        black_lev[2] = raw.bayersensor.black2; //B
+        black_lev[3] = raw.bayersensor.black3; //G2
+
+        isMono = RAWParams::BayerSensor::methodstring[RAWParams::BayerSensor::mono] == raw.bayersensor.method;
+    } else if (getSensorType() == ST_FUJI_XTRANS) {
+
+        black_lev[0] = raw.xtranssensor.blackred; //R
+        black_lev[1] = raw.xtranssensor.blackgreen; //G1
+        black_lev[2] = raw.xtranssensor.blackblue; //B
+        black_lev[3] = raw.xtranssensor.blackgreen; //G2  (set, only used with a Bayer filter)
+
+        isMono = RAWParams::XTransSensor::methodstring[RAWParams::XTransSensor::mono] == raw.xtranssensor.method;
+    }
+
+    for(int i = 0; i < 4 ; i++) {
+        cblacksom[i] = max( c_black[i] + black_lev[i], 0.0f );    // adjust black level
+    }
+
+    initialGain = calculate_scale_mul(scale_mul, ref_pre_mul, c_white, cblacksom, isMono, ri->get_colors()); // recalculate scale colors with adjusted levels
+
+    //fprintf(stderr, "recalc: %f [%f %f %f %f]\n", initialGain, scale_mul[0], scale_mul[1], scale_mul[2], scale_mul[3]);
+    for(int i = 0; i < 4 ; i++) {
+        clmax[i] = (c_white[i] - cblacksom[i]) * scale_mul[i];    // raw clip level
+    }
+}
+
+//%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+/* Copy original pixel data, subtract dark frame (if present), apply flat field correction (if present, without auto
+ * clip control), scale the colors and correct the vignetting of the lens profile (if present) in a single pass, each
+ * pixel being done at once while it is in the cache
+ */
+void RawImageSource::copyScaleOriginalPixels(const RAWParams &raw, RawImage *src, RawImage *riDark, RawImage *riFlatFile, const LCPMapper *vignetteMap)
+{
+    const float black[4] = {
+        static_cast<float>(ri->get_cblack(0)), static_cast<float>(ri->get_cblack(1)),
+        static_cast<float>(ri->get_cblack(2)), static_cast<float>(ri->get_cblack(3))
+    };
+
+    if (riDark && (W != riDark->get_width() || H != riDark->get_height())) {
+        riDark = nullptr;
+    }
+
+    // the blurred flat field is computed before the sweep, it needs the neighbourhood of the pixels
+    float *ffGains = nullptr;
+
+    if (riFlatFile && W == riFlatFile->get_width() && H == riFlatFile->get_height()) {
+        ffGains = flatFieldGains(raw, riFlatFile, black);
+    }
+
+    if (!rawData) {
+        rawData(W, H);
+    }
+
+    chmax[0] = chmax[1] = chmax[2] = chmax[3] = 0; //channel maxima
+
+    initScaleColors(raw);
+
+    const bool xtrans = ri->getSensorType() == ST_FUJI_XTRANS;
+
+#ifdef _OPENMP
+    #pragma omp parallel
+#endif
+    {
+        float tmpchmax[3];
+        tmpchmax[0] = tmpchmax[1] = tmpchmax[2] = 0.0f;
+#ifdef _OPENMP
+        #pragma omp for nowait
+#endif
+
+        for (int row = 0; row < H; row++) {
+            for (int col = 0; col < W; col++) {
+                int c, c4;
+
+                if (xtrans) {
+                    c4 = c = ri->XTRANSFC(row, col);              // black[0] to black[4] are equal for xtrans-sensors
+                } else {
+                    c  = FC(row, col);                            // three colors,  0=R, 1=G,  2=B
+                    c4 = ( c == 1 && !(row & 1) ) ? 3 : c;        // four  colors,  0=R, 1=G1, 2=B, 3=G2
+                }
+
+                float val = src->data[row][col];
+
+                if (riDark) {
+                    val = max(val + black[c4] - riDark->data[row][col], 0.0f);
+                }
+
+                if (ffGains) {
+                    val = (val - black[c4]) * ffGains[row * W + col] + black[c4];
+                }
+
+                val -= cblacksom[c4];
+                val *= scale_mul[c4];
+                tmpchmax[c] = max(tmpchmax[c], val);
+
+                if (vignetteMap && val > 0) {
+                    val *= vignetteMap->calcVignetteFac(col, row);
+                }
+
+                rawData[row][col] = val;
+            }
+        }
+
+#ifdef _OPENMP
+        #pragma omp critical
+#endif
+        {
+            chmax[0] = max(tmpchmax[0], chmax[0]);
+            chmax[1] = max(tmpchmax[1], chmax[1]);
+            chmax[2] = max(tmpchmax[2], chmax[2]);
+        }
+    }
+
+    free (ffGains);
+}
+
+//%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
 int RawImageSource::defTransform (int tran)
 {
 
@@ -3890,11 +4177,10 @@ void RawImageSource::colorSpaceConversion_ (Imagefloat* im, ColorManagementParam
         }
 
         // Initialize transform
-        cmsHTRANSFORM hTransform;
+        ICCStore::Transform transform;
         cmsHPROFILE prophoto = iccStore->workingSpace("ProPhoto"); // We always use Prophoto to apply the ICC profile to minimize problems with clipping in LUT conversion.
         bool transform_via_pcs_lab = false;
         bool separate_pcs_lab_highlights = false;
-        lcmsMutex->lock ();
 
         switch (camera_icc_type) {
             case CAMERA_ICC_TYPE_PHASE_ONE:
@@ -3903,7 +4189,7 @@ void RawImageSource::colorSpaceConversion_ (Imagefloat* im, ColorManagementParam
                 transform_via_pcs_lab = true;
                 separate_pcs_lab_highlights = true;
                 // We transform to Lab because we can and that we avoid getting an unnecessary unmatched gamma conversion which we would need to revert.
-                hTransform = cmsCreateTransform (in, TYPE_RGB_FLT, nullptr, TYPE_Lab_FLT, INTENT_RELATIVE_COLORIMETRIC, cmsFLAGS_NOOPTIMIZE | cmsFLAGS_NOCACHE );
+                transform = iccStore->getTransform (in, TYPE_RGB_FLT, nullptr, TYPE_Lab_FLT, INTENT_RELATIVE_COLORIMETRIC, cmsFLAGS_NOOPTIMIZE);
 
                 for (int i = 0; i < 3; i++) {
                     for (int j = 0; j < 3; j++) {
@@ -3921,19 +4207,17 @@ void RawImageSource::colorSpaceConversion_ (Imagefloat* im, ColorManagementParam
             case CAMERA_ICC_TYPE_NIKON:
             case CAMERA_ICC_TYPE_GENERIC:
             default:
-                hTransform = cmsCreateTransform (in, TYPE_RGB_FLT, prophoto, TYPE_RGB_FLT, INTENT_RELATIVE_COLORIMETRIC, cmsFLAGS_NOOPTIMIZE | cmsFLAGS_NOCACHE );  // NOCACHE is important for thread safety
+                transform = iccStore->getTransform (in, TYPE_RGB_FLT, prophoto, TYPE_RGB_FLT, INTENT_RELATIVE_COLORIMETRIC, cmsFLAGS_NOOPTIMIZE);
                 break;
         }
 
-        lcmsMutex->unlock ();
-
-        if (hTransform == nullptr) {
+        if (!transform) {
             // Fallback: create transform from camera profile. Should not happen normally.
-            lcmsMutex->lock ();
-            hTransform = cmsCreateTransform (camprofile, TYPE_RGB_FLT, prophoto, TYPE_RGB_FLT, INTENT_RELATIVE_COLORIMETRIC, cmsFLAGS_NOOPTIMIZE | cmsFLAGS_NOCACHE );
-            lcmsMutex->unlock ();
+            transform = iccStore->getTransform (camprofile, TYPE_RGB_FLT, prophoto, TYPE_RGB_FLT, INTENT_RELATIVE_COLORIMETRIC, cmsFLAGS_NOOPTIMIZE);
         }
 
+        const cmsHTRANSFORM hTransform = transform.get();
+
         TMatrix toxyz = {}, torgb = {};
 
         if (!working_space_is_prophoto) {
@@ -4126,7 +4410,6 @@ void RawImageSource::colorSpaceConversion_ (Imagefloat* im, ColorManagementParam
                 }
             }
         } // End of parallelization
-        cmsDeleteTransform(hTransform);
     }
 
 //t3.set ();
@@ -31,6 +31,8 @@
 namespace rtengine
 {
 
+class LCPMapper;
+
 class RawImageSource : public ImageSource
 {
 
@@ -69,6 +71,7 @@ protected:
     double defGain;
     cmsHPROFILE camProfile;
     bool rgbSourceModified;
+    Glib::ustring demosaicCacheKey; // identifies the output of preprocess() in the demosaic cache, empty if not cacheable
 
     RawImage* ri;  // Copy of raw pixels, NOT corrected for initial gain, blackpoint etc.
 
@@ -124,10 +127,16 @@ public:
         return rgbSourceModified;   // tracks whether cached rgb output of demosaic has been modified
     }
 
+    void        flatFieldBlur(const RAWParams &raw, RawImage *riFlatFile, float *cfablur);
     void        processFlatField(const RAWParams &raw, RawImage *riFlatFile, unsigned short black[4]);
+    // the factor of each pixel minus black of the flat field correction, with the clip control of the slider. Returns a W * H buffer to free
+    float*      flatFieldGains(const RAWParams &raw, RawImage *riFlatFile, const float black[4]);
     void        copyOriginalPixels(const RAWParams &raw, RawImage *ri, RawImage *riDark, RawImage *riFlatFile  );
     void        cfaboxblur  (RawImage *riFlatFile, float* cfablur, int boxH, int boxW);
     void        scaleColors (int winx, int winy, int winw, int winh, const RAWParams &raw); // raw for cblack
+    void        initScaleColors (const RAWParams &raw);
+    // copyOriginalPixels, scaleColors and the lens vignetting correction in one pass, for Bayer and X-Trans sensors without flat field auto clip control
+    void        copyScaleOriginalPixels (const RAWParams &raw, RawImage *src, RawImage *riDark, RawImage *riFlatFile, const LCPMapper *vignetteMap);
 
     void        getImage    (const ColorTemp &ctemp, int tran, Imagefloat* image, const PreviewProps &pp, const ToneCurveParams &hrp, const ColorManagementParams &cmp, const RAWParams &raw);
     eSensorType getSensorType () const
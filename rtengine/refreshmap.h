@@ -19,6 +19,10 @@
 #ifndef __REFRESHMAP__
 #define __REFRESHMAP__
 
+// Use M_WAVELET or M_CIECAM if the event only changes the late stages of the Lab pipeline: the preview is then
+// resumed from the cached input of that stage. M_LUMINANCE and M_COLOR rerun the whole Lab pipeline, these stages included
+#define M_WAVELET    (1<<18)
+#define M_CIECAM     (1<<17)
 // Use M_VOID if you wish to update the proc params without updating the preview at all !
 #define M_VOID       (1<<16)
 // Use M_MINUPDATE if you wish to update the preview without modifying the image (think about it like a "refreshPreview")
@@ -26,6 +30,8 @@
 #define M_MINUPDATE  (1<<15)
 // Force high quality
 #define M_HIGHQUAL   (1<<14)
+// Quick update of the detail crops: their expensive 1:1 tools are skipped, and redone later by Crop::refine
+#define M_DRAFT      (1<<19)
 
 // Elementary functions that can be done to
 // the preview image when an event occurs
@@ -61,6 +67,8 @@
 #define DEFRINGE                                                                                                    (M_LUMINANCE|M_COLOR)
 #define DIRPYRDENOISE                                                                                               (M_LUMINANCE|M_COLOR)
 #define DIRPYREQUALIZER                                                                                             (M_LUMINANCE|M_COLOR)
+#define WAVELET          (M_WAVELET|M_CIECAM)
+#define CIECAM            M_CIECAM
 #define GAMMA             M_MONITOR
 #define CROP              M_CROP
 #define RESIZE            M_VOID
@@ -37,6 +37,7 @@
 #include "../rtgui/ppversion.h"
 #include "improccoordinator.h"
 #include <locale.h>
+#include <zlib.h>
 //#define BENCHMARK
 #include "StopWatch.h"
 
@@ -193,15 +194,20 @@ Thumbnail* Thumbnail::loadQuickFromRaw (const Glib::ustring& fname, RawMetaDataL
     img->setSampleArrangement(IIOSA_CHUNKY);
 
     int err = 1;
+    int fullWidth = 0, fullHeight = 0;
 
     // See if it is something we support
     if (checkRawImageThumb(*ri)) {
+        // the embedded preview is read in place from the mapped raw file
         const char* data((const char*)fdata(ri->get_thumbOffset(), ri->get_file()));
 
         if ( (unsigned char)data[1] == 0xd8 ) {
-            err = img->loadJPEGFromMemory(data, ri->get_thumbLength());
+            // a JPEG preview can be several megapixels, it is decoded at the lowest scale which still covers the thumbnail
+            err = img->loadJPEGFromMemory(data, ri->get_thumbLength(), inspectorMode || fixwh == 1 ? 0 : w, inspectorMode || fixwh != 1 ? 0 : h, &fullWidth, &fullHeight);
         } else if (ri->is_ppmThumb()) {
             err = img->loadPPMFromMemory(data, ri->get_thumbWidth(), ri->get_thumbHeight(), ri->get_thumbSwap(), ri->get_thumbBPS());
+            fullWidth = img->width;
+            fullHeight = img->height;
         }
     }
 
@@ -228,11 +234,11 @@ Thumbnail* Thumbnail::loadQuickFromRaw (const Glib::ustring& fname, RawMetaDataL
         tpp->scale = 1.;
     } else {
         if (fixwh == 1) {
-            w = h * img->width / img->height;
-            tpp->scale = (double)img->height / h;
+            w = h * fullWidth / fullHeight;
+            tpp->scale = (double)fullHeight / h;
         } else {
-            h = w * img->height / img->width;
-            tpp->scale = (double)img->width / w;
+            h = w * fullHeight / fullWidth;
+            tpp->scale = (double)fullWidth / w;
         }
     }
 
@@ -1628,45 +1634,311 @@ unsigned char* Thumbnail::getGrayscaleHistEQ (int trim_width)
     return tmpdata;
 }
 
-bool Thumbnail::writeImage (const Glib::ustring& fname, int format)
+namespace
 {
 
-    if (!thumbImg) {
+// The cached images start with this tag, followed by the type of the image, the sample format, two padding bytes,
+// the width and height as 32 bits integers, then the deflated rows. The rows of 16 bits planes are delta coded.
+constexpr char compressedImageTag[4] = {'R', 'T', 'T', 'Z'};
+
+enum class ImageCode : guint8 {
+    IMAGE8,
+    IMAGE16,
+    IMAGEFLOAT
+};
+
+enum class SampleCode : guint8 {
+    UINT8,  // interleaved 8 bits rows
+    UINT16, // 16 bits planes, which Imagefloat thumbnails are quantized to when their values fit
+    FLOAT   // float planes, for the Imagefloat thumbnails with out of range values
+};
+
+template<class T>
+void appendRows (std::string& data, const T* row, int length)
+{
+    data.append (reinterpret_cast<const char*> (row), length * sizeof (T));
+}
+
+template<class T>
+bool readRows (const char*& data, const char* end, T* row, int length)
+{
+    const std::size_t size = length * sizeof (T);
+
+    if (static_cast<std::size_t> (end - data) < size) {
         return false;
     }
 
-    Glib::ustring fullFName = fname + ".rtti";
+    memcpy (row, data, size);
+    data += size;
+    return true;
+}
+
+template<class T>
+void deltaEncode (const T* src, T* dst, int length, int stride)
+{
+    for (int j = 0; j < length; j++) {
+        dst[j] = j < stride ? src[j] : src[j] - src[j - stride];
+    }
+}
 
-    FILE* f = g_fopen (fullFName.c_str (), "wb");
+template<class T>
+void deltaDecode (T* row, int length, int stride)
+{
+    for (int j = stride; j < length; j++) {
+        row[j] += row[j - stride];
+    }
+}
+
+// Deflates rows at the end of a string, which is sized once for the whole stream
+class RowDeflater
+{
+public:
+    RowDeflater (std::string& data, std::size_t rawSize) : data (data), start (data.size ()), success (false)
+    {
+        memset (&stream, 0, sizeof (stream));
+
+        if (deflateInit (&stream, Z_BEST_SPEED) == Z_OK) {
+            data.resize (start + deflateBound (&stream, rawSize));
+            stream.next_out = reinterpret_cast<Bytef*> (&data[start]);
+            stream.avail_out = data.size () - start;
+            success = true;
+        }
+    }
+
+    ~RowDeflater ()
+    {
+        deflateEnd (&stream);
+    }
+
+    template<class T>
+    void append (const T* row, int length)
+    {
+        if (success) {
+            stream.next_in = reinterpret_cast<Bytef*> (const_cast<T*> (row));
+            stream.avail_in = length * sizeof (T);
+            // the output is large enough for the whole stream, so deflate always consumes all the input
+            success = deflate (&stream, Z_NO_FLUSH) == Z_OK && stream.avail_in == 0;
+        }
+    }
+
+    bool finish ()
+    {
+        success = success && deflate (&stream, Z_FINISH) == Z_STREAM_END;
+        data.resize (success ? start + stream.total_out : start);
+        return success;
+    }
+
+private:
+    std::string& data;
+    const std::size_t start;
+    bool success;
+    z_stream stream;
+};
+
+// Inflates rows straight into their destination
+class RowInflater
+{
+public:
+    RowInflater (const char* data, std::size_t size) : success (false)
+    {
+        memset (&stream, 0, sizeof (stream));
+        stream.next_in = reinterpret_cast<Bytef*> (const_cast<char*> (data));
+        stream.avail_in = size;
+        success = inflateInit (&stream) == Z_OK;
+    }
+
+    ~RowInflater ()
+    {
+        inflateEnd (&stream);
+    }
+
+    template<class T>
+    bool read (T* row, int length)
+    {
+        if (success) {
+            stream.next_out = reinterpret_cast<Bytef*> (row);
+            stream.avail_out = length * sizeof (T);
+            const int result = inflate (&stream, Z_SYNC_FLUSH);
+            success = (result == Z_OK || result == Z_STREAM_END) && stream.avail_out == 0;
+        }
+
+        return success;
+    }
+
+    // checks that the whole stream has been read, up to its checksum
+    bool finish ()
+    {
+        if (success) {
+            Bytef end;
+            stream.next_out = &end;
+            stream.avail_out = 0;
+            success = inflate (&stream, Z_FINISH) == Z_STREAM_END;
+        }
+
+        return success;
+    }
+
+private:
+    bool success;
+    z_stream stream;
+};
+
+bool fitsIn16Bits (const Imagefloat& image)
+{
+    for (int i = 0; i < image.getHeight(); i++) {
+        for (int j = 0; j < image.getWidth(); j++) {
+            // written so that NaNs don't fit
+            if (!(image.r(i, j) >= 0.f && image.r(i, j) <= 65535.f && image.g(i, j) >= 0.f && image.g(i, j) <= 65535.f && image.b(i, j) >= 0.f && image.b(i, j) <= 65535.f)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+template<class T>
+void deflatePlanes (RowDeflater& deflater, const PlanarRGBData<T>& image)
+{
+    const PlanarPtr<T>* const planes[3] = {&image.r, &image.g, &image.b};
+    std::vector<T> buffer (image.getWidth());
+
+    for (int c = 0; c < 3; c++) {
+        for (int i = 0; i < image.getHeight(); i++) {
+            deltaEncode ((*planes[c])(i), buffer.data(), image.getWidth(), 1);
+            deflater.append (buffer.data(), image.getWidth());
+        }
+    }
+}
+
+void deflateQuantizedPlanes (RowDeflater& deflater, const Imagefloat& image)
+{
+    const PlanarPtr<float>* const planes[3] = {&image.r, &image.g, &image.b};
+    std::vector<guint16> row (image.getWidth());
+    std::vector<guint16> buffer (image.getWidth());
+
+    for (int c = 0; c < 3; c++) {
+        for (int i = 0; i < image.getHeight(); i++) {
+            const float* const src = (*planes[c])(i);
+
+            for (int j = 0; j < image.getWidth(); j++) {
+                row[j] = src[j] + 0.5f;
+            }
 
-    if (!f) {
+            deltaEncode (row.data(), buffer.data(), image.getWidth(), 1);
+            deflater.append (buffer.data(), image.getWidth());
+        }
+    }
+}
+
+template<class T>
+bool inflatePlanes (RowInflater& inflater, PlanarRGBData<T>& image, bool deltaCoded)
+{
+    PlanarPtr<T>* const planes[3] = {&image.r, &image.g, &image.b};
+    bool success = true;
+
+    for (int c = 0; c < 3 && success; c++) {
+        for (int i = 0; i < image.getHeight() && success; i++) {
+            success = inflater.read ((*planes[c])(i), image.getWidth());
+
+            if (deltaCoded) {
+                deltaDecode ((*planes[c])(i), image.getWidth(), 1);
+            }
+        }
+    }
+
+    return success;
+}
+
+bool inflateQuantizedPlanes (RowInflater& inflater, Imagefloat& image)
+{
+    PlanarPtr<float>* const planes[3] = {&image.r, &image.g, &image.b};
+    std::vector<guint16> buffer (image.getWidth());
+    bool success = true;
+
+    for (int c = 0; c < 3 && success; c++) {
+        for (int i = 0; i < image.getHeight() && success; i++) {
+            success = inflater.read (buffer.data(), image.getWidth());
+            deltaDecode (buffer.data(), image.getWidth(), 1);
+            float* const dst = (*planes[c])(i);
+
+            for (int j = 0; j < image.getWidth(); j++) {
+                dst[j] = buffer[j];
+            }
+        }
+    }
+
+    return success;
+}
+
+}
+
+bool Thumbnail::writeImage (std::string& data) const
+{
+
+    if (!thumbImg) {
         return false;
     }
 
-    fwrite (thumbImg->getType(), sizeof (char), strlen(thumbImg->getType()), f);
-    fputc ('\n', f);
-    guint32 w = guint32(thumbImg->width);
-    guint32 h = guint32(thumbImg->height);
-    fwrite (&w, sizeof (guint32), 1, f);
-    fwrite (&h, sizeof (guint32), 1, f);
+    ImageCode imageCode;
+    SampleCode sampleCode;
+    std::size_t sampleSize;
 
     if (thumbImg->getType() == sImage8) {
-        Image8 *image = static_cast<Image8*>(thumbImg);
-        image->writeData(f);
+        imageCode = ImageCode::IMAGE8;
+        sampleCode = SampleCode::UINT8;
+        sampleSize = 1;
     } else if (thumbImg->getType() == sImage16) {
-        Image16 *image = static_cast<Image16*>(thumbImg);
-        image->writeData(f);
+        imageCode = ImageCode::IMAGE16;
+        sampleCode = SampleCode::UINT16;
+        sampleSize = 2;
     } else if (thumbImg->getType() == sImagefloat) {
-        Imagefloat *image = static_cast<Imagefloat*>(thumbImg);
-        image->writeData(f);
+        imageCode = ImageCode::IMAGEFLOAT;
+        const bool quantize = fitsIn16Bits (*static_cast<const Imagefloat*>(thumbImg));
+        sampleCode = quantize ? SampleCode::UINT16 : SampleCode::FLOAT;
+        sampleSize = quantize ? 2 : 4;
+    } else {
+        return false;
     }
 
-    //thumbImg->writeData(f);
-    fclose (f);
-    return true;
+    data.assign (compressedImageTag, sizeof (compressedImageTag));
+    data += static_cast<char> (imageCode);
+    data += static_cast<char> (sampleCode);
+    data.append (2, '\0');
+    const guint32 w = guint32(thumbImg->width);
+    const guint32 h = guint32(thumbImg->height);
+    appendRows (data, &w, 1);
+    appendRows (data, &h, 1);
+
+    RowDeflater deflater (data, std::size_t(w) * h * 3 * sampleSize);
+
+    if (imageCode == ImageCode::IMAGE8) {
+        const Image8 *image = static_cast<const Image8*>(thumbImg);
+        std::vector<unsigned char> buffer (3 * image->getWidth());
+
+        for (int i = 0; i < image->getHeight(); i++) {
+            deltaEncode (image->r(i), buffer.data(), 3 * image->getWidth(), 3);
+            deflater.append (buffer.data(), 3 * image->getWidth());
+        }
+    } else if (imageCode == ImageCode::IMAGE16) {
+        deflatePlanes (deflater, *static_cast<const Image16*>(thumbImg));
+    } else if (sampleCode == SampleCode::UINT16) {
+        deflateQuantizedPlanes (deflater, *static_cast<const Imagefloat*>(thumbImg));
+    } else {
+        const Imagefloat *image = static_cast<const Imagefloat*>(thumbImg);
+        const PlanarPtr<float>* const planes[3] = {&image->r, &image->g, &image->b};
+
+        for (int c = 0; c < 3; c++) {
+            for (int i = 0; i < image->getHeight(); i++) {
+                deflater.append ((*planes[c])(i), image->getWidth());
+            }
+        }
+    }
+
+    return deflater.finish ();
 }
 
-bool Thumbnail::readImage (const Glib::ustring& fname)
+bool Thumbnail::readImage (const char* data, std::size_t size)
 {
 
     if (thumbImg) {
@@ -1674,52 +1946,63 @@ bool Thumbnail::readImage (const Glib::ustring& fname)
         thumbImg = nullptr;
     }
 
-    Glib::ustring fullFName = fname + ".rtti";
+    const char* pos = data;
+    const char* const end = data + size;
+    bool success = false;
 
-    if (!Glib::file_test (fullFName, Glib::FILE_TEST_EXISTS)) {
+    if (size < sizeof (compressedImageTag) + 4 || memcmp (data, compressedImageTag, sizeof (compressedImageTag))) {
         return false;
     }
 
-    FILE* f = g_fopen (fullFName.c_str (), "rb");
+    const ImageCode imageCode = static_cast<ImageCode> (data[4]);
+    const SampleCode sampleCode = static_cast<SampleCode> (data[5]);
+    pos += sizeof (compressedImageTag) + 4;
+
+    guint32 width, height;
 
-    if (!f) {
+    if (!readRows (pos, end, &width, 1) || !readRows (pos, end, &height, 1)) {
         return false;
     }
 
-    char imgType[31];  // 30 -> arbitrary size, but should be enough for all image type's name
-    fgets(imgType, 30, f);
-    imgType[strlen(imgType) - 1] = '\0'; // imgType has a \n trailing character, so we overwrite it by the \0 char
+    RowInflater inflater (pos, end - pos);
 
-    guint32 width, height;
-    fread (&width, 1, sizeof (guint32), f);
-    fread (&height, 1, sizeof (guint32), f);
+    if (imageCode == ImageCode::IMAGE8 && sampleCode == SampleCode::UINT8) {
+        Image8 *image = new Image8(width, height);
+        success = true;
 
-    bool success = false;
+        for (int i = 0; i < image->getHeight() && success; i++) {
+            success = inflater.read (image->r(i), 3 * image->getWidth());
+            deltaDecode (image->r(i), 3 * image->getWidth(), 3);
+        }
 
-    if (!strcmp(imgType, sImage8)) {
-        Image8 *image = new Image8(width, height);
-        image->readData(f);
         thumbImg = image;
-        success = true;
-    } else if (!strcmp(imgType, sImage16)) {
+    } else if (imageCode == ImageCode::IMAGE16 && sampleCode == SampleCode::UINT16) {
         Image16 *image = new Image16(width, height);
-        image->readData(f);
+        success = inflatePlanes (inflater, *image, true);
         thumbImg = image;
-        success = true;
-    } else if (!strcmp(imgType, sImagefloat)) {
+    } else if (imageCode == ImageCode::IMAGEFLOAT && sampleCode == SampleCode::UINT16) {
         Imagefloat *image = new Imagefloat(width, height);
-        image->readData(f);
+        success = inflateQuantizedPlanes (inflater, *image);
+        thumbImg = image;
+    } else if (imageCode == ImageCode::IMAGEFLOAT && sampleCode == SampleCode::FLOAT) {
+        Imagefloat *image = new Imagefloat(width, height);
+        success = inflatePlanes (inflater, *image, false);
         thumbImg = image;
-        success = true;
     } else {
-        printf("readImage: Unsupported image type \"%s\"!\n", imgType);
+        printf("readImage: Unsupported image encoding %d/%d!\n", int(imageCode), int(sampleCode));
+    }
+
+    success = success && inflater.finish ();
+
+    if (!success) {
+        delete thumbImg;
+        thumbImg = nullptr;
     }
 
-    fclose(f);
     return success;
 }
 
-bool Thumbnail::readData  (const Glib::ustring& fname)
+bool Thumbnail::readData  (const std::string& data)
 {
     setlocale(LC_NUMERIC, "C"); // to set decimal point to "."
     Glib::KeyFile keyFile;
@@ -1728,7 +2011,9 @@ bool Thumbnail::readData  (const Glib::ustring& fname)
         MyMutex::MyLock thmbLock(thumbMutex);
 
         try {
-            keyFile.load_from_file (fname);
+            if (data.empty () || !keyFile.load_from_data (data)) {
+                return false;
+            }
         } catch (Glib::Error&) {
             return false;
         }
@@ -1804,18 +2089,18 @@ bool Thumbnail::readData  (const Glib::ustring& fname)
         return true;
     } catch (Glib::Error &err) {
         if (options.rtSettings.verbose) {
-            printf("Thumbnail::readData / Error code %d while reading values from \"%s\":\n%s\n", err.code(), fname.c_str(), err.what().c_str());
+            printf("Thumbnail::readData / Error code %d while reading values:\n%s\n", err.code(), err.what().c_str());
         }
     } catch (...) {
         if (options.rtSettings.verbose) {
-            printf("Thumbnail::readData / Unknown exception while trying to load \"%s\"!\n", fname.c_str());
+            printf("Thumbnail::readData / Unknown exception while trying to load the values!\n");
         }
     }
 
     return false;
 }
 
-bool Thumbnail::writeData  (const Glib::ustring& fname)
+bool Thumbnail::writeData  (std::string& data)
 {
     MyMutex::MyLock thmbLock(thumbMutex);
 
@@ -1826,7 +2111,9 @@ bool Thumbnail::writeData  (const Glib::ustring& fname)
         Glib::KeyFile keyFile;
 
         try {
-            keyFile.load_from_file (fname);
+            if (!data.empty ()) {
+                keyFile.load_from_data (data);
+            }
         } catch (Glib::Error&) {}
 
         keyFile.set_double  ("LiveThumbData", "CamWBRed", camwbRed);
@@ -1850,11 +2137,11 @@ bool Thumbnail::writeData  (const Glib::ustring& fname)
 
     } catch (Glib::Error& err) {
         if (options.rtSettings.verbose) {
-            printf("Thumbnail::writeData / Error code %d while reading values from \"%s\":\n%s\n", err.code(), fname.c_str(), err.what().c_str());
+            printf("Thumbnail::writeData / Error code %d while writing values:\n%s\n", err.code(), err.what().c_str());
         }
     } catch (...) {
         if (options.rtSettings.verbose) {
-            printf("Thumbnail::writeData / Unknown exception while trying to save \"%s\"!\n", fname.c_str());
+            printf("Thumbnail::writeData / Unknown exception while trying to save the values!\n");
         }
     }
 
@@ -1862,38 +2149,21 @@ bool Thumbnail::writeData  (const Glib::ustring& fname)
         return false;
     }
 
-    FILE *f = g_fopen (fname.c_str (), "wt");
-
-    if (!f) {
-        if (options.rtSettings.verbose) {
-            printf("Thumbnail::writeData / Error: unable to open file \"%s\" with write access!\n", fname.c_str());
-        }
-
-        return false;
-    } else {
-        fprintf (f, "%s", keyData.c_str ());
-        fclose (f);
-    }
-
+    data = keyData;
     return true;
 }
 
-bool Thumbnail::readEmbProfile  (const Glib::ustring& fname)
+bool Thumbnail::readEmbProfile  (const std::string& data)
 {
 
-    FILE* f = g_fopen (fname.c_str (), "rb");
-
-    if (!f) {
+    if (data.empty ()) {
         embProfileData = nullptr;
         embProfile = nullptr;
         embProfileLength = 0;
     } else {
-        fseek (f, 0, SEEK_END);
-        embProfileLength = ftell (f);
-        fseek (f, 0, SEEK_SET);
+        embProfileLength = data.size ();
         embProfileData = new unsigned char[embProfileLength];
-        fread (embProfileData, 1, embProfileLength, f);
-        fclose (f);
+        memcpy (embProfileData, data.data (), embProfileLength);
         embProfile = cmsOpenProfileFromMem (embProfileData, embProfileLength);
         return true;
     }
@@ -1901,52 +2171,43 @@ bool Thumbnail::readEmbProfile  (const Glib::ustring& fname)
     return false;
 }
 
-bool Thumbnail::writeEmbProfile (const Glib::ustring& fname)
+bool Thumbnail::writeEmbProfile (std::string& data) const
 {
 
     if (embProfileData) {
-        FILE* f = g_fopen(fname.c_str (), "wb");
-
-        if (f) {
-            fwrite (embProfileData, 1, embProfileLength, f);
-            fclose (f);
-            return true;
-        }
+        data.assign (reinterpret_cast<const char*> (embProfileData), embProfileLength);
+        return true;
     }
 
+    data.clear ();
     return false;
 }
 
-bool Thumbnail::readAEHistogram  (const Glib::ustring& fname)
+bool Thumbnail::readAEHistogram  (const std::string& data)
 {
 
-    FILE* f = g_fopen (fname.c_str (), "rb");
+    const std::size_t size = (65536 >> aeHistCompression) * sizeof (aeHistogram[0]);
 
-    if (!f) {
+    if (data.size () != size) {
         aeHistogram(0);
     } else {
         aeHistogram(65536 >> aeHistCompression);
-        fread (&aeHistogram[0], 1, (65536 >> aeHistCompression)*sizeof(aeHistogram[0]), f);
-        fclose (f);
+        memcpy (&aeHistogram[0], data.data (), size);
         return true;
     }
 
     return false;
 }
 
-bool Thumbnail::writeAEHistogram (const Glib::ustring& fname)
+bool Thumbnail::writeAEHistogram (std::string& data) const
 {
 
     if (aeHistogram) {
-        FILE* f = g_fopen (fname.c_str (), "wb");
-
-        if (f) {
-            fwrite (&aeHistogram[0], 1, (65536 >> aeHistCompression)*sizeof(aeHistogram[0]), f);
-            fclose (f);
-            return true;
-        }
+        data.assign (reinterpret_cast<const char*> (&aeHistogram[0]), (65536 >> aeHistCompression) * sizeof (aeHistogram[0]));
+        return true;
     }
 
+    data.clear ();
     return false;
 }
 
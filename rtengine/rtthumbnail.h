@@ -21,6 +21,7 @@
 
 #include "rawmetadatalocation.h"
 #include "procparams.h"
+#include <string>
 #include <glibmm.h>
 #include <lcms2.h>
 #include "image8.h"
@@ -89,17 +90,19 @@ public:
     void applyAutoExp (procparams::ProcParams& pparams);
 
     unsigned char* getGrayscaleHistEQ (int trim_width);
-    bool writeImage (const Glib::ustring& fname, int format);
-    bool readImage (const Glib::ustring& fname);
+    // The cached data are exchanged as memory blocks, stored by the cache manager of the GUI
+    // The image is deflated, and its rows are inflated straight into the thumbnail image
+    bool writeImage (std::string& data) const;
+    bool readImage (const char* data, std::size_t size);
 
-    bool readData  (const Glib::ustring& fname);
-    bool writeData  (const Glib::ustring& fname);
+    bool readData  (const std::string& data);
+    bool writeData  (std::string& data);
 
-    bool readEmbProfile  (const Glib::ustring& fname);
-    bool writeEmbProfile (const Glib::ustring& fname);
+    bool readEmbProfile  (const std::string& data);
+    bool writeEmbProfile (std::string& data) const;
 
-    bool readAEHistogram  (const Glib::ustring& fname);
-    bool writeAEHistogram (const Glib::ustring& fname);
+    bool readAEHistogram  (const std::string& data);
+    bool writeAEHistogram (std::string& data) const;
 
     unsigned char* getImage8Data();  // accessor to the 8bit image if it is one, which should be the case for the "Inspector" mode.
 
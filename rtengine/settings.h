@@ -50,6 +50,13 @@ public:
     bool            verbose;
     Glib::ustring   darkFramesPath;         ///< The default directory for dark frames
     Glib::ustring   flatFieldsPath;         ///< The default directory for flat fields
+    bool            demosaicCache;          ///< Keep the demosaiced raw images on disk to skip the demosaicing when they are opened again
+    Glib::ustring   demosaicCacheDir;       ///< The directory of the demosaic cache
+    int             demosaicCacheSize;      ///< Maximum size of the demosaic cache, in MiB
+    int             previewCacheSize;       ///< Memory budget of the intermediate images of the preview kept to resume its Lab pipeline, in MiB
+    int             amazeTileSize;          ///< Tile size of the AMaZE demosaicing, 0 to choose it from the size of the L2 cache
+    bool            tracing;                ///< Record the processing spans and write them as a Chrome trace at exit
+    Glib::ustring   traceFile;              ///< The file of the Chrome trace
     Glib::ustring   adobe;                  // default name of AdobeRGB1998
     Glib::ustring   prophoto;               // default name of Prophoto
     Glib::ustring   prophoto10;             // default name of Prophoto
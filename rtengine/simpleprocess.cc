@@ -29,6 +29,8 @@
 #include "rawimagesource.h"
 #include "../rtgui/multilangmgr.h"
 #include "mytime.h"
+#include "utils.h"
+#include "tracing.h"
 #undef THREAD_PRIORITY_NORMAL
 
 namespace rtengine
@@ -37,6 +39,7 @@ extern const Settings* settings;
 
 IImage16* processImage (ProcessingJob* pjob, int& errorCode, ProgressListener* pl, bool tunnelMetaData, bool flush)
 {
+    TRACE_SPAN("processImage")
 
     errorCode = 0;
 
@@ -824,7 +827,10 @@ IImage16* processImage (ProcessingJob* pjob, int& errorCode, ProgressListener* p
         CurveFactory::curveToning(params.colorToning.cl2curve, cl2Toningcurve, 1);
     }
 
-    LabImage* labView = new LabImage (fw, fh);
+    // rgbProc reads each tile of its input before writing the same tile of its output, so when baseImg has
+    // no row padding its planes are reused for the Lab data instead of allocating another full size image
+    const bool labInPlace = LabImage::canWrap(baseImg);
+    LabImage* labView = labInPlace ? new LabImage (baseImg) : new LabImage (fw, fh);
 
     if(params.blackwhite.enabled) {
         CurveFactory::curveBW (params.blackwhite.beforeCurve, params.blackwhite.afterCurve, hist16, dummy, customToneCurvebw1, customToneCurvebw2, 1);
@@ -881,8 +887,11 @@ IImage16* processImage (ProcessingJob* pjob, int& errorCode, ProgressListener* p
     customToneCurvebw1.Reset();
     customToneCurvebw2.Reset();
 
-    // Freeing baseImg because not used anymore
-    delete baseImg;
+    // Freeing baseImg because not used anymore (unless labView owns it now)
+    if (!labInPlace) {
+        delete baseImg;
+    }
+
     baseImg = nullptr;
 
     if (shmap) {
@@ -1253,6 +1262,11 @@ IImage16* processImage (ProcessingJob* pjob, int& errorCode, ProgressListener* p
 //    if( settings->verbose )
 //           printf("Total:- %d usec\n", t2.etime(t1));
 
+    // the peak of the whole process, which only grows: with several images in flight, it can't tell what each one took
+    if (settings->verbose) {
+        printf("Peak memory usage of the process so far: %lu MiB\n", static_cast<unsigned long>(getPeakMemoryUsage() >> 20));
+    }
+
     if (!job->initialImage) {
         ii->decreaseRef ();
     }
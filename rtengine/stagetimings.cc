@@ -0,0 +1,62 @@
+/*
+ *  This file is part of RawTherapee.
+ *
+ *  RawTherapee is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  RawTherapee is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "stagetimings.h"
+
+#include "tracing.h"
+#include "utils.h"
+
+namespace rtengine
+{
+
+StageTimings& StageTimings::getInstance ()
+{
+    static StageTimings instance;
+    return instance;
+}
+
+void StageTimings::setEnabled (bool _enabled)
+{
+    Tracer::getInstance().setStageTimings(_enabled);
+}
+
+bool StageTimings::isEnabled () const
+{
+    return Tracer::getInstance().hasStageTimings();
+}
+
+std::map<std::string, StageTimings::Stage> StageTimings::takeStages ()
+{
+    MyMutex::MyLock lock(mutex);
+
+    std::map<std::string, Stage> result;
+    result.swap(stages);
+    return result;
+}
+
+void StageTimings::add (const char* name, long microseconds)
+{
+    const std::size_t peakMemory = getPeakMemoryUsage();
+
+    MyMutex::MyLock lock(mutex);
+
+    Stage& stage = stages[name];
+    ++stage.calls;
+    stage.microseconds += microseconds;
+    stage.peakMemory = peakMemory;
+}
+
+}
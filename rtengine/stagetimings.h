@@ -0,0 +1,63 @@
+/*
+ *  This file is part of RawTherapee.
+ *
+ *  RawTherapee is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  RawTherapee is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <string>
+
+#include "noncopyable.h"
+#include "../rtgui/threadutils.h"
+
+namespace rtengine
+{
+
+/**
+ * @brief Accumulates the time spent in the pipeline stages instrumented with BENCHSTAGE
+ *
+ * The stages are spans of the Tracer, which passes them here. Nothing is recorded unless a benchmark harness called
+ * setEnabled(true) before starting the processing.
+ */
+class StageTimings final :
+    public NonCopyable
+{
+public:
+    struct Stage {
+        unsigned int calls;
+        long microseconds;
+        std::size_t peakMemory; // peak memory usage of the process at the end of the last call, in bytes
+    };
+
+    static StageTimings& getInstance ();
+
+    void setEnabled (bool _enabled);
+    bool isEnabled () const;
+
+    /** @return the stages recorded since the last call, and forgets them */
+    std::map<std::string, Stage> takeStages ();
+
+    /** Records one call of a stage, called by the Tracer */
+    void add (const char* name, long microseconds);
+
+private:
+    StageTimings () = default;
+
+    std::map<std::string, Stage> stages;
+    MyMutex mutex;
+};
+
+}
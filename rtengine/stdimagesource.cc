@@ -22,6 +22,7 @@
 #include "imageio.h"
 #include "curves.h"
 #include "color.h"
+#include "StopWatch.h"
 
 #undef THREAD_PRIORITY_NORMAL
 
@@ -104,6 +105,7 @@ void StdImageSource::getSampleFormat (const Glib::ustring &fname, IIOSampleForma
  */
 int StdImageSource::load (const Glib::ustring &fname, bool batch)
 {
+    BENCHSTAGE("load")
 
     fileName = fname;
 
@@ -252,21 +254,16 @@ void StdImageSource::colorSpaceConversion (Imagefloat* im, const ColorManagement
             in = iccStore->getsRGBProfile ();
         }
 
-        lcmsMutex->lock ();
-        cmsHTRANSFORM hTransform = cmsCreateTransform (in, TYPE_RGB_FLT, out, TYPE_RGB_FLT, INTENT_RELATIVE_COLORIMETRIC,
-                                   cmsFLAGS_NOOPTIMIZE | cmsFLAGS_NOCACHE);
-        lcmsMutex->unlock ();
+        const ICCStore::Transform transform = iccStore->getTransform (in, TYPE_RGB_FLT, out, TYPE_RGB_FLT, INTENT_RELATIVE_COLORIMETRIC, cmsFLAGS_NOOPTIMIZE);
 
-        if(hTransform) {
+        if(transform) {
             // Convert to the [0.0 ; 1.0] range
             im->normalizeFloatTo1();
 
-            im->ExecCMSTransform(hTransform);
+            im->ExecCMSTransform(transform.get());
 
             // Converting back to the [0.0 ; 65535.0] range
             im->normalizeFloatTo65535();
-
-            cmsDeleteTransform(hTransform);
         } else {
             printf("Could not convert from %s to %s\n", in == embedded ? "embedded profile" : cmp.input.data(), cmp.working.data());
         }
@@ -0,0 +1,239 @@
+/*
+ *  This file is part of RawTherapee.
+ *
+ *  RawTherapee is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  RawTherapee is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "tracing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+
+#include <glib/gstdio.h>
+
+#include "stagetimings.h"
+
+namespace rtengine
+{
+
+struct Tracer::Buffer {
+    struct Span {
+        const char* name;
+        unsigned int thread;
+        std::int64_t begin;
+        std::int64_t duration;
+    };
+
+    Buffer () :
+        spans(bufferSize),
+        count(0),
+        startCount(0),
+        thread(0),
+        inUse(false)
+    {
+    }
+
+    std::vector<Span> spans;
+    // only written by the thread of the buffer, a span is published by the release store of the incremented count
+    std::atomic<std::size_t> count;
+    std::size_t startCount;  // count at start()
+    unsigned int thread;
+    bool inUse;
+};
+
+namespace
+{
+
+// gives the buffer of the thread back to the tracer when the thread ends
+class ThreadBuffer final :
+    public NonCopyable
+{
+public:
+    Tracer::Buffer* buffer = nullptr;
+
+    ~ThreadBuffer ()
+    {
+        if (buffer) {
+            Tracer::getInstance().releaseBuffer(buffer);
+        }
+    }
+};
+
+thread_local ThreadBuffer threadBuffer;
+
+const auto startTime = std::chrono::steady_clock::now();
+
+}
+
+constexpr std::size_t Tracer::bufferSize;
+std::atomic<bool> Tracer::enabled(false);
+
+Tracer::Tracer () :
+    recording(false),
+    stageTimings(false),
+    startTime(0),
+    threadCount(0)
+{
+}
+
+Tracer::~Tracer ()
+{
+    enabled = false;
+}
+
+Tracer& Tracer::getInstance ()
+{
+    static Tracer instance;
+    return instance;
+}
+
+void Tracer::start (const Glib::ustring& _fileName)
+{
+    MyMutex::MyLock lock(mutex);
+
+    fileName = _fileName;
+    startTime = now();
+
+    // the counts keep growing, the threads tracing meanwhile may still add spans begun before, see stop()
+    for (auto& buffer : buffers) {
+        buffer->startCount = buffer->count.load(std::memory_order_acquire);
+    }
+
+    recording.store(true, std::memory_order_release);
+    updateEnabled();
+}
+
+bool Tracer::stop ()
+{
+    MyMutex::MyLock lock(mutex);
+
+    if (!recording.exchange(false)) {
+        return true;
+    }
+
+    updateEnabled();
+
+    FILE* const file = g_fopen(fileName.c_str(), "wb");
+
+    if (!file) {
+        return false;
+    }
+
+    fprintf(file, "{\"traceEvents\":[\n");
+    bool first = true;
+
+    for (const auto& buffer : buffers) {
+        // a thread which saw tracing enabled just before it was disabled may still write one span, in the slot after
+        // the last one published, which is the oldest of a full buffer, so it isn't read
+        const std::size_t end = buffer->count.load(std::memory_order_acquire);
+        const std::size_t begin = std::max(buffer->startCount, end - std::min(end, bufferSize - 1));
+
+        // oldest span first
+        for (std::size_t i = begin; i < end; ++i) {
+            const Buffer::Span& span = buffer->spans[i % bufferSize];
+
+            // a span begun before start() by a thread which was slow to add it
+            if (span.begin < startTime) {
+                continue;
+            }
+
+            fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%" PRId64 ",\"dur\":%" PRId64 "}", first ? "" : ",\n", span.name, span.thread, span.begin, span.duration);
+            first = false;
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+    return fclose(file) == 0;
+}
+
+std::int64_t Tracer::now ()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void Tracer::add (const char* name, std::int64_t begin, std::int64_t end, bool stage)
+{
+    if (stage && stageTimings.load(std::memory_order_relaxed)) {
+        StageTimings::getInstance().add(name, end - begin);
+    }
+
+    // the span began while tracing was enabled, but stop() may have written the trace since
+    if (!recording.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    if (!threadBuffer.buffer) {
+        threadBuffer.buffer = acquireBuffer();
+    }
+
+    Buffer* const buffer = threadBuffer.buffer;
+    const std::size_t count = buffer->count.load(std::memory_order_relaxed);
+    Buffer::Span& span = buffer->spans[count % bufferSize];
+    span.name = name;
+    span.thread = buffer->thread;
+    span.begin = begin;
+    span.duration = end - begin;
+    buffer->count.store(count + 1, std::memory_order_release);
+}
+
+void Tracer::setStageTimings (bool _stageTimings)
+{
+    MyMutex::MyLock lock(mutex);
+    stageTimings = _stageTimings;
+    updateEnabled();
+}
+
+bool Tracer::hasStageTimings () const
+{
+    return stageTimings;
+}
+
+void Tracer::updateEnabled ()
+{
+    // called with the mutex locked
+    enabled.store(recording || stageTimings, std::memory_order_release);
+}
+
+Tracer::Buffer* Tracer::acquireBuffer ()
+{
+    MyMutex::MyLock lock(mutex);
+
+    Buffer* buffer = nullptr;
+
+    // reuse the buffer of a finished thread, its spans keep their thread id
+    for (auto& candidate : buffers) {
+        if (!candidate->inUse) {
+            buffer = candidate.get();
+            break;
+        }
+    }
+
+    if (!buffer) {
+        buffers.emplace_back(new Buffer);
+        buffer = buffers.back().get();
+    }
+
+    buffer->inUse = true;
+    buffer->thread = ++threadCount;
+    return buffer;
+}
+
+void Tracer::releaseBuffer (Buffer* buffer)
+{
+    MyMutex::MyLock lock(mutex);
+    buffer->inUse = false;
+}
+
+}
@@ -0,0 +1,121 @@
+/*
+ *  This file is part of RawTherapee.
+ *
+ *  RawTherapee is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  RawTherapee is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glibmm/ustring.h>
+
+#include "noncopyable.h"
+#include "../rtgui/threadutils.h"
+
+namespace rtengine
+{
+
+/**
+ * @brief Records the spans of TRACE_SPAN in per thread ring buffers and writes them as a Chrome trace
+ *
+ * The trace can be opened with chrome://tracing or https://ui.perfetto.dev. The spans of BENCHSTAGE are also
+ * accumulated by StageTimings while it is enabled. When neither is enabled, a span costs the test of a flag. Each
+ * thread keeps its last Tracer::bufferSize spans. start() and stop() may be called while other threads are tracing:
+ * a span which ends after stop() is dropped.
+ */
+class Tracer final :
+    public NonCopyable
+{
+public:
+    struct Buffer;
+
+    static constexpr std::size_t bufferSize = 16384;
+
+    static Tracer& getInstance ();
+
+    /** @return true while recording or timing the stages, spans begun meanwhile are measured */
+    static bool isEnabled ()
+    {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    /** Starts recording, the spans will be written to fileName by stop() */
+    void start (const Glib::ustring& _fileName);
+
+    /** Stops recording and writes the spans recorded since start(). @return false if the file can't be written */
+    bool stop ();
+
+    /** @return the current time in microseconds */
+    static std::int64_t now ();
+
+    void add (const char* name, std::int64_t begin, std::int64_t end, bool stage);
+
+    /** Passes the spans of the stages to StageTimings, see StageTimings::setEnabled() */
+    void setStageTimings (bool _stageTimings);
+    bool hasStageTimings () const;
+
+    void releaseBuffer (Buffer* buffer);
+
+private:
+    Tracer ();
+    ~Tracer ();
+
+    Buffer* acquireBuffer ();
+    void updateEnabled ();
+
+    static std::atomic<bool> enabled; // recording || stageTimings
+
+    std::atomic<bool> recording;
+    std::atomic<bool> stageTimings;
+
+    Glib::ustring fileName;
+    std::int64_t startTime;
+    std::vector<std::unique_ptr<Buffer>> buffers;
+    unsigned int threadCount;
+    MyMutex mutex;
+};
+
+class TraceSpan final :
+    public NonCopyable
+{
+public:
+    explicit TraceSpan (const char* _name, bool _stage = false) :
+        name(_name),
+        stage(_stage),
+        begin(Tracer::isEnabled() ? Tracer::now() : -1)
+    {
+    }
+
+    ~TraceSpan ()
+    {
+        if (begin >= 0) {
+            Tracer::getInstance().add(name, begin, Tracer::now(), stage);
+        }
+    }
+
+private:
+    const char* const name;
+    const bool stage;
+    const std::int64_t begin;
+};
+
+}
+
+#define TRACE_SPAN_VARIABLE2(line) traceSpan##line
+#define TRACE_SPAN_VARIABLE(line) TRACE_SPAN_VARIABLE2(line)
+// Traces the rest of the enclosing scope under name, which has to be a string literal
+#define TRACE_SPAN(name) rtengine::TraceSpan TRACE_SPAN_VARIABLE(__LINE__)(name);
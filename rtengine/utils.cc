@@ -21,6 +21,16 @@
 #include <cstdio>
 #include "rt_math.h"
 
+#ifdef WIN32
+#include <windows.h>
+#ifndef PSAPI_VERSION
+#define PSAPI_VERSION 2
+#endif
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
 #include "utils.h"
 #include "rt_math.h"
 
@@ -245,4 +255,29 @@ bool hasPngExtension(const Glib::ustring& filename)
    return getFileExtension(filename) == "png";
 }
 
+std::size_t getPeakMemoryUsage()
+{
+#ifdef WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PeakWorkingSetSize;
+    }
+
+    return 0;
+#else
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+
+#ifdef __APPLE__
+    return usage.ru_maxrss; // bytes
+#else
+    return static_cast<std::size_t>(usage.ru_maxrss) * 1024; // kilobytes
+#endif
+#endif
+}
+
 }
@@ -18,6 +18,7 @@
  */
 #pragma once
 
+#include <cstddef>
 #include <type_traits>
 #include <glibmm/ustring.h>
 
@@ -52,4 +53,7 @@ bool hasTiffExtension(const Glib::ustring& filename);
 // Return true if file has .png extension (ignoring case)
 bool hasPngExtension(const Glib::ustring& filename);
 
+// Return the peak resident memory of the process in bytes, or 0 if it can't be determined
+std::size_t getPeakMemoryUsage();
+
 }
@@ -37,7 +37,32 @@
 using namespace std;
 using namespace rtengine;
 
-BatchQueue::BatchQueue (FileCatalog* aFileCatalog) : processing(nullptr), fileCatalog(aFileCatalog), sequence(0), listener(nullptr)
+struct NLParams {
+    BatchQueueListener* listener;
+    int qsize;
+    bool queueEmptied;
+    bool queueError;
+    Glib::ustring queueErrorMessage;
+};
+
+int bqnotifylistenerUI (void* data)
+{
+    NLParams* params = static_cast<NLParams*>(data);
+    params->listener->queueSizeChanged (params->qsize, params->queueEmptied, params->queueError, params->queueErrorMessage);
+    delete params;
+    return 0;
+}
+
+struct BatchQueue::SaveTask {
+    IImage16* img;
+    Glib::ustring fname;
+    SaveFormat saveFormat;
+    BatchQueueEntry* entry; // out of the queue until the image is written, put back in front of it if that fails
+    bool removeParams;      // the recovery params file of the entry can be removed once the image is written
+};
+
+BatchQueue::BatchQueue (FileCatalog* aFileCatalog) : processing(nullptr), fileCatalog(aFileCatalog), sequence(0), listener(nullptr),
+    saveQueue(1), saveThread(nullptr), pendingSaves(0)
 {
 
     location = THLOC_BATCHQUEUE;
@@ -85,6 +110,13 @@ BatchQueue::BatchQueue (FileCatalog* aFileCatalog) : processing(nullptr), fileCa
 
 BatchQueue::~BatchQueue ()
 {
+    // let the encode stage write the images already developed
+    saveQueue.close ();
+
+    if (saveThread) {
+        saveThread->join ();
+    }
+
     MYWRITERLOCK(l, entryRW);
 
     // The listener merges parameters with old values, so delete afterwards
@@ -597,34 +629,19 @@ rtengine::ProcessingJob* BatchQueue::imageReady (rtengine::IImage16* img)
 
     //printf ("fname=%s, %s\n", fname.c_str(), removeExtension(fname).c_str());
 
-    if (img && fname != "") {
-        int err = 0;
-
-        if (saveFormat.format == "tif") {
-            err = img->saveAsTIFF (fname, saveFormat.tiffBits, saveFormat.tiffUncompressed);
-        } else if (saveFormat.format == "png") {
-            err = img->saveAsPNG (fname, saveFormat.pngCompression, saveFormat.pngBits);
-        } else if (saveFormat.format == "jpg") {
-            err = img->saveAsJPEG (fname, saveFormat.jpegQuality, saveFormat.jpegSubSamp);
-        }
-
-        img->free ();
+    SaveTask* task = nullptr;
 
-        if (err) {
-            throw Glib::FileError(Glib::FileError::FAILED, M("MAIN_MSG_CANNOTSAVE") + "\n" + fname);
-        }
-
-        if (saveFormat.saveParams) {
-            // We keep the extension to avoid overwriting the profile when we have
-            // the same output filename with different extension
-            //processing->params.save (removeExtension(fname) + paramFileExtension);
-            processing->params.save (fname + ".out" + paramFileExtension);
-        }
-
-        if (processing->thumbnail) {
-            processing->thumbnail->imageDeveloped ();
-            processing->thumbnail->imageRemovedFromQueue ();
-        }
+    if (img && fname != "") {
+        task = new SaveTask;
+        task->img = img;
+        task->fname = fname;
+        task->saveFormat = saveFormat;
+        task->entry = processing;
+        task->removeParams = false;
+
+        // the name is taken until the image is written, so that the next images don't pick it too
+        Glib::Threads::Mutex::Lock lock(saveMutex);
+        reservedFileNames.insert (fname);
     }
 
     // save temporary params file name: delete as last thing
@@ -637,7 +654,10 @@ rtengine::ProcessingJob* BatchQueue::imageReady (rtengine::IImage16* img)
     {
         MYWRITERLOCK(l, entryRW);
 
-        delete processing;
+        if (!task) {
+            delete processing;
+        }
+
         processing = nullptr;
 
         fd.erase (fd.begin());
@@ -675,7 +695,11 @@ rtengine::ProcessingJob* BatchQueue::imageReady (rtengine::IImage16* img)
     }
 
     if (saveBatchQueue ()) {
-        ::g_remove (processedParams.c_str ());
+        if (task) {
+            task->removeParams = true;
+        } else {
+            ::g_remove (processedParams.c_str ());
+        }
 
         // Delete all files in directory batch when finished, just to be sure to remove zombies
         auto isEmpty = false;
@@ -702,12 +726,126 @@ rtengine::ProcessingJob* BatchQueue::imageReady (rtengine::IImage16* img)
         }
     }
 
+    if (task) {
+        {
+            Glib::Threads::Mutex::Lock lock(saveMutex);
+            ++pendingSaves;
+        }
+
+        if (!saveThread) {
+            saveThread = Glib::Threads::Thread::create (sigc::mem_fun (*this, &BatchQueue::saveThreadFunc));
+        }
+
+        // blocks while the previous image is still waiting to be encoded
+        saveQueue.push (task);
+    }
+
+    if (!processing) {
+        // the queue is stopped or empty: only report it once everything is on disk
+        waitForPendingSaves ();
+    }
+
     redraw ();
     notifyListener (queueEmptied);
 
     return processing ? processing->job : nullptr;
 }
 
+void BatchQueue::saveThreadFunc ()
+{
+    SaveTask* task;
+
+    while (saveQueue.pop (task)) {
+        int err = 0;
+
+        if (task->saveFormat.format == "tif") {
+            err = task->img->saveAsTIFF (task->fname, task->saveFormat.tiffBits, task->saveFormat.tiffUncompressed);
+        } else if (task->saveFormat.format == "png") {
+            err = task->img->saveAsPNG (task->fname, task->saveFormat.pngCompression, task->saveFormat.pngBits);
+        } else if (task->saveFormat.format == "jpg") {
+            err = task->img->saveAsJPEG (task->fname, task->saveFormat.jpegQuality, task->saveFormat.jpegSubSamp);
+        }
+
+        task->img->free ();
+
+        {
+            Glib::Threads::Mutex::Lock lock(saveMutex);
+            reservedFileNames.erase (task->fname);
+        }
+
+        BatchQueueEntry* entry = task->entry;
+
+        if (err) {
+            // the queue has already moved on to the next image: restore the failed entry in front of the waiting ones,
+            // the way error() does, and stop the queue
+            {
+                MYWRITERLOCK(l, entryRW);
+
+                BatchQueueButtonSet* bqbs = new BatchQueueButtonSet (entry);
+                bqbs->setButtonListener (this);
+                entry->addButtonSet (bqbs);
+                entry->processing = false;
+                entry->job = rtengine::ProcessingJob::create(entry->filename, entry->thumbnail->getType() == FT_Raw, entry->params);
+
+                // the recovery params file may have been cleaned up with the batch directory when the queue got empty
+                if (!entry->savedParamsFile.empty()) {
+                    entry->params.save (entry->savedParamsFile);
+                }
+
+                fd.insert (std::find_if (fd.begin (), fd.end (), [] (const ThumbBrowserEntryBase* fdEntry) { return !fdEntry->processing; }), entry);
+            }
+
+            saveBatchQueue ();
+            redraw ();
+
+            if (listener) {
+                NLParams* params = new NLParams;
+                params->listener = listener;
+                {
+                    MYREADERLOCK(l, entryRW);
+                    params->qsize = fd.size();
+                }
+                params->queueEmptied = false;
+                params->queueError = true;
+                params->queueErrorMessage = M("MAIN_MSG_CANNOTSAVE") + "\n" + task->fname;
+                add_idle (bqnotifylistenerUI, params);
+            }
+        } else {
+            if (task->saveFormat.saveParams) {
+                // We keep the extension to avoid overwriting the profile when we have
+                // the same output filename with different extension
+                entry->params.save (task->fname + ".out" + paramFileExtension);
+            }
+
+            if (entry->thumbnail) {
+                entry->thumbnail->imageDeveloped ();
+                entry->thumbnail->imageRemovedFromQueue ();
+            }
+
+            if (task->removeParams) {
+                ::g_remove (entry->savedParamsFile.c_str ());
+            }
+
+            delete entry;
+        }
+
+        delete task;
+
+        Glib::Threads::Mutex::Lock lock(saveMutex);
+        --pendingSaves;
+        saveCond.broadcast ();
+    }
+}
+
+void BatchQueue::waitForPendingSaves ()
+{
+    Glib::Threads::Mutex::Lock lock(saveMutex);
+
+    while (pendingSaves > 0) {
+        saveCond.wait (saveMutex);
+    }
+}
+
 // Calculates automatic filename of processed batch entry, but just the base name
 // example output: "c:\out\converted\dsc0121"
 Glib::ustring BatchQueue::calcAutoFileNameBase (const Glib::ustring& origFileName, int sequence)
@@ -859,10 +997,19 @@ Glib::ustring BatchQueue::autoCompleteFileName (const Glib::ustring& fileName, c
             fname = Glib::ustring::compose ("%1-%2.%3", Glib::build_filename (dstdir,  dstfname), tries, format);
         }
 
-        int fileExists = Glib::file_test (fname, Glib::FILE_TEST_EXISTS);
+        bool reserved;
+
+        {
+            Glib::Threads::Mutex::Lock lock(saveMutex);
+            reserved = reservedFileNames.count (fname);
+        }
+
+        int fileExists = reserved || Glib::file_test (fname, Glib::FILE_TEST_EXISTS);
 
         if (inOverwriteMode && fileExists) {
-            if (::g_remove (fname.c_str ()) != 0) {
+            if (reserved) {
+                fileExists = false;    // the pending image is written first, and then overwritten, like when saving synchronously
+            } else if (::g_remove (fname.c_str ()) != 0) {
                 inOverwriteMode = false;    // failed to delete- revert to old naming scheme
             } else {
                 fileExists = false;    // deleted now
@@ -909,22 +1056,6 @@ void BatchQueue::buttonPressed (LWButton* button, int actionCode, void* actionDa
     }
 }
 
-struct NLParams {
-    BatchQueueListener* listener;
-    int qsize;
-    bool queueEmptied;
-    bool queueError;
-    Glib::ustring queueErrorMessage;
-};
-
-int bqnotifylistenerUI (void* data)
-{
-    NLParams* params = static_cast<NLParams*>(data);
-    params->listener->queueSizeChanged (params->qsize, params->queueEmptied, params->queueError, params->queueErrorMessage);
-    delete params;
-    return 0;
-}
-
 void BatchQueue::notifyListener (bool queueEmptied)
 {
 
@@ -18,10 +18,13 @@
 #ifndef _BATCHQUEUE_
 #define _BATCHQUEUE_
 
+#include <set>
+
 #include <gtkmm.h>
 #include "threadutils.h"
 #include "batchqueueentry.h"
 #include "../rtengine/rtengine.h"
+#include "../rtengine/boundedqueue.h"
 #include "options.h"
 #include "lwbuttonset.h"
 #include "thumbbrowserbase.h"
@@ -62,6 +65,19 @@ protected:
 
     BatchQueueListener* listener;
 
+    // Encode stage: the developed images are compressed and written by a dedicated thread,
+    // so that the next image can be developed in the meantime
+    struct SaveTask;
+    rtengine::BoundedQueue<SaveTask*> saveQueue;
+    Glib::Threads::Thread* saveThread;
+    Glib::Threads::Mutex saveMutex;
+    Glib::Threads::Cond saveCond;
+    unsigned int pendingSaves;
+    std::set<Glib::ustring> reservedFileNames; // output names of the images waiting to be written, guarded by saveMutex
+
+    void saveThreadFunc ();
+    void waitForPendingSaves ();
+
     Glib::ustring autoCompleteFileName (const Glib::ustring& fileName, const Glib::ustring& format);
     Glib::ustring getTempFilenameForParams( const Glib::ustring &filename );
     bool saveBatchQueue ();
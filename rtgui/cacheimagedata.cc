@@ -31,16 +31,16 @@ CacheImageData::CacheImageData ()
 }
 
 /*
- * Load the General, DateTime, ExifInfo, File info and ExtraRawInfo sections of the image data file
+ * Load the General, DateTime, ExifInfo, File info and ExtraRawInfo sections of the image data
  */
-int CacheImageData::load (const Glib::ustring& fname)
+int CacheImageData::load (const std::string& data)
 {
     setlocale(LC_NUMERIC, "C"); // to set decimal point to "."
 
     Glib::KeyFile keyFile;
 
     try {
-        if (keyFile.load_from_file (fname)) {
+        if (!data.empty () && keyFile.load_from_data (data)) {
 
             if (keyFile.has_group ("General")) {
                 if (keyFile.has_key ("General", "MD5")) {
@@ -160,6 +160,18 @@ int CacheImageData::load (const Glib::ustring& fname)
                 if (keyFile.has_key ("FileInfo", "Filetype")) {
                     filetype    = keyFile.get_string ("FileInfo", "Filetype");
                 }
+
+                if (keyFile.has_key ("FileInfo", "Size")) {
+                    fileStamp.size  = keyFile.get_uint64 ("FileInfo", "Size");
+                }
+
+                if (keyFile.has_key ("FileInfo", "ModificationTime")) {
+                    fileStamp.mtime = keyFile.get_uint64 ("FileInfo", "ModificationTime");
+                }
+
+                if (keyFile.has_key ("FileInfo", "Inode")) {
+                    fileStamp.inode = keyFile.get_uint64 ("FileInfo", "Inode");
+                }
             }
 
             if (format == FT_Raw && keyFile.has_group ("ExtraRawInfo")) {
@@ -175,11 +187,11 @@ int CacheImageData::load (const Glib::ustring& fname)
         }
     } catch (Glib::Error &err) {
         if (options.rtSettings.verbose) {
-            printf("CacheImageData::load / Error code %d while reading values from \"%s\":\n%s\n", err.code(), fname.c_str(), err.what().c_str());
+            printf("CacheImageData::load / Error code %d while reading values of \"%s\":\n%s\n", err.code(), md5.c_str(), err.what().c_str());
         }
     } catch (...) {
         if (options.rtSettings.verbose) {
-            printf("CacheImageData::load / Unknown exception while trying to load \"%s\"!\n", fname.c_str());
+            printf("CacheImageData::load / Unknown exception while trying to load \"%s\"!\n", md5.c_str());
         }
     }
 
@@ -187,9 +199,10 @@ int CacheImageData::load (const Glib::ustring& fname)
 }
 
 /*
- * Save the General, DateTime, ExifInfo, File info and ExtraRawInfo sections of the image data file
+ * Save the General, DateTime, ExifInfo, File info and ExtraRawInfo sections of the image data,
+ * keeping the other sections already in data
  */
-int CacheImageData::save (const Glib::ustring& fname)
+int CacheImageData::save (std::string& data)
 {
 
     Glib::ustring keyData;
@@ -199,7 +212,9 @@ int CacheImageData::save (const Glib::ustring& fname)
     Glib::KeyFile keyFile;
 
     try {
-        keyFile.load_from_file (fname);
+        if (!data.empty ()) {
+            keyFile.load_from_data (data);
+        }
     } catch (Glib::Error&) {}
 
     keyFile.set_string  ("General", "MD5", md5);
@@ -242,6 +257,9 @@ int CacheImageData::save (const Glib::ustring& fname)
     keyFile.set_string  ("ExifInfo", "CameraMake", camMake);
     keyFile.set_string  ("ExifInfo", "CameraModel", camModel);
     keyFile.set_string  ("FileInfo", "Filetype", filetype);
+    keyFile.set_uint64  ("FileInfo", "Size", fileStamp.size);
+    keyFile.set_uint64  ("FileInfo", "ModificationTime", fileStamp.mtime);
+    keyFile.set_uint64  ("FileInfo", "Inode", fileStamp.inode);
 
     if (format == FT_Raw) {
         keyFile.set_integer ("ExtraRawInfo", "ThumbImageType", thumbImgType);
@@ -251,11 +269,11 @@ int CacheImageData::save (const Glib::ustring& fname)
 
     } catch (Glib::Error &err) {
         if (options.rtSettings.verbose) {
-            printf("CacheImageData::save / Error code %d while reading values from \"%s\":\n%s\n", err.code(), fname.c_str(), err.what().c_str());
+            printf("CacheImageData::save / Error code %d while writing values of \"%s\":\n%s\n", err.code(), md5.c_str(), err.what().c_str());
         }
     } catch (...) {
         if (options.rtSettings.verbose) {
-            printf("CacheImageData::save / Unknown exception while trying to save \"%s\"!\n", fname.c_str());
+            printf("CacheImageData::save / Unknown exception while trying to save \"%s\"!\n", md5.c_str());
         }
     }
 
@@ -263,18 +281,7 @@ int CacheImageData::save (const Glib::ustring& fname)
         return 1;
     }
 
-    FILE *f = g_fopen (fname.c_str (), "wt");
-
-    if (!f) {
-        if (options.rtSettings.verbose) {
-            printf("CacheImageData::save / Error: unable to open file \"%s\" with write access!\n", fname.c_str());
-        }
-
-        return 1;
-    } else {
-        fprintf (f, "%s", keyData.c_str ());
-        fclose (f);
-        return 0;
-    }
+    data = keyData;
+    return 0;
 }
 
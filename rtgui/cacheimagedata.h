@@ -22,6 +22,25 @@
 #include <glibmm.h>
 #include "options.h"
 
+// Size, modification time and inode of an image file, which change when the file is modified or replaced
+struct FileStamp {
+    guint64 size;
+    guint64 mtime;
+    guint64 inode;
+
+    FileStamp () : size(0), mtime(0), inode(0) {}
+
+    bool operator== (const FileStamp& other) const
+    {
+        return size == other.size && mtime == other.mtime && inode == other.inode;
+    }
+
+    bool operator!= (const FileStamp& other) const
+    {
+        return !(*this == other);
+    }
+};
+
 class CacheImageData
 {
 
@@ -57,6 +76,9 @@ public:
     Glib::ustring filetype;
     Glib::ustring expcomp;
 
+    // stamp of the image file when the cached data were built, they are rebuilt when it changes
+    FileStamp fileStamp;
+
     // store a copy of the autoWB's multipliers computed in Thumbnail::_generateThumbnailImage
     // they are not stored in the cache file by this class, but by rtengine::Thumbnail
     // -1 = Unknown
@@ -73,8 +95,9 @@ public:
 
     CacheImageData ();
 
-    int load (const Glib::ustring& fname);
-    int save (const Glib::ustring& fname);
+    // the image data are stored with the thumbnail's data in the same key file content, see CacheManager
+    int load (const std::string& data);
+    int save (std::string& data);
 
     Glib::ustring getCamera() const
     {
@@ -36,7 +36,10 @@ namespace
 {
 
 constexpr int cacheDirMode = 0777;
-constexpr const char* cacheDirs[] = { "profiles", "images", "aehistograms", "embprofiles", "data" };
+// the thumbnails' data are in the thumbnail database, the other directories are only kept to be cleared
+constexpr const char* cacheDirs[] = { "profiles" };
+constexpr const char* legacyImageDirs[] = { "images", "aehistograms", "embprofiles" };
+constexpr const char* legacyDataDir = "data";
 
 }
 
@@ -62,6 +65,8 @@ void CacheManager::init ()
     if (error != 0 && options.rtSettings.verbose) {
         std::cerr << "Failed to create all cache directories: " << g_strerror(errno) << std::endl;
     }
+
+    thumbnailDB.open (baseDir);
 }
 
 Thumbnail* CacheManager::getEntry (const Glib::ustring& fname)
@@ -86,20 +91,22 @@ Thumbnail* CacheManager::getEntry (const Glib::ustring& fname)
     }
 
     // build path name
-    const auto md5 = getMD5 (fname);
+    FileStamp stamp;
+    const auto md5 = getMD5 (fname, &stamp);
 
     if (md5.empty ()) {
         return nullptr;
     }
 
-    const auto cacheName = getCacheFileName ("data", fname, ".txt", md5);
-
     // let's see if we have it in the cache
-    {
+    std::string data;
+
+    if (thumbnailDB.read (md5, ThumbnailDB::DATA, data)) {
         CacheImageData imageData;
 
-        const auto error = imageData.load (cacheName);
-        if (error == 0 && imageData.supported) {
+        const auto error = imageData.load (data);
+        // a file modified since its data were cached gets a new thumbnail
+        if (error == 0 && imageData.supported && imageData.fileStamp == stamp) {
 
             thumbnail.reset (new Thumbnail (this, fname, &imageData));
             if (!thumbnail->isSupported ()) {
@@ -111,7 +118,7 @@ Thumbnail* CacheManager::getEntry (const Glib::ustring& fname)
     // if not, create a new one
     if (!thumbnail) {
 
-        thumbnail.reset (new Thumbnail (this, fname, md5));
+        thumbnail.reset (new Thumbnail (this, fname, md5, stamp));
         if (!thumbnail->isSupported ()) {
             thumbnail.reset ();
         }
@@ -180,14 +187,8 @@ void CacheManager::renameEntry (const std::string& oldfilename, const std::strin
 
     const auto newmd5 = getMD5 (newfilename);
 
-    auto error = g_rename (getCacheFileName ("profiles", oldfilename, paramFileExtension, oldmd5).c_str (), getCacheFileName ("profiles", newfilename, paramFileExtension, newmd5).c_str ());
-    error |= g_rename (getCacheFileName ("images", oldfilename, ".rtti", oldmd5).c_str (), getCacheFileName ("images", newfilename, ".rtti", newmd5).c_str ());
-    error |= g_rename (getCacheFileName ("images", oldfilename, ".cust16", oldmd5).c_str (), getCacheFileName ("images", newfilename, ".cust16", newmd5).c_str ());
-    error |= g_rename (getCacheFileName ("images", oldfilename, ".cust", oldmd5).c_str (), getCacheFileName ("images", newfilename, ".cust", newmd5).c_str ());
-    error |= g_rename (getCacheFileName ("images", oldfilename, ".jpg", oldmd5).c_str (), getCacheFileName ("images", newfilename, ".jpg", newmd5).c_str ());
-    error |= g_rename (getCacheFileName ("aehistograms", oldfilename, "", oldmd5).c_str (), getCacheFileName ("aehistograms", newfilename, "", newmd5).c_str ());
-    error |= g_rename (getCacheFileName ("embprofiles", oldfilename, ".icc", oldmd5).c_str (), getCacheFileName ("embprofiles", newfilename, ".icc", newmd5).c_str ());
-    error |= g_rename (getCacheFileName ("data", oldfilename, ".txt", oldmd5).c_str (), getCacheFileName ("data", newfilename, ".txt", newmd5).c_str ());
+    const auto error = g_rename (getCacheFileName ("profiles", oldfilename, paramFileExtension, oldmd5).c_str (), getCacheFileName ("profiles", newfilename, paramFileExtension, newmd5).c_str ());
+    thumbnailDB.rename (oldmd5, newmd5, newfilename);
 
     if (error != 0 && options.rtSettings.verbose) {
         std::cerr << "Failed to rename all files for cache entry '" << oldfilename << "': " << g_strerror(errno) << std::endl;
@@ -222,6 +223,33 @@ void CacheManager::closeCache () const
     MyMutex::MyLock lock (mutex);
 
     applyCacheSizeLimitation ();
+    thumbnailDB.compact (false);
+    thumbnailDB.close ();
+}
+
+bool CacheManager::readCacheData (const std::string& md5, ThumbnailDB::Blob blob, std::string& data) const
+{
+    return !md5.empty () && thumbnailDB.read (md5, blob, data);
+}
+
+bool CacheManager::readCacheData (const std::string& md5, ThumbnailDB::Blob blob, const std::function<bool (const char*, std::size_t)>& reader) const
+{
+    return !md5.empty () && thumbnailDB.read (md5, blob, reader);
+}
+
+bool CacheManager::writeCacheData (const std::string& md5, const Glib::ustring& fname, ThumbnailDB::Blob blob, const std::string& data) const
+{
+    return !md5.empty () && thumbnailDB.write (md5, fname, blob, data);
+}
+
+void CacheManager::prefetchDirectory (const Glib::ustring& dirName) const
+{
+    thumbnailDB.prefetch (dirName);
+}
+
+void CacheManager::compactCache () const
+{
+    thumbnailDB.compact (false);
 }
 
 void CacheManager::clearAll () const
@@ -231,15 +259,25 @@ void CacheManager::clearAll () const
     for (const auto& cacheDir : cacheDirs) {
         deleteDir (cacheDir);
     }
+
+    thumbnailDB.clear (true);
+
+    for (const auto& cacheDir : legacyImageDirs) {
+        deleteDir (cacheDir);
+    }
+
+    deleteDir (legacyDataDir);
 }
 
 void CacheManager::clearImages () const
 {
     MyMutex::MyLock lock (mutex);
 
-    deleteDir ("images");
-    deleteDir ("aehistograms");
-    deleteDir ("embprofiles");
+    thumbnailDB.clear (false);
+
+    for (const auto& cacheDir : legacyImageDirs) {
+        deleteDir (cacheDir);
+    }
 }
 
 void CacheManager::clearProfiles () const
@@ -273,32 +311,20 @@ void CacheManager::deleteFiles (const Glib::ustring& fname, const std::string& m
         return;
     }
 
-    auto error = g_remove (getCacheFileName ("images", fname, ".rtti", md5).c_str ());
-    error |= g_remove (getCacheFileName ("images", fname, ".cust16", md5).c_str ());
-    error |= g_remove (getCacheFileName ("images", fname, ".cust", md5).c_str ());
-    error |= g_remove (getCacheFileName ("images", fname, ".jpg", md5).c_str ());
-    error |= g_remove (getCacheFileName ("aehistograms", fname, "", md5).c_str ());
-    error |= g_remove (getCacheFileName ("embprofiles", fname, ".icc", md5).c_str ());
-
-    if (purgeData) {
-        error |= g_remove (getCacheFileName ("data", fname, ".txt", md5).c_str ());
-    }
+    thumbnailDB.remove (md5, purgeData);
 
-    if (purgeProfile) {
-        error |= g_remove (getCacheFileName ("profiles", fname, paramFileExtension, md5).c_str ());
-    }
-
-    if (error != 0 && options.rtSettings.verbose) {
+    if (purgeProfile && g_remove (getCacheFileName ("profiles", fname, paramFileExtension, md5).c_str ()) != 0 && options.rtSettings.verbose) {
         std::cerr << "Failed to delete all files for cache entry '" << fname << "': " << g_strerror(errno) << std::endl;
     }
 }
 
-std::string CacheManager::getMD5 (const Glib::ustring& fname)
+std::string CacheManager::getMD5 (const Glib::ustring& fname, FileStamp* stamp)
 {
 
     auto file = Gio::File::create_for_path (fname);
 
-    if (file && file->query_exists ())   {
+    // querying the attributes of a missing file fails, so its existence is not checked beforehand
+    if (file)   {
 
 #ifdef WIN32
 
@@ -306,6 +332,12 @@ std::string CacheManager::getMD5 (const Glib::ustring& fname)
 
         WIN32_FILE_ATTRIBUTE_DATA fileAttr;
         if (GetFileAttributesExW (wfname.get (), GetFileExInfoStandard, &fileAttr)) {
+            if (stamp) {
+                stamp->size = (guint64 (fileAttr.nFileSizeHigh) << 32) | fileAttr.nFileSizeLow;
+                stamp->mtime = (guint64 (fileAttr.ftLastWriteTime.dwHighDateTime) << 32) | fileAttr.ftLastWriteTime.dwLowDateTime;
+                stamp->inode = 0;
+            }
+
             // We use name, size and creation time to identify a file.
             const auto identifier = Glib::ustring::compose ("%1-%2-%3-%4", fileAttr.nFileSizeLow, fileAttr.ftCreationTime.dwHighDateTime, fileAttr.ftCreationTime.dwLowDateTime, fname);
             return Glib::Checksum::compute_checksum (Glib::Checksum::CHECKSUM_MD5, identifier);
@@ -316,7 +348,13 @@ std::string CacheManager::getMD5 (const Glib::ustring& fname)
         try
         {
 
-            if (auto info = file->query_info ()) {
+            if (auto info = file->query_info ("standard::size,time::modified,unix::inode")) {
+                if (stamp) {
+                    stamp->size = info->get_size ();
+                    stamp->mtime = info->get_attribute_uint64 ("time::modified");
+                    stamp->inode = info->get_attribute_uint64 ("unix::inode");
+                }
+
                 // We only use name and size to identify a file.
                 const auto identifier = Glib::ustring::compose ("%1%2", fname, info->get_size ());
                 return Glib::Checksum::compute_checksum (Glib::Checksum::CHECKSUM_MD5, identifier);
@@ -343,48 +381,5 @@ Glib::ustring CacheManager::getCacheFileName (const Glib::ustring& subDir,
 
 void CacheManager::applyCacheSizeLimitation () const
 {
-    using FNameMTime = std::pair<Glib::ustring, Glib::TimeVal>;
-    std::vector<FNameMTime> files;
-
-    try {
-
-        const auto dirName = Glib::build_filename (baseDir, "data");
-        const auto dir = Gio::File::create_for_path (dirName);
-
-        auto enumerator = dir->enumerate_children ("standard::name,time::modified");
-
-        while (auto file = enumerator->next_file ()) {
-            files.emplace_back (file->get_name (), file->modification_time ());
-        }
-
-    } catch (Glib::Exception&) {}
-
-    if (files.size () <= options.maxCacheEntries) {
-        return;
-    }
-
-    std::sort (files.begin (), files.end (), [] (const FNameMTime& lhs, const FNameMTime& rhs)
-    {
-        return lhs.second < rhs.second;
-    });
-
-    auto cacheEntries = files.size ();
-
-    for (auto entry = files.begin (); cacheEntries-- > options.maxCacheEntries; ++entry) {
-
-        const auto& name = entry->first;
-
-        constexpr auto md5_size = 32;
-        const auto name_size = name.size();
-
-        if (name_size < md5_size + 5) {
-            continue;
-        }
-
-        const auto fname = name.substr (0, name_size - md5_size - 5);
-        const auto md5 = name.substr (name_size - md5_size - 4, md5_size);
-
-        deleteFiles (fname, md5, true, false);
-    }
+    thumbnailDB.limitSize (options.maxCacheEntries);
 }
-
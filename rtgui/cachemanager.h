@@ -26,7 +26,9 @@
 
 #include "../rtengine/noncopyable.h"
 
+#include "cacheimagedata.h"
 #include "threadutils.h"
+#include "thumbnaildb.h"
 
 class Thumbnail;
 
@@ -38,6 +40,7 @@ private:
     Entries openEntries;
     Glib::ustring    baseDir;
     mutable MyMutex  mutex;
+    mutable ThumbnailDB thumbnailDB;
 
     void deleteDir   (const Glib::ustring& dirName) const;
     void deleteFiles (const Glib::ustring& fname, const std::string& md5, bool purgeData, bool purgeProfile) const;
@@ -56,12 +59,20 @@ public:
     void closeThumbnail (Thumbnail* thumbnail);
     void closeCache () const;
 
+    // the thumbnails' cached data, see ThumbnailDB
+    bool readCacheData  (const std::string& md5, ThumbnailDB::Blob blob, std::string& data) const;
+    bool readCacheData  (const std::string& md5, ThumbnailDB::Blob blob, const std::function<bool (const char*, std::size_t)>& reader) const;
+    bool writeCacheData (const std::string& md5, const Glib::ustring& fname, ThumbnailDB::Blob blob, const std::string& data) const;
+    void prefetchDirectory (const Glib::ustring& dirName) const;
+    void compactCache () const;
+
     void clearAll () const;
     void clearImages () const;
     void clearProfiles () const;
     void clearFromCache (const Glib::ustring& fname, bool purge) const;
 
-    static std::string getMD5 (const Glib::ustring& fname);
+    // also gives the stamp of the file if stamp isn't null
+    static std::string getMD5 (const Glib::ustring& fname, FileStamp* stamp = nullptr);
 
     Glib::ustring    getCacheFileName (const Glib::ustring& subDir,
                                        const Glib::ustring& fname,
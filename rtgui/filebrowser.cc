@@ -19,6 +19,7 @@
  *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include "filebrowser.h"
+#include <algorithm>
 #include <map>
 #include <glibmm.h>
 #include "options.h"
@@ -537,6 +538,7 @@ void FileBrowser::doubleClicked (ThumbBrowserEntryBase* entry)
     if (tbl && entry) {
         std::vector<Thumbnail*> entries;
         entries.push_back ((static_cast<FileBrowserEntry*>(entry))->thumbnail);
+        (static_cast<FileBrowserEntry*>(entry))->upgradeThumbnailImage ();
         tbl->openRequested (entries);
     }
 }
@@ -597,15 +599,13 @@ void FileBrowser::addEntry_ (FileBrowserEntry* entry)
     entry->getThumbButtonSet()->setButtonListener (this);
     entry->resize (getThumbnailHeight());
 
-    // find place in abc order
+    // find place in abc order, by a binary search as the entries are kept sorted
     {
         MYWRITERLOCK(l, entryRW);
 
-        std::vector<ThumbBrowserEntryBase*>::iterator i = fd.begin();
-
-        while (i != fd.end() && *entry < * ((FileBrowserEntry*)*i)) {
-            ++i;
-        }
+        const auto i = std::lower_bound (fd.begin(), fd.end(), entry, [] (ThumbBrowserEntryBase* current, FileBrowserEntry* added) {
+            return *added < *current;
+        });
 
         fd.insert (i, entry);
 
@@ -1754,7 +1754,8 @@ void FileBrowser::openNextImage ()
                             double h2 = selected[0]->getStartX();
                             double v2 = selected[0]->getStartY();
 
-                            Thumbnail* thumb = (static_cast<FileBrowserEntry*>(fd[k]))->thumbnail;
+                            FileBrowserEntry* openedEntry = static_cast<FileBrowserEntry*>(fd[k]);
+                            Thumbnail* thumb = openedEntry->thumbnail;
                             int minWidth = get_width() - fd[k]->getMinimalWidth();
 
                             MYWRITERLOCK_RELEASE(l);
@@ -1771,6 +1772,7 @@ void FileBrowser::openNextImage ()
                             // open the selected image
                             std::vector<Thumbnail*> entries;
                             entries.push_back (thumb);
+                            openedEntry->upgradeThumbnailImage ();
                             tbl->openRequested (entries);
                             return;
                         }
@@ -1819,7 +1821,8 @@ void FileBrowser::openPrevImage ()
                             double h2 = selected[0]->getStartX();
                             double v2 = selected[0]->getStartY();
 
-                            Thumbnail* thumb = (static_cast<FileBrowserEntry*>(fd[k]))->thumbnail;
+                            FileBrowserEntry* openedEntry = static_cast<FileBrowserEntry*>(fd[k]);
+                            Thumbnail* thumb = openedEntry->thumbnail;
                             int minWidth = get_width() - fd[k]->getMinimalWidth();
 
                             MYWRITERLOCK_RELEASE(l);
@@ -1836,6 +1839,7 @@ void FileBrowser::openPrevImage ()
                             // open the selected image
                             std::vector<Thumbnail*> entries;
                             entries.push_back (thumb);
+                            openedEntry->upgradeThumbnailImage ();
                             tbl->openRequested (entries);
                             return;
                         }
@@ -1926,6 +1930,14 @@ void FileBrowser::selectionChanged ()
 {
 
     notifySelectionListener ();
+
+    // browsing only decodes the embedded previews, the raw data are only processed for an image selected alone,
+    // so that selecting a whole directory doesn't decode all of it
+    MYREADERLOCK(l, entryRW);
+
+    if (selected.size() == 1) {
+        (static_cast<FileBrowserEntry*>(selected[0]))->upgradeThumbnailImage ();
+    }
 }
 
 void FileBrowser::notifySelectionListener ()
@@ -2071,6 +2083,7 @@ void FileBrowser::openRequested( std::vector<FileBrowserEntry*> mselected)
 
     for (size_t i = openStart; i < mselected.size(); i++) {
         entries.push_back (mselected[i]->thumbnail);
+        mselected[i]->upgradeThumbnailImage ();
     }
 
     tbl->openRequested (entries);
@@ -106,6 +106,17 @@ void FileBrowserEntry::refreshQuickThumbnailImage ()
     thumbImageUpdater->add(this, &updatepriority, upgrade_to_processed, this);
 }
 
+// Replaces a quick thumbnail by one processed from the raw data, in the background, if the user asked for it
+void FileBrowserEntry::upgradeThumbnailImage ()
+{
+
+    if (!options.processedThumbOnSelection || !thumbnail || !thumbnail->isQuick()) {
+        return;
+    }
+
+    thumbImageUpdater->add(this, &updatepriority, true, this);
+}
+
 void FileBrowserEntry::calcThumbnailSize ()
 {
 
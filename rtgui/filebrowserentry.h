@@ -81,6 +81,7 @@ public:
 
     void refreshThumbnailImage ();
     void refreshQuickThumbnailImage ();
+    void upgradeThumbnailImage ();
     void calcThumbnailSize ();
 
     virtual std::vector<Glib::RefPtr<Gdk::Pixbuf> > getIconsOnImageArea ();
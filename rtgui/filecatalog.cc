@@ -50,6 +50,7 @@ FileCatalog::FileCatalog (CoarsePanel* cp, ToolBar* tb, FilePanel* filepanel) :
     filterPanel(nullptr),
     previewsToLoad(0),
     previewsLoaded(0),
+    thumbUpdatesShown(false),
     coarsePanel(cp),
     toolBar(tb)
 {
@@ -528,6 +529,7 @@ void FileCatalog::closeDir ()
     previewLoader->removeAllJobs ();
 
     // terminate thumbnail updater
+    thumbUpdatesConn.disconnect ();
     thumbImageUpdater->removeAllJobs ();
 
     // remove entries
@@ -535,6 +537,12 @@ void FileCatalog::closeDir ()
     fileBrowser->close ();
     fileNameList.clear ();
 
+    {
+        MyMutex::MyLock lock(pendingPreviewsMutex);
+        pendingPreviews.clear ();
+        changedPreviews.clear ();
+    }
+
     {
         MyMutex::MyLock lock(dirEFSMutex);
         dirEFS.clear ();
@@ -543,9 +551,9 @@ void FileCatalog::closeDir ()
     redrawAll ();
 }
 
-std::vector<Glib::ustring> FileCatalog::getFileList ()
+std::set<Glib::ustring> FileCatalog::getFileList ()
 {
-    std::vector<Glib::ustring> names;
+    std::set<Glib::ustring> names;
 
     std::set<Glib::ustring> extensions;
     for (const auto& parsedExt : options.parsedExtensions) {
@@ -556,10 +564,15 @@ std::vector<Glib::ustring> FileCatalog::getFileList ()
 
         auto dir = Gio::File::create_for_path (selectedDirectory);
 
-        auto enumerator = dir->enumerate_children ("standard::name");
+        // the type and the hidden flag come with the listing, so that the files don't have to be queried one by one afterwards
+        auto enumerator = dir->enumerate_children ("standard::name,standard::type,standard::is-hidden");
 
         while (auto file = enumerator->next_file ()) {
 
+            if (file->get_file_type () == Gio::FILE_TYPE_DIRECTORY || (!options.fbShowHidden && file->is_hidden ())) {
+                continue;
+            }
+
             const Glib::ustring fname = file->get_name ();
 
             auto lastdot = fname.find_last_of ('.');
@@ -572,7 +585,7 @@ std::vector<Glib::ustring> FileCatalog::getFileList ()
                 continue;
             }
 
-            names.emplace_back (Glib::build_filename (selectedDirectory, fname));
+            names.emplace (Glib::build_filename (selectedDirectory, fname));
         }
 
     } catch (Glib::Exception& exception) {
@@ -610,12 +623,11 @@ void FileCatalog::dirSelected (const Glib::ustring& dirname, const Glib::ustring
         BrowsePath->set_text (selectedDirectory);
         buttonBrowsePath->set_image (*iRefreshWhite);
         fileNameList = getFileList ();
+        cacheMgr->prefetchDirectory (selectedDirectory);
 
-        for (unsigned int i = 0; i < fileNameList.size(); i++) {
-            Glib::RefPtr<Gio::File> f = Gio::File::create_for_path(fileNameList[i]);
-
-            if (f->get_parse_name() != openfile) { // if we opened a file at the beginning don't add it again
-                checkAndAddFile (f);
+        for (const auto& fileName : fileNameList) {
+            if (fileName != openfile) { // if we opened a file at the beginning don't add it again
+                addFile (fileName);
             }
         }
 
@@ -633,6 +645,9 @@ void FileCatalog::dirSelected (const Glib::ustring& dirname, const Glib::ustring
         dirMonitor = dir->monitor_directory ();
         dirMonitor->signal_changed().connect (sigc::bind(sigc::mem_fun(*this, &FileCatalog::on_dir_changed), false));
 #endif
+
+        thumbUpdatesShown = false;
+        thumbUpdatesConn = Glib::signal_timeout().connect (sigc::mem_fun(*this, &FileCatalog::showThumbUpdates), 500);
     } catch (Glib::Exception& ex) {
         std::cout << ex.what();
     }
@@ -662,6 +677,28 @@ void FileCatalog::enableTabMode(bool enable)
     redrawAll();
 }
 
+// Called by a timeout within GTK UI thread, shows the queue of the thumbnail image updates once the previews are loaded
+bool FileCatalog::showThumbUpdates ()
+{
+    if (inTabMode || previewsToLoad) {
+        return true;
+    }
+
+    const ThumbImageUpdater::Statistics statistics = thumbImageUpdater->getStatistics ();
+    const std::size_t pending = statistics.queued + statistics.active;
+
+    if (pending) {
+        filepanel->loadingThumbs (Glib::ustring::compose (M("PROGRESSBAR_PROCESSINGTHUMBS"), pending, Glib::ustring::format (std::fixed, std::setprecision(0), statistics.meanLatency)),
+                                  double (statistics.processed) / (statistics.processed + pending));
+        thumbUpdatesShown = true;
+    } else if (thumbUpdatesShown) {
+        filepanel->loadingThumbs (M("PROGRESSBAR_READY"), 0);
+        thumbUpdatesShown = false;
+    }
+
+    return true;
+}
+
 void FileCatalog::_refreshProgressBar ()
 {
     // In tab mode, no progress bar at all
@@ -714,6 +751,14 @@ void FileCatalog::filterApplied()
 }
 
 
+#ifndef WIN32
+int reloadChangedPreviews (void* data)
+{
+    (static_cast<FileCatalog*>(data))->reloadChangedPreviewsUI ();
+    return 0;
+}
+#endif
+
 void FileCatalog::previewReady (int dir_id, FileBrowserEntry* fdn)
 {
 
@@ -721,6 +766,14 @@ void FileCatalog::previewReady (int dir_id, FileBrowserEntry* fdn)
         return;
     }
 
+    bool changed;
+
+    {
+        MyMutex::MyLock lock(pendingPreviewsMutex);
+        pendingPreviews.erase (fdn->filename);
+        changed = changedPreviews.count (fdn->filename);
+    }
+
     // put it into the "full directory" browser
     fdn->setImageAreaToolListener (iatlistener);
     fileBrowser->addEntry (fdn);
@@ -774,6 +827,16 @@ void FileCatalog::previewReady (int dir_id, FileBrowserEntry* fdn)
     previewsLoaded++;
 
     _refreshProgressBar();
+
+#ifndef WIN32
+
+    if (changed) {
+        // the file has been written to while its preview was loading, the entry is replaced once added by the idle
+        // callback queued by addEntry above
+        g_idle_add (reloadChangedPreviews, this);
+    }
+
+#endif
 }
 
 int prevfinished (void* data)
@@ -838,7 +901,25 @@ void FileCatalog::previewsFinished (int dir_id)
         currentEFS = dirEFS;
     }
 
+    bool changed;
+
+    {
+        // the files whose preview failed are not pending anymore either
+        MyMutex::MyLock lock(pendingPreviewsMutex);
+        pendingPreviews.clear ();
+        changed = !changedPreviews.empty ();
+    }
+
     g_idle_add (prevfinished, this);
+
+#ifndef WIN32
+
+    if (changed) {
+        // after prevfinished, which resets previewsToLoad
+        g_idle_add (reloadChangedPreviews, this);
+    }
+
+#endif
 }
 
 void FileCatalog::setEnabled (bool e)
@@ -1703,14 +1784,14 @@ void FileCatalog::reparseDirectory ()
         return;
     }
 
-    std::vector<Glib::ustring> nfileNameList = getFileList ();
+    std::set<Glib::ustring> nfileNameList = getFileList ();
 
     // check if a thumbnailed file has been deleted
     const std::vector<ThumbBrowserEntryBase*>& t = fileBrowser->getEntries ();
     std::vector<Glib::ustring> fileNamesToDel;
 
     for (size_t i = 0; i < t.size(); i++)
-        if (!Glib::file_test (t[i]->filename, Glib::FILE_TEST_EXISTS)) {
+        if (nfileNameList.count (t[i]->filename) == 0 && !Glib::file_test (t[i]->filename, Glib::FILE_TEST_EXISTS)) {
             fileNamesToDel.push_back (t[i]->filename);
         }
 
@@ -1725,22 +1806,14 @@ void FileCatalog::reparseDirectory ()
     }
 
     // check if a new file has been added
-    for (size_t i = 0; i < nfileNameList.size(); i++) {
-        bool found = false;
-
-        for (size_t j = 0; j < fileNameList.size(); j++)
-            if (nfileNameList[i] == fileNameList[j]) {
-                found = true;
-                break;
-            }
-
-        if (!found) {
-            checkAndAddFile (Gio::File::create_for_parse_name (nfileNameList[i]));
+    for (const auto& fileName : nfileNameList) {
+        if (fileNameList.count (fileName) == 0) {
+            addFile (fileName);
             _refreshProgressBar ();
         }
     }
 
-    fileNameList = nfileNameList;
+    fileNameList = std::move (nfileNameList);
 }
 
 #ifdef WIN32
@@ -1761,38 +1834,136 @@ void FileCatalog::on_dir_changed (const Glib::RefPtr<Gio::File>& file, const Gli
 {
 
     if (options.has_retained_extention(file->get_parse_name())
-            && (event_type == Gio::FILE_MONITOR_EVENT_CREATED || event_type == Gio::FILE_MONITOR_EVENT_DELETED || event_type == Gio::FILE_MONITOR_EVENT_CHANGED)) {
+            && (event_type == Gio::FILE_MONITOR_EVENT_CREATED || event_type == Gio::FILE_MONITOR_EVENT_DELETED || event_type == Gio::FILE_MONITOR_EVENT_CHANGES_DONE_HINT)) {
         if (!internal) {
             GThreadLock lock;
-            reparseDirectory ();
+            fileChanged (file, event_type);
         } else {
-            reparseDirectory ();
+            fileChanged (file, event_type);
+        }
+    }
+}
+
+/*
+ * The monitor tells which file has changed, so only this one is updated instead of listing the whole directory again
+ */
+void FileCatalog::fileChanged (const Glib::RefPtr<Gio::File>& file, Gio::FileMonitorEvent event_type)
+{
+    const Glib::ustring fileName = file->get_parse_name ();
+
+    if (selectedDirectory.empty() || Glib::path_get_dirname (fileName) != selectedDirectory) {
+        return;
+    }
+
+    if (event_type == Gio::FILE_MONITOR_EVENT_DELETED) {
+        if (fileNameList.erase (fileName) > 0) {
+            if (FileBrowserEntry* entry = fileBrowser->delEntry (fileName)) {
+                delete entry;
+                previewsLoaded--;
+            }
+
+            cacheMgr->deleteEntry (fileName);
+            _refreshProgressBar ();
+        }
+    } else if (fileNameList.count (fileName) == 0) {
+        // a new file
+        if (checkAndAddFile (file)) {
+            fileNameList.insert (fileName);
+            _refreshProgressBar ();
+        }
+    } else if (event_type == Gio::FILE_MONITOR_EVENT_CHANGES_DONE_HINT) {
+        {
+            // a file copied in is announced as created, then written: its preview may have read a part of it only,
+            // so it is loaded again once back, see previewReady and previewsFinished
+            MyMutex::MyLock lock(pendingPreviewsMutex);
+
+            if (pendingPreviews.count (fileName)) {
+                changedPreviews.insert (fileName);
+                return;
+            }
+        }
+
+        reloadFile (fileName);
+    }
+}
+
+/*
+ * A file has been written to, its thumbnail is built again if its stamp has changed, see CacheManager::getEntry
+ */
+void FileCatalog::reloadFile (const Glib::ustring& fileName)
+{
+    if (FileBrowserEntry* entry = fileBrowser->delEntry (fileName)) {
+        delete entry;
+        previewsLoaded--;
+        previewsToLoad--;
+    }
+
+    // the thumbnail still opened for the former content must not be reused
+    cacheMgr->deleteEntry (fileName);
+
+    addFile (fileName);
+    _refreshProgressBar ();
+}
+
+// Called within GTK UI thread, for the files written to while their preview was loading
+void FileCatalog::reloadChangedPreviewsUI ()
+{
+    GThreadLock lock;
+    std::set<Glib::ustring> files;
+
+    {
+        MyMutex::MyLock lock(pendingPreviewsMutex);
+
+        for (auto it = changedPreviews.begin (); it != changedPreviews.end ();) {
+            if (pendingPreviews.count (*it)) {
+                ++it;
+            } else {
+                files.insert (*it);
+                it = changedPreviews.erase (it);
+            }
+        }
+    }
+
+    for (const auto& fileName : files) {
+        // the directory may have been left, or the file deleted, since
+        if (fileNameList.count (fileName)) {
+            reloadFile (fileName);
         }
     }
 }
 
 #endif
 
-void FileCatalog::checkAndAddFile (Glib::RefPtr<Gio::File> file)
+void FileCatalog::addFile (const Glib::ustring& fname)
 {
-    if (!file) {
-        return;
+    if (options.is_extention_enabled (getExtension (fname))) {
+        {
+            MyMutex::MyLock lock(pendingPreviewsMutex);
+            pendingPreviews.insert (fname);
+        }
+
+        previewLoader->add (selectedDirectoryId, fname, this);
+        previewsToLoad++;
     }
+}
 
-    if (!file->query_exists()) {
-        return;
+bool FileCatalog::checkAndAddFile (Glib::RefPtr<Gio::File> file)
+{
+    if (!file) {
+        return false;
     }
 
     try {
 
-        auto info = file->query_info ();
+        // querying a missing file fails, so its existence is not checked beforehand
+        auto info = file->query_info ("standard::name,standard::type,standard::is-hidden");
 
         if (!info || info->get_file_type () == Gio::FILE_TYPE_DIRECTORY) {
-            return;
+            return false;
         }
 
         if (!options.fbShowHidden && info->is_hidden ()) {
-            return;
+            return false;
         }
 
         Glib::ustring ext;
@@ -1803,13 +1974,21 @@ void FileCatalog::checkAndAddFile (Glib::RefPtr<Gio::File> file)
         }
 
         if (!options.is_extention_enabled (ext)) {
-            return;
+            return false;
+        }
+
+        {
+            MyMutex::MyLock lock(pendingPreviewsMutex);
+            pendingPreviews.insert (file->get_parse_name ());
         }
 
         previewLoader->add (selectedDirectoryId, file->get_parse_name (), this);
         previewsToLoad++;
+        return true;
 
     } catch(Gio::Error&) {}
+
+    return false;
 }
 
 void FileCatalog::addAndOpenFile (const Glib::ustring& fname)
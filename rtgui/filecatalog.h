@@ -151,8 +151,13 @@ private:
     int previewsLoaded;
 
 
-    std::vector<Glib::ustring> fileNameList;
+    std::set<Glib::ustring> fileNameList;
     std::set<Glib::ustring> editedFiles;
+    MyMutex pendingPreviewsMutex;
+    std::set<Glib::ustring> pendingPreviews; // files given to the preview loader and not back yet
+    std::set<Glib::ustring> changedPreviews; // pending files written to since, their preview has to be loaded again
+    sigc::connection thumbUpdatesConn;
+    bool thumbUpdatesShown; // the progress bar shows the thumbnail image updates
     guint modifierKey; // any modifiers held when rank button was pressed
 
 #ifndef _WIN32
@@ -162,8 +167,10 @@ private:
 #endif
 
     void addAndOpenFile (const Glib::ustring& fname);
-    void checkAndAddFile (Glib::RefPtr<Gio::File> info);
-    std::vector<Glib::ustring> getFileList ();
+    bool checkAndAddFile (Glib::RefPtr<Gio::File> info);
+    void addFile (const Glib::ustring& fname);
+    bool showThumbUpdates ();
+    std::set<Glib::ustring> getFileList ();
     BrowserFilter getFilter ();
     void trashChanged ();
 
@@ -304,6 +311,9 @@ public:
 
 #ifndef _WIN32
     void on_dir_changed (const Glib::RefPtr<Gio::File>& file, const Glib::RefPtr<Gio::File>& other_file, Gio::FileMonitorEvent event_type, bool internal);
+    void fileChanged (const Glib::RefPtr<Gio::File>& file, Gio::FileMonitorEvent event_type);
+    void reloadFile (const Glib::ustring& fileName);
+    void reloadChangedPreviewsUI ();
 #else
     void winDirChanged ();
 #endif
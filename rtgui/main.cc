@@ -32,17 +32,27 @@
 #include <cstring>
 #include <cstdlib>
 #include <locale.h>
+#include <sstream>
+#include <algorithm>
 #include "options.h"
 #include "soundman.h"
 #include "rtimage.h"
 #include "version.h"
 #include "extprog.h"
+#include "../rtengine/imagesource.h"
+#include "../rtengine/boundedqueue.h"
+#include "../rtengine/cpufeatures.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #ifndef WIN32
 #include <glibmm/fileutils.h>
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <glibmm/threads.h>
+#include <unistd.h>
 #else
 #include <glibmm/thread.h>
 #include "conio.h"
@@ -243,6 +253,8 @@ int main(int argc, char **argv)
         int ret = processLineParams( argc, argv);
 
         if( ret <= 0 ) {
+            rtengine::cleanup();
+
             if(consoleOpened) {
                 printf("Press any key to exit RawTherapee\n");
                 FlushConsoleInputBuffer(GetStdHandle(STD_INPUT_HANDLE));
@@ -266,6 +278,7 @@ int main(int argc, char **argv)
             int ret = processLineParams( argc, argv);
 
             if( ret <= 0 ) {
+                rtengine::cleanup();
                 return ret;
             }
         }
@@ -407,6 +420,408 @@ void deleteProcParams(std::vector<rtengine::procparams::PartialProfile*> &pparam
     return;
 }
 
+namespace
+{
+
+// Rough peak footprint of rtengine::processImage per image pixel: raw data, demosaiced planes,
+// the working Imagefloat, the LabImage and the 16 bit output image can all be alive at the same time
+constexpr std::size_t batchBytesPerPixel = 48;
+
+/* Settings shared by all the images of a command line batch */
+struct BatchSettings {
+    Glib::ustring outputPath;
+    bool outputDirectory;
+    bool overwriteFiles;
+    bool sideProcParams;
+    bool copyParamsFile;
+    bool skipIfNoSidecar;
+    bool useDefault;
+    unsigned int sideCarFilePos;
+    int compression;
+    int subsampling;
+    int bits;
+    std::string outputType;
+    rtengine::procparams::PartialProfile* rawParams;
+    rtengine::procparams::PartialProfile* imgParams;
+    std::vector<rtengine::procparams::PartialProfile*> processingParams;
+};
+
+/* An image travelling through the decode -> develop -> encode stages of the command line batch */
+struct BatchImage {
+    Glib::ustring inputFile;
+    Glib::ustring outputFile;
+    rtengine::procparams::ProcParams params;
+    rtengine::ProcessingJob* job;
+    rtengine::IImage16* result;
+    std::size_t footprint;
+};
+
+using BatchImageQueue = rtengine::BoundedQueue<BatchImage*>;
+
+/* Job scheduler of the command line batch.
+ * It keeps the estimated memory footprint of the images in flight (from their decoding up to the end of
+ * their encoding) below the given budget. The first image in flight is always admitted, so an image bigger
+ * than the whole budget is still processed, just alone. */
+class BatchScheduler :
+    public rtengine::NonCopyable
+{
+public:
+    explicit BatchScheduler (std::size_t memoryBudget) :
+        budget(memoryBudget),
+        inUse(0),
+        inFlight(0),
+        largest(0),
+        errors(0)
+    {
+    }
+
+    // Blocks until 'bytes' fit in the memory budget
+    void acquire (std::size_t bytes)
+    {
+        Glib::Threads::Mutex::Lock lock(mutex);
+
+        while (inFlight > 0 && budget > 0 && inUse + bytes > budget) {
+            cond.wait(mutex);
+        }
+
+        inUse += bytes;
+        ++inFlight;
+    }
+
+    // Changes the amount held by an image in flight once its real footprint is known, blocking while the increase doesn't fit
+    void adjust (std::size_t from, std::size_t to)
+    {
+        Glib::Threads::Mutex::Lock lock(mutex);
+
+        while (inFlight > 1 && budget > 0 && to > from && inUse - from + to > budget) {
+            cond.wait(mutex);
+        }
+
+        inUse = inUse - from + to;
+        largest = std::max(largest, to);
+        cond.broadcast();
+    }
+
+    // Footprint expected for an image not decoded yet: the largest one seen so far
+    std::size_t getExpectedFootprint ()
+    {
+        Glib::Threads::Mutex::Lock lock(mutex);
+        return largest;
+    }
+
+    void release (std::size_t bytes)
+    {
+        Glib::Threads::Mutex::Lock lock(mutex);
+        inUse -= bytes;
+        --inFlight;
+        cond.broadcast();
+    }
+
+    void addError ()
+    {
+        Glib::Threads::Mutex::Lock lock(mutex);
+        ++errors;
+    }
+
+    unsigned getErrors ()
+    {
+        Glib::Threads::Mutex::Lock lock(mutex);
+        return errors;
+    }
+
+    // Prints the messages of a stage in one block, so that the output of concurrent stages doesn't interleave
+    void print (const std::string& out, const std::string& err)
+    {
+        Glib::Threads::Mutex::Lock lock(outputMutex);
+        std::cout << out << std::flush;
+        std::cerr << err << std::flush;
+    }
+
+private:
+    const std::size_t budget;
+    std::size_t inUse;
+    unsigned int inFlight;
+    std::size_t largest;
+    unsigned errors;
+
+    Glib::Threads::Mutex mutex;
+    Glib::Threads::Cond cond;
+    Glib::Threads::Mutex outputMutex;
+};
+
+// Returns the amount of physical memory of the host, or 0 if unknown
+std::size_t getPhysicalMemory ()
+{
+#ifdef WIN32
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof(status);
+
+    if (GlobalMemoryStatusEx(&status)) {
+        return status.ullTotalPhys;
+    }
+
+#elif defined(_SC_PHYS_PAGES) && defined(_SC_PAGE_SIZE)
+    const long pages = sysconf(_SC_PHYS_PAGES);
+    const long pageSize = sysconf(_SC_PAGE_SIZE);
+
+    if (pages > 0 && pageSize > 0) {
+        return static_cast<std::size_t>(pages) * static_cast<std::size_t>(pageSize);
+    }
+
+#endif
+    return 0;
+}
+
+/* Decode stage: loads the image and builds its processing parameters.
+ * Returns nullptr if the image is skipped, 'failed' telling whether it is an error */
+BatchImage* decodeImage (const BatchSettings& batch, const Glib::ustring& inputFile, BatchScheduler& scheduler, bool& failed, std::ostream& out, std::ostream& err)
+{
+    failed = false;
+
+    out << "Processing: " << inputFile << std::endl;
+
+    rtengine::InitialImage* ii = nullptr;
+    int errorCode;
+    bool isRaw = false;
+
+    Glib::ustring outputFile;
+
+    if( batch.outputPath.empty() ) {
+        Glib::ustring s = inputFile;
+        Glib::ustring::size_type ext = s.find_last_of('.');
+        outputFile = s.substr(0, ext) + "." + batch.outputType;
+    } else if( batch.outputDirectory ) {
+        Glib::ustring s = Glib::path_get_basename( inputFile );
+        Glib::ustring::size_type ext = s.find_last_of('.');
+        outputFile = batch.outputPath + "/" + s.substr(0, ext) + "." + batch.outputType;
+    } else {
+        Glib::ustring s = batch.outputPath;
+        Glib::ustring::size_type ext = s.find_last_of('.');
+        outputFile =  s.substr(0, ext) + "." + batch.outputType;
+    }
+
+    if( inputFile == outputFile) {
+        err << "Cannot overwrite: " << inputFile << std::endl;
+        return nullptr;
+    }
+
+    if( !batch.overwriteFiles && Glib::file_test( outputFile , Glib::FILE_TEST_EXISTS ) ) {
+        err << outputFile  << " already exists: use -Y option to overwrite. This image has been skipped." << std::endl;
+        return nullptr;
+    }
+
+    // Load the image
+    isRaw = true;
+    Glib::ustring ext = getExtension (inputFile);
+
+    if (ext.lowercase() == "jpg" || ext.lowercase() == "jpeg" || ext.lowercase() == "tif" || ext.lowercase() == "tiff" || ext.lowercase() == "png") {
+        isRaw = false;
+    }
+
+    // Wait for enough memory before decoding the image. Its size is not known yet, so it is expected to be as big as the
+    // largest one so far, and corrected once decoded. The budget is given back by the encode stage
+    const std::size_t expectedFootprint = scheduler.getExpectedFootprint ();
+    scheduler.acquire (expectedFootprint);
+
+    ii = rtengine::InitialImage::load ( inputFile, isRaw, &errorCode, nullptr );
+
+    if (!ii) {
+        scheduler.release (expectedFootprint);
+        failed = true;
+        err << "Error loading file: " << inputFile << std::endl;
+        return nullptr;
+    }
+
+    // Has to be reinstanciated at each profile to have a ProcParams object with default values
+    BatchImage* image = new BatchImage;
+    image->inputFile = inputFile;
+    image->outputFile = outputFile;
+    image->job = nullptr;
+    image->result = nullptr;
+    rtengine::procparams::ProcParams& currentParams = image->params;
+
+    if (batch.useDefault) {
+        if (isRaw) {
+            out << "  Merging default raw processing profile" << std::endl;
+            batch.rawParams->applyTo(&currentParams);
+        } else {
+            out << "  Merging default non-raw processing profile" << std::endl;
+            batch.imgParams->applyTo(&currentParams);
+        }
+    }
+
+    bool sideCarFound = false;
+    unsigned int i = 0;
+
+    // Iterate the procparams file list in order to build the final ProcParams
+    do {
+        if (batch.sideProcParams && i == batch.sideCarFilePos) {
+            // using the sidecar file
+            Glib::ustring sideProcessingParams = inputFile + paramFileExtension;
+
+            // the "load" method don't reset the procparams values anymore, so values found in the procparam file override the one of currentParams
+            if( !Glib::file_test( sideProcessingParams, Glib::FILE_TEST_EXISTS ) || currentParams.load ( sideProcessingParams )) {
+                err << "Warning: sidecar file requested but not found for: " << sideProcessingParams << std::endl;
+            } else {
+                sideCarFound = true;
+                out << "  Merging sidecar procparams" << std::endl;
+            }
+        }
+
+        if( batch.processingParams.size() > i  ) {
+            out << "  Merging procparams #" << i << std::endl;
+            batch.processingParams[i]->applyTo(&currentParams);
+        }
+
+        i++;
+    } while (i < batch.processingParams.size() + (batch.sideProcParams ? 1 : 0));
+
+    if( batch.sideProcParams && !sideCarFound && batch.skipIfNoSidecar ) {
+        delete ii;
+        delete image;
+        scheduler.release (expectedFootprint);
+        failed = true;
+        err << "Error: no sidecar procparams found for: " << inputFile << std::endl;
+        return nullptr;
+    }
+
+    int fw, fh;
+    ii->getImageSource()->getFullSize (fw, fh);
+    image->footprint = static_cast<std::size_t>(fw) * static_cast<std::size_t>(fh) * batchBytesPerPixel;
+    scheduler.adjust (expectedFootprint, image->footprint);
+
+    image->job = rtengine::ProcessingJob::create (ii, currentParams);
+
+    // the job holds its own reference to the initial image
+    ii->decreaseRef();
+
+    if( !image->job ) {
+        scheduler.release (image->footprint);
+        delete image;
+        failed = true;
+        err << "Error creating processing for: " << inputFile << std::endl;
+        return nullptr;
+    }
+
+    return image;
+}
+
+/* Develop stage. Returns false if an error occurred */
+bool developImage (BatchImage* image, std::ostream& err)
+{
+    int errorCode;
+    image->result = rtengine::processImage (image->job, errorCode, nullptr, options.tunnelMetaData);
+
+    if( !image->result ) {
+        err << "Error processing: " << image->inputFile << std::endl;
+        rtengine::ProcessingJob::destroy( image->job );
+        image->job = nullptr;
+        return false;
+    }
+
+    // processImage has deleted the job
+    image->job = nullptr;
+    return true;
+}
+
+/* Encode stage: compresses and writes the image to disk. Returns false if an error occurred */
+bool encodeImage (const BatchSettings& batch, BatchImage* image, std::ostream& err)
+{
+    int errorCode;
+    rtengine::IImage16* resultImage = image->result;
+
+    // save image to disk
+    if( batch.outputType == "jpg" ) {
+        errorCode = resultImage->saveAsJPEG( image->outputFile, batch.compression, batch.subsampling );
+    } else if( batch.outputType == "tif" ) {
+        errorCode = resultImage->saveAsTIFF( image->outputFile, batch.bits, batch.compression == 0  );
+    } else if( batch.outputType == "png" ) {
+        errorCode = resultImage->saveAsPNG( image->outputFile, batch.compression, batch.bits );
+    } else {
+        errorCode = resultImage->saveToFile (image->outputFile);
+    }
+
+    resultImage->free();
+    image->result = nullptr;
+
+    if(errorCode) {
+        err << "Error saving to: " << image->outputFile << std::endl;
+        return false;
+    }
+
+    if( batch.copyParamsFile ) {
+        Glib::ustring outputProcessingParams = image->outputFile + paramFileExtension;
+        image->params.save( outputProcessingParams );
+    }
+
+    return true;
+}
+
+void decodeStage (const BatchSettings* batch, const std::vector<Glib::ustring>* inputFiles, BatchScheduler* scheduler, BatchImageQueue* decoded)
+{
+    for (const auto& inputFile : *inputFiles) {
+        std::ostringstream out, err;
+        bool failed;
+        BatchImage* image = decodeImage (*batch, inputFile, *scheduler, failed, out, err);
+
+        if (failed) {
+            scheduler->addError ();
+        }
+
+        scheduler->print (out.str(), err.str());
+
+        if (image && !decoded->push (image)) {
+            rtengine::ProcessingJob::destroy (image->job);
+            scheduler->release (image->footprint);
+            delete image;
+        }
+    }
+
+    decoded->close ();
+}
+
+void developStage (BatchScheduler* scheduler, BatchImageQueue* decoded, BatchImageQueue* developed, int ompThreads)
+{
+#ifdef _OPENMP
+    // the OpenMP thread count is a per thread setting, it only affects the parallel regions started by this worker
+    omp_set_num_threads (ompThreads);
+#endif
+
+    BatchImage* image;
+
+    while (decoded->pop (image)) {
+        std::ostringstream err;
+
+        if (developImage (image, err)) {
+            developed->push (image);
+        } else {
+            scheduler->addError ();
+            scheduler->print ("", err.str());
+            scheduler->release (image->footprint);
+            delete image;
+        }
+    }
+}
+
+void encodeStage (const BatchSettings* batch, BatchScheduler* scheduler, BatchImageQueue* developed)
+{
+    BatchImage* image;
+
+    while (developed->pop (image)) {
+        std::ostringstream err;
+
+        if (!encodeImage (*batch, image, err)) {
+            scheduler->addError ();
+            scheduler->print ("", err.str());
+        }
+
+        scheduler->release (image->footprint);
+        delete image;
+    }
+}
+
+}
+
 int processLineParams( int argc, char **argv )
 {
     rtengine::procparams::PartialProfile *rawParams = nullptr, *imgParams = nullptr;
@@ -424,6 +839,8 @@ int processLineParams( int argc, char **argv )
     int subsampling = 3;
     int bits = -1;
     std::string outputType = "";
+    int parallelJobs = 1;
+    std::size_t memoryBudget = 0;
     unsigned errors = 0;
 
     for( int iArg = 1; iArg < argc; iArg++) {
@@ -536,6 +953,58 @@ int processLineParams( int argc, char **argv )
                 compression = -1;
                 break;
 
+            case 'P':
+                // no value means "choose according to the number of cores"
+                parallelJobs = 0;
+
+                if (strlen(argv[iArg]) > 2) {
+                    sscanf(&argv[iArg][2], "%d", &parallelJobs);
+
+                    if (parallelJobs < 1) {
+                        std::cerr << "Error: the value accompanying the -P switch has to be 1 or more!" << std::endl;
+                        deleteProcParams(processingParams);
+                        return -3;
+                    }
+                }
+
+                break;
+
+            case 'M': {
+                int budgetMiB = 0;
+                sscanf(&argv[iArg][2], "%d", &budgetMiB);
+
+                if (budgetMiB < 1) {
+                    std::cerr << "Error: specify the memory budget of -M in MiB, e.g. -M4096." << std::endl;
+                    deleteProcParams(processingParams);
+                    return -3;
+                }
+
+                memoryBudget = static_cast<std::size_t>(budgetMiB) << 20;
+                break;
+            }
+
+            case 'I': {
+                rtengine::SimdLevel level;
+
+                if (!rtengine::getSimdLevelFromName(&argv[iArg][2], level)) {
+                    std::cerr << "Error: specify the instruction set of -I as generic, avx2 or avx512, e.g. -Igeneric." << std::endl;
+                    deleteProcParams(processingParams);
+                    return -3;
+                }
+
+                if (!rtengine::setSimdLevel(level)) {
+                    std::cerr << "Error: the " << rtengine::getSimdLevelName(level) << " instruction set is not supported by this cpu or this build." << std::endl;
+                    deleteProcParams(processingParams);
+                    return -3;
+                }
+
+                if (options.rtSettings.verbose) {
+                    std::cout << "Using the " << rtengine::getSimdLevelName(level) << " kernels" << std::endl;
+                }
+
+                break;
+            }
+
             case 'c': // MUST be last option
                 while (iArg + 1 < argc) {
                     iArg++;
@@ -622,7 +1091,7 @@ int processLineParams( int argc, char **argv )
                 std::cout << std::endl;
 #endif
                 std::cout << "Options:" << std::endl;
-                std::cout << "  " << Glib::path_get_basename(argv[0]) << " [-o <output>|-O <output>] [-s|-S] [-p <one.pp3> [-p <two.pp3> ...] ] [-d] [ -j[1-100] [-js<1-3>] | [-b<8|16>] [-t[z] | [-n]] ] [-Y] -c <input>" << std::endl;
+                std::cout << "  " << Glib::path_get_basename(argv[0]) << " [-o <output>|-O <output>] [-s|-S] [-p <one.pp3> [-p <two.pp3> ...] ] [-d] [ -j[1-100] [-js<1-3>] | [-b<8|16>] [-t[z] | [-n]] ] [-Y] [-P[<n>]] [-M<MiB>] [-I<level>] -c <input>" << std::endl;
                 std::cout << std::endl;
                 std::cout << "  -c <files>       Specify one or more input files." << std::endl;
                 std::cout << "                   -c must be the last option." << std::endl;
@@ -655,6 +1124,13 @@ int processLineParams( int argc, char **argv )
                 std::cout << "  -n               Specify output to be compressed PNG." << std::endl;
                 std::cout << "                   Compression is hard-coded to 6." << std::endl;
                 std::cout << "  -Y               Overwrite output if present." << std::endl;
+                std::cout << "  -P[<n>]          Process <n> images in parallel (default value: 1)." << std::endl;
+                std::cout << "                   Without a value, the number of images is chosen from the number of cores." << std::endl;
+                std::cout << "                   The cores are shared among the images in flight." << std::endl;
+                std::cout << "  -M<MiB>          Memory budget of the images processed in parallel with -P." << std::endl;
+                std::cout << "                   Defaults to 3/4 of the physical memory." << std::endl;
+                std::cout << "  -I<level>        Force the instruction set of the optimized kernels: generic, avx2 or avx512." << std::endl;
+                std::cout << "                   Defaults to the best one supported by the cpu." << std::endl;
                 std::cout << std::endl;
                 std::cout << "Your " << pparamsExt << " files can be incomplete, RawTherapee will build the final values as follows:" << std::endl;
                 std::cout << "  1- A new processing profile is created using neutral values," << std::endl;
@@ -732,151 +1208,71 @@ int processLineParams( int argc, char **argv )
         }
     }
 
-    for( size_t iFile = 0; iFile < inputFiles.size(); iFile++) {
-
-        // Has to be reinstanciated at each profile to have a ProcParams object with default values
-        rtengine::procparams::ProcParams currentParams;
-
-        Glib::ustring inputFile = inputFiles[iFile];
-        std::cout << "Processing: " << inputFile << std::endl;
-
-        rtengine::InitialImage* ii = nullptr;
-        rtengine::ProcessingJob* job = nullptr;
-        int errorCode;
-        bool isRaw = false;
-
-        Glib::ustring outputFile;
-
-        if( outputType.empty() ) {
-            outputType = "jpg";
-        }
-
-        if( outputPath.empty() ) {
-            Glib::ustring s = inputFile;
-            Glib::ustring::size_type ext = s.find_last_of('.');
-            outputFile = s.substr(0, ext) + "." + outputType;
-        } else if( outputDirectory ) {
-            Glib::ustring s = Glib::path_get_basename( inputFile );
-            Glib::ustring::size_type ext = s.find_last_of('.');
-            outputFile = outputPath + "/" + s.substr(0, ext) + "." + outputType;
-        } else {
-            Glib::ustring s = outputPath;
-            Glib::ustring::size_type ext = s.find_last_of('.');
-            outputFile =  s.substr(0, ext) + "." + outputType;
-        }
-
-        if( inputFile == outputFile) {
-            std::cerr << "Cannot overwrite: " << inputFile << std::endl;
-            continue;
-        }
-
-        if( !overwriteFiles && Glib::file_test( outputFile , Glib::FILE_TEST_EXISTS ) ) {
-            std::cerr << outputFile  << " already exists: use -Y option to overwrite. This image has been skipped." << std::endl;
-            continue;
-        }
-
-        // Load the image
-        isRaw = true;
-        Glib::ustring ext = getExtension (inputFile);
-
-        if (ext.lowercase() == "jpg" || ext.lowercase() == "jpeg" || ext.lowercase() == "tif" || ext.lowercase() == "tiff" || ext.lowercase() == "png") {
-            isRaw = false;
-        }
-
-        ii = rtengine::InitialImage::load ( inputFile, isRaw, &errorCode, nullptr );
-
-        if (!ii) {
-            errors++;
-            std::cerr << "Error loading file: " << inputFile << std::endl;
-            continue;
-        }
-
-        if (useDefault) {
-            if (isRaw) {
-                std::cout << "  Merging default raw processing profile" << std::endl;
-                rawParams->applyTo(&currentParams);
-            } else {
-                std::cout << "  Merging default non-raw processing profile" << std::endl;
-                imgParams->applyTo(&currentParams);
-            }
-        }
-
-        bool sideCarFound = false;
-        unsigned int i = 0;
+    if( outputType.empty() ) {
+        outputType = "jpg";
+    }
 
-        // Iterate the procparams file list in order to build the final ProcParams
-        do {
-            if (sideProcParams && i == sideCarFilePos) {
-                // using the sidecar file
-                Glib::ustring sideProcessingParams = inputFile + paramFileExtension;
+    BatchSettings batch;
+    batch.outputPath = outputPath;
+    batch.outputDirectory = outputDirectory;
+    batch.overwriteFiles = overwriteFiles;
+    batch.sideProcParams = sideProcParams;
+    batch.copyParamsFile = copyParamsFile;
+    batch.skipIfNoSidecar = skipIfNoSidecar;
+    batch.useDefault = useDefault;
+    batch.sideCarFilePos = sideCarFilePos;
+    batch.compression = compression;
+    batch.subsampling = subsampling;
+    batch.bits = bits;
+    batch.outputType = outputType;
+    batch.rawParams = rawParams;
+    batch.imgParams = imgParams;
+    batch.processingParams = processingParams;
+
+    const int procs = g_get_num_processors();
+
+    if (parallelJobs == 0) {
+#ifdef _OPENMP
+        // keep a few OpenMP threads per image, the develop stages still scale well at that count
+        parallelJobs = std::max(1, procs / 4);
+#else
+        parallelJobs = procs;
+#endif
+    }
 
-                // the "load" method don't reset the procparams values anymore, so values found in the procparam file override the one of currentParams
-                if( !Glib::file_test( sideProcessingParams, Glib::FILE_TEST_EXISTS ) || currentParams.load ( sideProcessingParams )) {
-                    std::cerr << "Warning: sidecar file requested but not found for: " << sideProcessingParams << std::endl;
-                } else {
-                    sideCarFound = true;
-                    std::cout << "  Merging sidecar procparams" << std::endl;
-                }
-            }
+    parallelJobs = std::max(1, std::min<int>(parallelJobs, inputFiles.size()));
 
-            if( processingParams.size() > i  ) {
-                std::cout << "  Merging procparams #" << i << std::endl;
-                processingParams[i]->applyTo(&currentParams);
-            }
+    if (memoryBudget == 0) {
+        memoryBudget = getPhysicalMemory() / 4 * 3;
+    }
 
-            i++;
-        } while (i < processingParams.size() + (sideProcParams ? 1 : 0));
+    BatchScheduler scheduler (memoryBudget);
 
-        if( sideProcParams && !sideCarFound && skipIfNoSidecar ) {
-            delete ii;
-            errors++;
-            std::cerr << "Error: no sidecar procparams found for: " << inputFile << std::endl;
-            continue;
-        }
+    // The images go through three stages connected by bounded queues: while one image is being developed,
+    // the next one is decoded and the previous one is compressed and written to disk
+    BatchImageQueue decoded (parallelJobs);
+    BatchImageQueue developed (parallelJobs);
 
-        job = rtengine::ProcessingJob::create (ii, currentParams);
+    const int ompThreads = std::max(1, procs / parallelJobs);
 
-        if( !job ) {
-            errors++;
-            std::cerr << "Error creating processing for: " << inputFile << std::endl;
-            ii->decreaseRef();
-            continue;
-        }
+    Glib::Threads::Thread* decoder = Glib::Threads::Thread::create (sigc::bind (sigc::ptr_fun (decodeStage), &batch, &inputFiles, &scheduler, &decoded));
+    Glib::Threads::Thread* encoder = Glib::Threads::Thread::create (sigc::bind (sigc::ptr_fun (encodeStage), &batch, &scheduler, &developed));
+    std::vector<Glib::Threads::Thread*> developers;
 
-        // Process image
-        rtengine::IImage16* resultImage = rtengine::processImage (job, errorCode, nullptr, options.tunnelMetaData);
+    for (int i = 0; i < parallelJobs; ++i) {
+        developers.push_back (Glib::Threads::Thread::create (sigc::bind (sigc::ptr_fun (developStage), &scheduler, &decoded, &developed, ompThreads)));
+    }
 
-        if( !resultImage ) {
-            errors++;
-            std::cerr << "Error processing: " << inputFile << std::endl;
-            rtengine::ProcessingJob::destroy( job );
-            continue;
-        }
+    decoder->join ();
 
-        // save image to disk
-        if( outputType == "jpg" ) {
-            errorCode = resultImage->saveAsJPEG( outputFile, compression, subsampling );
-        } else if( outputType == "tif" ) {
-            errorCode = resultImage->saveAsTIFF( outputFile, bits, compression == 0  );
-        } else if( outputType == "png" ) {
-            errorCode = resultImage->saveAsPNG( outputFile, compression, bits );
-        } else {
-            errorCode = resultImage->saveToFile (outputFile);
-        }
+    for (auto developer : developers) {
+        developer->join ();
+    }
 
-        if(errorCode) {
-            errors++;
-            std::cerr << "Error saving to: " << outputFile << std::endl;
-        } else {
-            if( copyParamsFile ) {
-                Glib::ustring outputProcessingParams = outputFile + paramFileExtension;
-                currentParams.save( outputProcessingParams );
-            }
-        }
+    developed.close ();
+    encoder->join ();
 
-        ii->decreaseRef();
-        resultImage->free();
-    }
+    errors = scheduler.getErrors ();
 
     if (imgParams) {
         imgParams->deleteInstance();
@@ -409,6 +409,7 @@ void Options::setDefaults ()
     overlayedFileNames = false;
     filmStripOverlayedFileNames = false;
     internalThumbIfUntouched = true;    // if TRUE, only fast, internal preview images are taken if the image is not edited yet
+    processedThumbOnSelection = true;   // if TRUE, the image selected alone or opened in the editor gets a thumbnail processed from its raw data
     showFileNames = true;
     filmStripShowFileNames = false;
     tabbedUI = false;
@@ -608,6 +609,11 @@ void Options::setDefaults ()
 
     rtSettings.darkFramesPath = "";
     rtSettings.flatFieldsPath = "";
+    rtSettings.demosaicCache = false;
+    rtSettings.demosaicCacheSize = 4096;
+    rtSettings.previewCacheSize = 256;
+    rtSettings.amazeTileSize = 0;
+    rtSettings.tracing = false;
 #ifdef WIN32
     const gchar* sysRoot = g_getenv ("SystemRoot"); // Returns e.g. "c:\Windows"
 
@@ -1119,6 +1125,10 @@ int Options::readFromFile (Glib::ustring fname)
                     internalThumbIfUntouched    = keyFile.get_boolean ("File Browser", "InternalThumbIfUntouched");
                 }
 
+                if (keyFile.has_key ("File Browser", "ProcessedThumbOnSelection")) {
+                    processedThumbOnSelection   = keyFile.get_boolean ("File Browser", "ProcessedThumbOnSelection");
+                }
+
                 if (keyFile.has_key ("File Browser", "menuGroupRank")) {
                     menuGroupRank               = keyFile.get_boolean ("File Browser", "menuGroupRank");
                 }
@@ -1228,6 +1238,26 @@ int Options::readFromFile (Glib::ustring fname)
                 if (keyFile.has_key ("Performance", "SerializeTiffRead")) {
                     serializeTiffRead          = keyFile.get_boolean ("Performance", "SerializeTiffRead");
                 }
+
+                if (keyFile.has_key ("Performance", "DemosaicCache")) {
+                    rtSettings.demosaicCache   = keyFile.get_boolean ("Performance", "DemosaicCache");
+                }
+
+                if (keyFile.has_key ("Performance", "DemosaicCacheSize")) {
+                    rtSettings.demosaicCacheSize = keyFile.get_integer ("Performance", "DemosaicCacheSize");
+                }
+
+                if (keyFile.has_key ("Performance", "PreviewCacheSize")) {
+                    rtSettings.previewCacheSize = keyFile.get_integer ("Performance", "PreviewCacheSize");
+                }
+
+                if (keyFile.has_key ("Performance", "AmazeTileSize")) {
+                    rtSettings.amazeTileSize = keyFile.get_integer ("Performance", "AmazeTileSize");
+                }
+
+                if (keyFile.has_key ("Performance", "Tracing")) {
+                    rtSettings.tracing         = keyFile.get_boolean ("Performance", "Tracing");
+                }
             }
 
             if (keyFile.has_group ("GUI")) {
@@ -1914,6 +1944,7 @@ int Options::saveToFile (Glib::ustring fname)
         keyFile.set_boolean ("File Browser", "ShowFileNames", showFileNames );
         keyFile.set_boolean ("File Browser", "FilmStripShowFileNames", filmStripShowFileNames );
         keyFile.set_boolean ("File Browser", "InternalThumbIfUntouched", internalThumbIfUntouched );
+        keyFile.set_boolean ("File Browser", "ProcessedThumbOnSelection", processedThumbOnSelection );
         keyFile.set_boolean ("File Browser", "menuGroupRank", menuGroupRank);
         keyFile.set_boolean ("File Browser", "menuGroupLabel", menuGroupLabel);
         keyFile.set_boolean ("File Browser", "menuGroupFileOperations", menuGroupFileOperations);
@@ -1949,6 +1980,11 @@ int Options::saveToFile (Glib::ustring fname)
         keyFile.set_integer ("Performance", "PreviewDemosaicFromSidecar", prevdemo);
         keyFile.set_boolean ("Performance", "Daubechies", rtSettings.daubech);
         keyFile.set_boolean ("Performance", "SerializeTiffRead", serializeTiffRead);
+        keyFile.set_boolean ("Performance", "DemosaicCache", rtSettings.demosaicCache);
+        keyFile.set_integer ("Performance", "DemosaicCacheSize", rtSettings.demosaicCacheSize);
+        keyFile.set_integer ("Performance", "PreviewCacheSize", rtSettings.previewCacheSize);
+        keyFile.set_integer ("Performance", "AmazeTileSize", rtSettings.amazeTileSize);
+        keyFile.set_boolean ("Performance", "Tracing", rtSettings.tracing);
 
         keyFile.set_string  ("Output", "Format", saveFormat.format);
         keyFile.set_integer ("Output", "JpegQuality", saveFormat.jpegQuality);
@@ -2258,6 +2294,9 @@ bool Options::load ()
         printf ("Cache directory (cacheBaseDir) = %s\n", cacheBaseDir.c_str());
     }
 
+    options.rtSettings.demosaicCacheDir = Glib::build_filename (cacheBaseDir, "demosaic");
+    options.rtSettings.traceFile = Glib::build_filename (cacheBaseDir, "trace.json");
+
     // Update profile's path and recreate it if necessary
     options.updatePaths();
 
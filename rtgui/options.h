@@ -195,6 +195,7 @@ public:
     std::vector<Glib::ustring> renameTemplates;
     bool renameUseTemplates;
     bool internalThumbIfUntouched;
+    bool processedThumbOnSelection;
     bool overwriteOutputFile;
 
     std::vector<double> thumbnailZoomRatios;
@@ -597,6 +597,24 @@ Gtk::Widget* Preferences::getPerformancePanel ()
     finspect->add(*maxIBuffersHB);
     mainContainer->pack_start(*finspect, Gtk::PACK_SHRINK, 4);
 
+    Gtk::Frame* fdemosaicCache = Gtk::manage( new Gtk::Frame (M("PREFERENCES_DEMOSAICCACHE")) );
+    Gtk::VBox* vbdemosaicCache = Gtk::manage( new Gtk::VBox (false, 4) );
+    demosaicCacheCB = Gtk::manage( new Gtk::CheckButton (M("PREFERENCES_DEMOSAICCACHE_ENABLED")) );
+    demosaicCacheCB->set_tooltip_text(M("PREFERENCES_DEMOSAICCACHE_TOOLTIP"));
+    Gtk::HBox* demosaicCacheSizeHB = Gtk::manage( new Gtk::HBox () );
+    demosaicCacheSizeHB->set_spacing(4);
+    Gtk::Label* demosaicCacheSizeLbl = Gtk::manage( new Gtk::Label (M("PREFERENCES_DEMOSAICCACHE_SIZE") + ":", Gtk::ALIGN_START));
+    demosaicCacheSizeSB = Gtk::manage( new Gtk::SpinButton () );
+    demosaicCacheSizeSB->set_digits (0);
+    demosaicCacheSizeSB->set_increments (256, 1024);
+    demosaicCacheSizeSB->set_range (256, 1024 * 1024);
+    demosaicCacheSizeHB->pack_start (*demosaicCacheSizeLbl, Gtk::PACK_SHRINK, 0);
+    demosaicCacheSizeHB->pack_end (*demosaicCacheSizeSB, Gtk::PACK_SHRINK, 0);
+    vbdemosaicCache->pack_start (*demosaicCacheCB, Gtk::PACK_SHRINK, 0);
+    vbdemosaicCache->pack_start (*demosaicCacheSizeHB, Gtk::PACK_SHRINK, 0);
+    fdemosaicCache->add(*vbdemosaicCache);
+    mainContainer->pack_start(*fdemosaicCache, Gtk::PACK_SHRINK, 4);
+
     Gtk::Frame* fdenoise = Gtk::manage( new Gtk::Frame (M("PREFERENCES_NOISE")) );
     Gtk::VBox* vbdenoise = Gtk::manage( new Gtk::VBox (Gtk::PACK_SHRINK, 4) );
 
@@ -1236,6 +1254,8 @@ Gtk::Widget* Preferences::getFileBrowserPanel ()
     sameThumbSize = Gtk::manage( new Gtk::CheckButton (M("PREFERENCES_FSTRIP_SAME_THUMB_HEIGHT")) );
     sameThumbSize->set_tooltip_text(M("PREFERENCES_FSTRIP_SAME_THUMB_HEIGHT_HINT"));
     ckbInternalThumbIfUntouched = Gtk::manage( new Gtk::CheckButton (M("PREFERENCES_INTERNALTHUMBIFUNTOUCHED")));
+    ckbProcessedThumbOnSelection = Gtk::manage( new Gtk::CheckButton (M("PREFERENCES_PROCESSEDTHUMBONSELECTION")));
+    ckbProcessedThumbOnSelection->set_tooltip_text(M("PREFERENCES_PROCESSEDTHUMBONSELECTION_HINT"));
 
     vbro->pack_start (*showDateTime, Gtk::PACK_SHRINK, 0);
     Gtk::Label* dflab = Gtk::manage( new Gtk::Label (M("PREFERENCES_DATEFORMAT") + ":", Gtk::ALIGN_START));
@@ -1253,6 +1273,7 @@ Gtk::Widget* Preferences::getFileBrowserPanel ()
     vbro->pack_start (*filmStripOverlayedFileNames, Gtk::PACK_SHRINK, 0);
     vbro->pack_start (*sameThumbSize, Gtk::PACK_SHRINK, 0);
     vbro->pack_start (*ckbInternalThumbIfUntouched, Gtk::PACK_SHRINK, 0);
+    vbro->pack_start (*ckbProcessedThumbOnSelection, Gtk::PACK_SHRINK, 0);
 
     Gtk::HBox* hbrecent = Gtk::manage( new Gtk::HBox () );
     Gtk::Label* labrecent = Gtk::manage( new Gtk::Label (M("PREFERENCES_MAXRECENTFOLDERS") + ":") );
@@ -1695,6 +1716,7 @@ void Preferences::storePreferences ()
     moptions.filmStripOverlayedFileNames = filmStripOverlayedFileNames->get_active();
     moptions.sameThumbSize = sameThumbSize->get_active();
     moptions.internalThumbIfUntouched = ckbInternalThumbIfUntouched->get_active ();
+    moptions.processedThumbOnSelection = ckbProcessedThumbOnSelection->get_active ();
 
     moptions.saveParamsFile = saveParamsFile->get_active ();
     moptions.saveParamsCache = saveParamsCache->get_active ();
@@ -1731,6 +1753,8 @@ void Preferences::storePreferences ()
     moptions.rgbDenoiseThreadLimit = rgbDenoiseTreadLimitSB->get_value_as_int();
     moptions.clutCacheSize = clutCacheSizeSB->get_value_as_int();
     moptions.maxInspectorBuffers = maxInspectorBuffersSB->get_value_as_int();
+    moptions.rtSettings.demosaicCache = demosaicCacheCB->get_active();
+    moptions.rtSettings.demosaicCacheSize = demosaicCacheSizeSB->get_value_as_int();
 
     // Sounds only on Windows and Linux
 #if defined(WIN32) || defined(__linux__)
@@ -1903,6 +1927,7 @@ void Preferences::fillPreferences ()
     filmStripOverlayedFileNames->set_active(moptions.filmStripOverlayedFileNames);
     sameThumbSize->set_active(moptions.sameThumbSize);
     ckbInternalThumbIfUntouched->set_active(moptions.internalThumbIfUntouched);
+    ckbProcessedThumbOnSelection->set_active(moptions.processedThumbOnSelection);
 
     saveParamsFile->set_active (moptions.saveParamsFile);
     saveParamsCache->set_active (moptions.saveParamsCache);
@@ -1928,6 +1953,8 @@ void Preferences::fillPreferences ()
     rgbDenoiseTreadLimitSB->set_value(moptions.rgbDenoiseThreadLimit);
     clutCacheSizeSB->set_value(moptions.clutCacheSize);
     maxInspectorBuffersSB->set_value(moptions.maxInspectorBuffers);
+    demosaicCacheCB->set_active(moptions.rtSettings.demosaicCache);
+    demosaicCacheSizeSB->set_value(moptions.rtSettings.demosaicCacheSize);
 
     darkFrameDir->set_current_folder( moptions.rtSettings.darkFramesPath );
     darkFrameChanged ();
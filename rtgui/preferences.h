@@ -165,6 +165,8 @@ class Preferences : public Gtk::Dialog, public ProfileStoreListener
     Gtk::SpinButton*  rgbDenoiseTreadLimitSB;
     Gtk::SpinButton*  clutCacheSizeSB;
     Gtk::SpinButton*  maxInspectorBuffersSB;
+    Gtk::CheckButton* demosaicCacheCB;
+    Gtk::SpinButton*  demosaicCacheSizeSB;
 
     Gtk::CheckButton* ckbmenuGroupRank;
     Gtk::CheckButton* ckbmenuGroupLabel;
@@ -190,6 +192,7 @@ class Preferences : public Gtk::Dialog, public ProfileStoreListener
 
     Gtk::CheckButton* ckbTunnelMetaData;
     Gtk::CheckButton* ckbInternalThumbIfUntouched;
+    Gtk::CheckButton* ckbProcessedThumbOnSelection;
 
     Gtk::Entry* txtCustProfBuilderPath;
     Gtk::ComboBoxText* custProfBuilderLabelType;
@@ -159,6 +159,9 @@ public:
         // signal at end
         if (last && jobs_.empty()) {
             j.listener_->previewsFinished(j.dir_id_);
+
+            // all the thumbnails are loaded, good time to reclaim the space of the overwritten ones
+            cacheMgr->compactCache();
         }
     }
 };
@@ -0,0 +1,383 @@
+/*
+ *  This file is part of RawTherapee.
+ *
+ *  RawTherapee is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  RawTherapee is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Headless benchmark of the processing pipeline
+//
+// Every combination of input file, processing profile and thread count is developed in a child process, so that
+// the peak memory usage of a run is not hidden by the previous ones. The children time the stages instrumented
+// with BENCHSTAGE and print them as JSON, the parent gathers them in a single report.
+
+#include "config.h"
+#include <giomm.h>
+#include <glib/gstdio.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <locale.h>
+#include <sstream>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "options.h"
+#include "guiutils.h"
+#include "version.h"
+#include "../rtengine/rtengine.h"
+#include "../rtengine/cJSON.h"
+#include "../rtengine/cpufeatures.h"
+#include "../rtengine/mytime.h"
+#include "../rtengine/stagetimings.h"
+#include "../rtengine/utils.h"
+
+// stores path to data files
+Glib::ustring argv0;
+Glib::ustring creditsPath;
+Glib::ustring licensePath;
+Glib::ustring argv1;
+bool simpleEditor;
+
+namespace
+{
+
+const char* const runSwitch = "--run";
+
+double toMiB (std::size_t bytes)
+{
+    return bytes / 1048576.0;
+}
+
+bool isRawFile (const Glib::ustring& fileName)
+{
+    const Glib::ustring ext = getExtension (fileName).lowercase();
+    return !(ext == "jpg" || ext == "jpeg" || ext == "tif" || ext == "tiff" || ext == "png");
+}
+
+/* Child process: develops fileName once with profile (neutral if empty) and prints the timings as a JSON object */
+int runOnce (const Glib::ustring& fileName, const Glib::ustring& profile, int threads)
+{
+#ifdef _OPENMP
+    omp_set_num_threads (threads);
+#endif
+
+    rtengine::procparams::ProcParams params;
+
+    if (!profile.empty()) {
+        rtengine::procparams::PartialProfile partialProfile (true);
+
+        if (partialProfile.load (profile)) {
+            std::cerr << "Error: \"" << profile << "\" not found" << std::endl;
+            partialProfile.deleteInstance();
+            return 1;
+        }
+
+        partialProfile.applyTo (&params);
+        partialProfile.deleteInstance();
+    }
+
+    rtengine::StageTimings& timings = rtengine::StageTimings::getInstance();
+    timings.setEnabled (true);
+    timings.takeStages();
+
+    MyTime t1, t2;
+    t1.set();
+
+    int errorCode = 0;
+    rtengine::InitialImage* ii = rtengine::InitialImage::load (fileName, isRawFile (fileName), &errorCode, nullptr);
+
+    if (!ii) {
+        std::cerr << "Error loading file: " << fileName << std::endl;
+        return 1;
+    }
+
+    int fw, fh;
+    ii->getImageSource()->getFullSize (fw, fh);
+    // the decoding time depends on the raw format, which is given by the camera
+    const std::string camera = ii->getMetaData()->getCamera();
+
+    rtengine::ProcessingJob* job = rtengine::ProcessingJob::create (ii, params);
+    ii->decreaseRef();
+
+    rtengine::IImage16* result = rtengine::processImage (job, errorCode, nullptr, options.tunnelMetaData);
+
+    if (!result) {
+        std::cerr << "Error processing: " << fileName << std::endl;
+        rtengine::ProcessingJob::destroy (job);
+        return 1;
+    }
+
+    std::string outputFile;
+    g_close (Glib::file_open_tmp (outputFile, "rtbench"), nullptr);
+    errorCode = result->saveAsJPEG (outputFile, 92, 3);
+    result->free();
+    g_remove (outputFile.c_str());
+
+    if (errorCode) {
+        std::cerr << "Error saving to: " << outputFile << std::endl;
+        return 1;
+    }
+
+    t2.set();
+
+    const double megaPixels = static_cast<double>(fw) * fh / 1000000.0;
+    const double seconds = t2.etime (t1) / 1000000.0;
+
+    cJSON* run = cJSON_CreateObject();
+    cJSON_AddStringToObject (run, "file", fileName.c_str());
+    cJSON_AddStringToObject (run, "camera", camera.c_str());
+    cJSON_AddStringToObject (run, "profile", profile.empty() ? "neutral" : profile.c_str());
+    cJSON_AddNumberToObject (run, "threads", threads);
+    cJSON_AddNumberToObject (run, "megapixels", megaPixels);
+    cJSON_AddNumberToObject (run, "seconds", seconds);
+    cJSON_AddNumberToObject (run, "megapixelsPerSecond", megaPixels / seconds);
+    cJSON_AddNumberToObject (run, "peakMemoryMiB", toMiB (rtengine::getPeakMemoryUsage()));
+
+    cJSON* stages = cJSON_CreateObject();
+
+    for (const auto& stage : timings.takeStages()) {
+        const double stageSeconds = stage.second.microseconds / 1000000.0;
+        cJSON* item = cJSON_CreateObject();
+        cJSON_AddNumberToObject (item, "calls", stage.second.calls);
+        cJSON_AddNumberToObject (item, "seconds", stageSeconds);
+        cJSON_AddNumberToObject (item, "megapixelsPerSecond", stageSeconds > 0.0 ? megaPixels / stageSeconds : 0.0);
+        // peak of the process since the start of the run, measured at the end of the stage
+        cJSON_AddNumberToObject (item, "peakMemoryMiB", toMiB (stage.second.peakMemory));
+        cJSON_AddItemToObject (stages, stage.first.c_str(), item);
+    }
+
+    cJSON_AddItemToObject (run, "stages", stages);
+
+    char* text = cJSON_PrintUnformatted (run);
+    std::cout << text << std::endl;
+    free (text);
+    cJSON_Delete (run);
+
+    return 0;
+}
+
+void addInputFiles (const Glib::ustring& argument, std::vector<Glib::ustring>& inputFiles)
+{
+    if (Glib::file_test (argument, Glib::FILE_TEST_IS_REGULAR)) {
+        inputFiles.emplace_back (argument);
+        return;
+    }
+
+    if (!Glib::file_test (argument, Glib::FILE_TEST_IS_DIR)) {
+        std::cerr << "\"" << argument << "\" is neither a regular file nor a directory." << std::endl;
+        return;
+    }
+
+    try {
+        auto enumerator = Gio::File::create_for_path (argument)->enumerate_children ();
+
+        while (auto file = enumerator->next_file ()) {
+            const auto fileName = Glib::build_filename (argument, file->get_name ());
+
+            // skip directories, files without extension and sidecar files
+            if (Glib::file_test (fileName, Glib::FILE_TEST_IS_DIR) || getExtension (fileName).empty() || fileName.substr (fileName.find_last_of ('.')) == paramFileExtension) {
+                continue;
+            }
+
+            inputFiles.emplace_back (fileName);
+        }
+    } catch (Glib::Exception&) {}
+}
+
+void printUsage (const char* exeName)
+{
+    std::cout << "Usage: " << Glib::path_get_basename (exeName) << " [-t<n>[,<n>...]] [-p <file.pp3> [-p <file.pp3> ...]] [-r<n>] [-o <report.json>] <dir>|<files>" << std::endl;
+    std::cout << std::endl;
+    std::cout << "  -t<n>[,<n>...]   Thread counts to benchmark (default value: number of cores)." << std::endl;
+    std::cout << "  -p <file.pp3>    Processing profile to benchmark, can be repeated (default: neutral profile)." << std::endl;
+    std::cout << "  -r<n>            Number of runs of each combination (default value: 1)." << std::endl;
+    std::cout << "  -o <report.json> Write the report to a file instead of the standard output." << std::endl;
+    std::cout << std::endl;
+    std::cout << "Every combination of file, profile and thread count is developed to a temporary JPEG." << std::endl;
+    std::cout << "The report gives the wall time, MPix/s and peak memory of each run and of each stage." << std::endl;
+}
+
+}
+
+int main (int argc, char **argv)
+{
+    setlocale (LC_ALL, "");
+    setlocale (LC_NUMERIC, "C"); // to set decimal point to "."
+    Glib::init();
+    Gio::init ();
+
+#ifdef BUILD_BUNDLE
+
+    if (Glib::path_is_absolute (DATA_SEARCH_PATH)) {
+        argv0 = DATA_SEARCH_PATH;
+    } else {
+        argv0 = Glib::build_filename (Glib::path_get_dirname (Glib::find_program_in_path (argv[0])), DATA_SEARCH_PATH);
+    }
+
+#else
+    argv0 = DATA_SEARCH_PATH;
+#endif
+
+    if (argc == 5 && !strcmp (argv[1], runSwitch)) {
+        if (!Options::load ()) {
+            return 1;
+        }
+
+        // the report is read from the standard output
+        options.rtSettings.verbose = false;
+
+        return runOnce (argv[2], argv[3], atoi (argv[4]));
+    }
+
+    std::vector<int> threadCounts;
+    std::vector<Glib::ustring> profiles;
+    std::vector<Glib::ustring> inputFiles;
+    Glib::ustring reportFile;
+    int repetitions = 1;
+
+    for (int iArg = 1; iArg < argc; iArg++) {
+        if (argv[iArg][0] != '-') {
+            addInputFiles (argv[iArg], inputFiles);
+            continue;
+        }
+
+        switch (argv[iArg][1]) {
+        case 't': {
+            std::istringstream counts (&argv[iArg][2]);
+            std::string count;
+
+            while (std::getline (counts, count, ',')) {
+                const int threads = atoi (count.c_str());
+
+                if (threads < 1) {
+                    std::cerr << "Error: the thread counts of -t have to be 1 or more, e.g. -t1,4,8." << std::endl;
+                    return 1;
+                }
+
+                threadCounts.push_back (threads);
+            }
+
+            break;
+        }
+
+        case 'p':
+            if (iArg + 1 < argc) {
+                profiles.emplace_back (argv[++iArg]);
+            }
+
+            break;
+
+        case 'r':
+            repetitions = atoi (&argv[iArg][2]);
+
+            if (repetitions < 1) {
+                std::cerr << "Error: the value accompanying the -r switch has to be 1 or more!" << std::endl;
+                return 1;
+            }
+
+            break;
+
+        case 'o':
+            if (iArg + 1 < argc) {
+                reportFile = argv[++iArg];
+            }
+
+            break;
+
+        default:
+            printUsage (argv[0]);
+            return 1;
+        }
+    }
+
+    if (inputFiles.empty()) {
+        printUsage (argv[0]);
+        return 1;
+    }
+
+    if (threadCounts.empty()) {
+#ifdef _OPENMP
+        threadCounts.push_back (omp_get_num_procs());
+#else
+        threadCounts.push_back (1);
+#endif
+    }
+
+    if (profiles.empty()) {
+        profiles.emplace_back ();
+    }
+
+    rtengine::initSimdLevel ();
+
+    cJSON* report = cJSON_CreateObject();
+    cJSON_AddStringToObject (report, "version", RTVERSION);
+    cJSON_AddStringToObject (report, "simd", rtengine::getSimdLevelName (rtengine::getSimdLevel()));
+    cJSON* runs = cJSON_CreateArray();
+    cJSON_AddItemToObject (report, "runs", runs);
+    unsigned errors = 0;
+
+    for (const auto& inputFile : inputFiles) {
+        for (const auto& profile : profiles) {
+            for (int threads : threadCounts) {
+                for (int repetition = 0; repetition < repetitions; repetition++) {
+                    std::cerr << inputFile << ", " << (profile.empty() ? "neutral" : profile) << ", " << threads << " threads, run " << repetition + 1 << std::endl;
+
+                    std::vector<std::string> childArgs = {Glib::find_program_in_path (argv[0]), runSwitch, inputFile, profile, std::to_string (threads)};
+                    std::string output, errorOutput;
+                    int exitStatus = 0;
+
+                    try {
+                        Glib::spawn_sync ("", childArgs, Glib::SPAWN_DEFAULT, Glib::SlotSpawnChildSetup(), &output, &errorOutput, &exitStatus);
+                    } catch (Glib::Exception& e) {
+                        errorOutput = e.what();
+                        exitStatus = -1;
+                    }
+
+                    // the report of the child is its last line
+                    const std::string::size_type lastLine = output.find_last_of ('\n', output.size() > 1 ? output.size() - 2 : 0);
+                    cJSON* run = exitStatus == 0 ? cJSON_Parse (output.c_str() + (lastLine == std::string::npos ? 0 : lastLine + 1)) : nullptr;
+
+                    if (!run) {
+                        std::cerr << errorOutput;
+                        errors++;
+                        continue;
+                    }
+
+                    cJSON_AddNumberToObject (run, "run", repetition + 1);
+                    cJSON_AddItemToArray (runs, run);
+                }
+            }
+        }
+    }
+
+    char* text = cJSON_Print (report);
+
+    if (reportFile.empty()) {
+        std::cout << text << std::endl;
+    } else {
+        try {
+            Glib::file_set_contents (reportFile, text);
+        } catch (Glib::FileError& e) {
+            std::cerr << "Error writing " << reportFile << ": " << e.what() << std::endl;
+            errors++;
+        }
+    }
+
+    free (text);
+    cJSON_Delete (report);
+
+    return errors ? 2 : 0;
+}
@@ -734,7 +734,7 @@ void ThumbBrowserBase::on_style_updated ()
     refreshThumbImages ();
 }
 
-ThumbBrowserBase::Internal::Internal () : ofsX(0), ofsY(0), parent(nullptr), dirty(true)
+ThumbBrowserBase::Internal::Internal () : ofsX(0), ofsY(0), scrollDirection(1), parent(nullptr), dirty(true)
 {
     Glib::RefPtr<Gtk::StyleContext> style = get_style_context();
     set_name("FileCatalog");
@@ -747,6 +747,12 @@ void ThumbBrowserBase::Internal::setParent (ThumbBrowserBase* p)
 
 void ThumbBrowserBase::Internal::setPosition (int x, int y)
 {
+    const int delta = parent && parent->arrangement == TB_Horizontal ? x - ofsX : y - ofsY;
+
+    if (delta != 0) {
+        scrollDirection = delta > 0 ? 1 : -1;
+    }
+
     ofsX = x;
     ofsY = y;
 }
@@ -858,11 +864,17 @@ bool ThumbBrowserBase::Internal::on_draw(const ::Cairo::RefPtr< Cairo::Context>
     {
         MYWRITERLOCK(l, parent->entryRW);
 
+        // the page that comes next in the scrolling direction
+        const int aheadX = parent->arrangement == TB_Horizontal ? scrollDirection * w : 0;
+        const int aheadY = parent->arrangement == TB_Horizontal ? 0 : scrollDirection * h;
+
         for (size_t i = 0; i < parent->fd.size() && !dirty; i++) { // if dirty meanwhile, cancel and wait for next redraw
-            if (!parent->fd[i]->drawable || !parent->fd[i]->insideWindow (0, 0, w, h)) {
-                parent->fd[i]->updatepriority = false;
+            if (!parent->fd[i]->drawable) {
+                parent->fd[i]->updatepriority = ThumbBrowserEntryBase::UPDATE_LATER;
+            } else if (!parent->fd[i]->insideWindow (0, 0, w, h)) {
+                parent->fd[i]->updatepriority = parent->fd[i]->insideWindow (aheadX, aheadY, w, h) ? ThumbBrowserEntryBase::UPDATE_AHEAD : ThumbBrowserEntryBase::UPDATE_LATER;
             } else {
-                parent->fd[i]->updatepriority = true;
+                parent->fd[i]->updatepriority = ThumbBrowserEntryBase::UPDATE_VISIBLE;
                 parent->fd[i]->draw (cr);
             }
         }
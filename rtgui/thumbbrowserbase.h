@@ -36,6 +36,7 @@ class ThumbBrowserBase  :  public Gtk::Grid
     {
         //Cairo::RefPtr<Cairo::Context> cc;
         int ofsX, ofsY;
+        int scrollDirection; // 1 if the last scrolling was forward, -1 if it was backward
         ThumbBrowserBase* parent;
         bool dirty;
 
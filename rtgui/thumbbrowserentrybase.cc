@@ -29,7 +29,7 @@ ThumbBrowserEntryBase::ThumbBrowserEntryBase (const Glib::ustring& fname)
       parent(nullptr), original(nullptr), bbSelected(false), bbFramed(false), bbPreview(nullptr), cursor_type(CSUndefined),
       thumbnail(nullptr), filename(fname), shortname(dispname), exifline(""), datetimeline(""),
       selected(false), drawable(false), filtered(false), framed(false), processing(false), italicstyle(false),
-      edited(false), recentlysaved(false), updatepriority(false), withFilename(WFNAME_NONE) {}
+      edited(false), recentlysaved(false), updatepriority(UPDATE_LATER), withFilename(WFNAME_NONE) {}
 
 ThumbBrowserEntryBase::~ThumbBrowserEntryBase ()
 {
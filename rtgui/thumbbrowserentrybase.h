@@ -98,6 +98,13 @@ public:
     Glib::ustring exifline;
     Glib::ustring datetimeline;
 
+    // order in which the thumbnail images are updated, see ThumbImageUpdater
+    enum UpdatePriority {
+        UPDATE_VISIBLE,     // in the viewport
+        UPDATE_AHEAD,       // in the page that comes next in the scrolling direction
+        UPDATE_LATER
+    };
+
 // misc attributes
     bool selected;
     bool drawable;
@@ -107,7 +114,7 @@ public:
     bool italicstyle;
     bool edited;
     bool recentlysaved;
-    bool updatepriority;
+    UpdatePriority updatepriority;
     eWithFilename withFilename;
 
     explicit ThumbBrowserEntryBase   (const Glib::ustring& fname);
@@ -17,11 +17,18 @@
  *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <iterator>
+#include <list>
+#include <map>
 #include <set>
+#include <iostream>
 #include "thumbimageupdater.h"
 #include <gtkmm.h>
 #include "guiutils.h"
 #include "threadutils.h"
+#include "options.h"
+#include "../rtengine/mytime.h"
 
 #ifdef _OPENMP
 #include <omp.h>
@@ -36,15 +43,15 @@ class ThumbImageUpdater::Impl :
 public:
 
     struct Job {
-        Job(ThumbBrowserEntryBase* tbe, bool* priority, bool upgrade,
+        Job(ThumbBrowserEntryBase* tbe, ThumbBrowserEntryBase::UpdatePriority* priority, bool upgrade,
             ThumbImageUpdateListener* listener):
             tbe_(tbe),
-    /*pparams_(pparams),
-    height_(height), */
             priority_(priority),
             upgrade_(upgrade),
             listener_(listener)
-        {}
+        {
+            queued_.set();
+        }
 
         Job():
             tbe_(nullptr),
@@ -54,18 +61,24 @@ public:
         {}
 
         ThumbBrowserEntryBase* tbe_;
-        /*rtengine::procparams::ProcParams pparams_;
-        int height_;*/
-        bool* priority_;
+        // read when the next job is chosen, so that the priorities follow the scrolling
+        ThumbBrowserEntryBase::UpdatePriority* priority_;
         bool upgrade_;
         ThumbImageUpdateListener* listener_;
+        MyTime queued_;
     };
 
     typedef std::list<Job> JobList;
 
+    // the queued jobs of each listener, to find them without going through the whole queue
+    typedef std::multimap<ThumbImageUpdateListener*, JobList::iterator> JobIndex;
+
     Impl():
         active_(0),
-        inactive_waiting_(false)
+        inactive_waiting_(false),
+        processed_(0),
+        totalLatency_(0),
+        maxLatency_(0)
     {
         int threadCount = 1;
 #if !(__GNUC__ == 4 && __GNUC_MINOR__ == 8 && defined( WIN32 ) && defined(__x86_64__))
@@ -85,13 +98,40 @@ public:
     Glib::Threads::Mutex mutex_;
 
     JobList jobs_;
+    JobIndex jobIndex_;
 
     unsigned int active_;
+    std::multiset<ThumbImageUpdateListener*> activeListeners_;
 
     bool inactive_waiting_;
 
     Glib::Threads::Cond inactive_;
 
+    // latencies, from the queuing of the jobs to the end of their processing, in microseconds
+    unsigned long processed_;
+    double totalLatency_;
+    int maxLatency_;
+
+    void
+    removeJob(JobIndex::iterator i)
+    {
+        jobs_.erase(i->second);
+        jobIndex_.erase(i);
+    }
+
+    void
+    waitForListener(ThumbImageUpdateListener* listener)
+    {
+        while ( listener ? activeListeners_.count(listener) != 0 : active_ != 0 ) {
+            // XXX this is nasty... it would be nicer if we weren't called with
+            // this lock held
+            GThreadUnLock unlock;
+            DEBUG("waiting for running jobs");
+            inactive_waiting_ = true;
+            inactive_.wait(mutex_);
+        }
+    }
+
     void
     processNextJob()
     {
@@ -106,40 +146,37 @@ public:
                 return;
             }
 
-            JobList::iterator i;
+            // the jobs of the visible entries come first, then the ones of the entries about to be scrolled into view, then the others;
+            // at the same priority, the images are made before their upgrade to processed ones, and the oldest job wins
+            JobList::iterator i = jobs_.begin();
+            int rank = 2 * *(i->priority_) + i->upgrade_;
 
-            // see if any priority jobs exist
-            for ( i = jobs_.begin(); i != jobs_.end(); ++i) {
-                if ( *(i->priority_) ) {
-                    DEBUG("processing(priority) %s", i->tbe_->thumbnail->getFileName().c_str());
-                    break;
-                }
-            }
+            for ( JobList::iterator k = std::next(i); k != jobs_.end() && rank > 0; ++k ) {
+                const int krank = 2 * *(k->priority_) + k->upgrade_;
 
-            // see if any none upgrade jobs exist
-            if ( i == jobs_.end() ) {
-                for ( i = jobs_.begin(); i != jobs_.end(); ++i) {
-                    if ( !i->upgrade_ ) {
-                        DEBUG("processing(not-upgrade) %s", i->tbe_->thumbnail->getFileName().c_str());
-                        break;
-                    }
+                if ( krank < rank ) {
+                    i = k;
+                    rank = krank;
                 }
             }
 
-            // if none, then use first
-            if ( i == jobs_.end() ) {
-                i = jobs_.begin();
-                DEBUG("processing(first) %s", i->tbe_->thumbnail->getFileName().c_str());
-            }
+            DEBUG("processing(rank %d) %s", rank, i->tbe_->thumbnail->getFileName().c_str());
 
             // copy found job
             j = *i;
 
             // remove so not run again
-            jobs_.erase(i);
+            for ( JobIndex::iterator k = jobIndex_.lower_bound(j.listener_); k != jobIndex_.end() && k->first == j.listener_; ++k ) {
+                if ( k->second == i ) {
+                    removeJob(k);
+                    break;
+                }
+            }
+
             DEBUG("%d job(s) remaining", int(jobs_.size()) );
 
             ++active_;
+            activeListeners_.insert(j.listener_);
         }
 
         // unlock and do processing; will relock on block exit, then call listener
@@ -160,13 +197,33 @@ public:
             j.listener_->updateImage(img, scale, thm->getProcParams().crop);
         }
 
+        MyTime done;
+        done.set();
+
         {
             Glib::Threads::Mutex::Lock lock(mutex_);
 
-            if ( --active_ == 0 &&
-                    inactive_waiting_ ) {
+            const int latency = done.etime(j.queued_);
+            ++processed_;
+            totalLatency_ += latency;
+            maxLatency_ = std::max(maxLatency_, latency);
+
+            activeListeners_.erase(activeListeners_.find(j.listener_));
+
+            if ( --active_ == 0 && jobs_.empty() ) {
+                if ( options.rtSettings.verbose ) {
+                    std::cout << "ThumbImageUpdater: " << processed_ << " thumbnail(s) updated, latency " << totalLatency_ / processed_ / 1000.0
+                              << " ms on average, " << maxLatency_ / 1000.0 << " ms at most" << std::endl;
+                }
+
+                processed_ = 0;
+                totalLatency_ = 0;
+                maxLatency_ = 0;
+            }
+
+            if ( inactive_waiting_ ) {
                 inactive_waiting_ = false;
-                inactive_.signal();
+                inactive_.broadcast();
             }
         }
     }
@@ -185,7 +242,7 @@ ThumbImageUpdater::ThumbImageUpdater():
 }
 
 void
-ThumbImageUpdater::add(ThumbBrowserEntryBase* tbe, bool* priority, bool upgrade, ThumbImageUpdateListener* l)
+ThumbImageUpdater::add(ThumbBrowserEntryBase* tbe, ThumbBrowserEntryBase::UpdatePriority* priority, bool upgrade, ThumbImageUpdateListener* l)
 {
     // nobody listening?
     if ( l == nullptr ) {
@@ -195,17 +252,14 @@ ThumbImageUpdater::add(ThumbBrowserEntryBase* tbe, bool* priority, bool upgrade,
     Glib::Threads::Mutex::Lock lock(impl_->mutex_);
 
     // look up if an older version is in the queue
-    Impl::JobList::iterator i(impl_->jobs_.begin());
+    for ( Impl::JobIndex::iterator i = impl_->jobIndex_.lower_bound(l); i != impl_->jobIndex_.end() && i->first == l; ++i ) {
+        Impl::Job& job = *i->second;
 
-    for ( ; i != impl_->jobs_.end(); ++i ) {
-        if ( i->tbe_ == tbe &&
-                i->listener_ == l &&
-                i->upgrade_ == upgrade ) {
+        if ( job.tbe_ == tbe &&
+                job.upgrade_ == upgrade ) {
             DEBUG("updating job %s", tbe->shortname.c_str());
             // we have one, update queue entry, will be picked up by thread when processed
-            /*i->pparams_ = params;
-            i->height_ = height; */
-            i->priority_ = priority;
+            job.priority_ = priority;
             return;
         }
     }
@@ -213,6 +267,7 @@ ThumbImageUpdater::add(ThumbBrowserEntryBase* tbe, bool* priority, bool upgrade,
     // create a new job and append to queue
     DEBUG("queing job %s", tbe->shortname.c_str());
     impl_->jobs_.push_back(Impl::Job(tbe, priority, upgrade, l));
+    impl_->jobIndex_.emplace(l, std::prev(impl_->jobs_.end()));
 
     DEBUG("adding run request %s", tbe->shortname.c_str());
     impl_->threadPool_->push(sigc::mem_fun(*impl_, &ThumbImageUpdater::Impl::processNextJob));
@@ -226,24 +281,12 @@ ThumbImageUpdater::removeJobs(ThumbImageUpdateListener* listener)
 
     Glib::Threads::Mutex::Lock lock(impl_->mutex_);
 
-    for( Impl::JobList::iterator i(impl_->jobs_.begin()); i != impl_->jobs_.end(); ) {
-        if (i->listener_ == listener) {
-            DEBUG("erasing specific job");
-            Impl::JobList::iterator e(i++);
-            impl_->jobs_.erase(e);
-        } else {
-            ++i;
-        }
+    for ( Impl::JobIndex::iterator i = impl_->jobIndex_.lower_bound(listener); i != impl_->jobIndex_.end() && i->first == listener; ) {
+        DEBUG("erasing specific job");
+        impl_->removeJob(i++);
     }
 
-    while ( impl_->active_ != 0 ) {
-        // XXX this is nasty... it would be nicer if we weren't called with
-        // this lock held
-        GThreadUnLock unlock;
-        DEBUG("waiting for running jobs1");
-        impl_->inactive_waiting_ = true;
-        impl_->inactive_.wait(impl_->mutex_);
-    }
+    impl_->waitForListener(listener);
 }
 
 void
@@ -254,14 +297,21 @@ ThumbImageUpdater::removeAllJobs()
     Glib::Threads::Mutex::Lock lock(impl_->mutex_);
 
     impl_->jobs_.clear();
+    impl_->jobIndex_.clear();
 
-    while ( impl_->active_ != 0 ) {
-        // XXX this is nasty... it would be nicer if we weren't called with
-        // this lock held
-        GThreadUnLock unlock;
-        DEBUG("waiting for running jobs2");
-        impl_->inactive_waiting_ = true;
-        impl_->inactive_.wait(impl_->mutex_);
-    }
+    impl_->waitForListener(nullptr);
 }
 
+ThumbImageUpdater::Statistics
+ThumbImageUpdater::getStatistics()
+{
+    Glib::Threads::Mutex::Lock lock(impl_->mutex_);
+
+    Statistics statistics;
+    statistics.queued = impl_->jobs_.size();
+    statistics.active = impl_->active_;
+    statistics.processed = impl_->processed_;
+    statistics.meanLatency = impl_->processed_ ? impl_->totalLatency_ / impl_->processed_ / 1000.0 : 0.0;
+    statistics.maxLatency = impl_->maxLatency_ / 1000.0;
+    return statistics;
+}
@@ -65,19 +65,22 @@ public:
      * Code will add the request to the queue and, if needed, start a pool
      * thread to process it.
      *
-     * @param t thumbnail
-     * @param params processing params (?)
-     * @param height how big
-     * @param priority if \c true then run as soon as possible
+     * The jobs of the visible entries run first, then the ones of the entries
+     * about to be scrolled into view, then the others. The priority is read
+     * each time a job is chosen, so it can change while the job is queued.
+     *
+     * @param tbe thumbnail browser entry
+     * @param priority current update priority of the entry
+     * @param upgrade if \c true then upgrade a quick thumbnail to a processed one
      * @param l listener waiting on update
      */
-    void add(ThumbBrowserEntryBase* tbe, bool* priority, bool upgrade, ThumbImageUpdateListener* l);
+    void add(ThumbBrowserEntryBase* tbe, ThumbBrowserEntryBase::UpdatePriority* priority, bool upgrade, ThumbImageUpdateListener* l);
 
     /**
      * @brief Remove jobs associated with listener \c l.
      *
-     * Jobs being processed will be finished. Will not return till all jobs for
-     * \c l have been completed.
+     * Jobs being processed will be finished. Will not return till the running
+     * jobs for \c l have been completed.
      *
      * @param listener jobs associated with this will be stopped
      */
@@ -90,6 +93,22 @@ public:
      */
     void removeAllJobs(void);
 
+    struct Statistics {
+        std::size_t queued;     // jobs waiting in the queue
+        unsigned int active;    // jobs being processed
+        unsigned long processed; // jobs processed since the queue was last empty
+        double meanLatency;     // from the queuing of these jobs to the end of their processing, in ms
+        double maxLatency;
+    };
+
+    /**
+     * @brief Queue depth and latencies of the thumbnail image updates.
+     *
+     * They are shown in the progress bar of the file browser once its previews are loaded, and printed in verbose
+     * mode each time the queue gets empty.
+     */
+    Statistics getStatistics(void);
+
 private:
 
     ThumbImageUpdater();
@@ -61,7 +61,7 @@ Thumbnail::Thumbnail (CacheManager* cm, const Glib::ustring& fname, CacheImageDa
     tpp = nullptr;
 }
 
-Thumbnail::Thumbnail (CacheManager* cm, const Glib::ustring& fname, const std::string& md5)
+Thumbnail::Thumbnail (CacheManager* cm, const Glib::ustring& fname, const std::string& md5, const FileStamp& stamp)
     : fname(fname), cachemgr(cm), ref(1), enqueueNumber(0), tpp(nullptr), pparamsValid(false),
       pparamsSet(false), needsReProcessing(true), imageLoading(false), lastImg(nullptr),
       lastW(0), lastH(0), lastScale(0.0), initial_(true)
@@ -69,6 +69,7 @@ Thumbnail::Thumbnail (CacheManager* cm, const Glib::ustring& fname, const std::s
 
 
     cfs.md5 = md5;
+    cfs.fileStamp = stamp;
     loadProcParams ();
     _generateThumbnailImage ();
     cfs.recentlySaved = false;
@@ -153,7 +154,7 @@ void Thumbnail::_generateThumbnailImage ()
         cfs.supported = true;
         needsReProcessing = true;
 
-        cfs.save (getCacheFileName ("data", ".txt"));
+        saveCacheImageData ();
 
         generateExifDateTimeStrings ();
     }
@@ -450,7 +451,7 @@ void Thumbnail::imageDeveloped ()
 {
 
     cfs.recentlySaved = true;
-    cfs.save (getCacheFileName ("data", ".txt"));
+    saveCacheImageData ();
 
     if (options.saveParamsCache) {
         pparams.save (getCacheFileName ("profiles", paramFileExtension));
@@ -766,14 +767,17 @@ void Thumbnail::_loadThumbnail(bool firstTrial)
     tpp->isRaw = (cfs.format == (int) FT_Raw);
 
     // load supplementary data
-    bool succ = tpp->readData (getCacheFileName ("data", ".txt"));
+    std::string data;
+    bool succ = cachemgr->readCacheData (cfs.md5, ThumbnailDB::DATA, data) && tpp->readData (data);
 
     if (succ) {
         tpp->getAutoWBMultipliers(cfs.redAWBMul, cfs.greenAWBMul, cfs.blueAWBMul);
     }
 
     // thumbnail image
-    succ = succ && tpp->readImage (getCacheFileName ("images", ""));
+    succ = succ && cachemgr->readCacheData (cfs.md5, ThumbnailDB::IMAGE, [this] (const char* imageData, std::size_t size) {
+        return tpp->readImage (imageData, size);
+    });
 
     if (!succ && firstTrial) {
         _generateThumbnailImage ();
@@ -793,10 +797,18 @@ void Thumbnail::_loadThumbnail(bool firstTrial)
 
     if ( cfs.thumbImgType == CacheImageData::FULL_THUMBNAIL ) {
         // load aehistogram
-        tpp->readAEHistogram (getCacheFileName ("aehistograms", ""));
+        if (!cachemgr->readCacheData (cfs.md5, ThumbnailDB::AEHISTOGRAM, data)) {
+            data.clear ();
+        }
+
+        tpp->readAEHistogram (data);
 
         // load embedded profile
-        tpp->readEmbProfile (getCacheFileName ("embprofiles", ".icc"));
+        if (!cachemgr->readCacheData (cfs.md5, ThumbnailDB::EMBPROFILE, data)) {
+            data.clear ();
+        }
+
+        tpp->readEmbProfile (data);
 
         tpp->init ();
     }
@@ -835,24 +847,31 @@ void Thumbnail::_saveThumbnail ()
         return;
     }
 
-    if (g_remove (getCacheFileName ("images", ".rtti").c_str ()) != 0) {
-        // No file deleted, so we try to deleted obsolete files, if any
-        g_remove (getCacheFileName ("images", ".cust").c_str ());
-        g_remove (getCacheFileName ("images", ".cust16").c_str ());
-        g_remove (getCacheFileName ("images", ".jpg").c_str ());
-    }
+    std::string data;
 
     // save thumbnail image
-    tpp->writeImage (getCacheFileName ("images", ""), 1);
+    if (tpp->writeImage (data)) {
+        cachemgr->writeCacheData (cfs.md5, fname, ThumbnailDB::IMAGE, data);
+    }
 
     // save aehistogram
-    tpp->writeAEHistogram (getCacheFileName ("aehistograms", ""));
+    if (tpp->writeAEHistogram (data)) {
+        cachemgr->writeCacheData (cfs.md5, fname, ThumbnailDB::AEHISTOGRAM, data);
+    }
 
     // save embedded profile
-    tpp->writeEmbProfile (getCacheFileName ("embprofiles", ".icc"));
+    if (tpp->writeEmbProfile (data)) {
+        cachemgr->writeCacheData (cfs.md5, fname, ThumbnailDB::EMBPROFILE, data);
+    }
+
+    // save supplementary data, merged with the CacheImageData values
+    if (!cachemgr->readCacheData (cfs.md5, ThumbnailDB::DATA, data)) {
+        data.clear ();
+    }
 
-    // save supplementary data
-    tpp->writeData (getCacheFileName ("data", ".txt"));
+    if (tpp->writeData (data)) {
+        cachemgr->writeCacheData (cfs.md5, fname, ThumbnailDB::DATA, data);
+    }
 }
 
 /*
@@ -887,7 +906,7 @@ void Thumbnail::updateCache (bool updatePParams, bool updateCacheImageData)
     }
 
     if (updateCacheImageData) {
-        cfs.save (getCacheFileName ("data", ".txt"));
+        saveCacheImageData ();
     }
 }
 
@@ -905,11 +924,25 @@ Glib::ustring Thumbnail::getCacheFileName (const Glib::ustring& subdir, const Gl
     return cachemgr->getCacheFileName (subdir, fname, fext, cfs.md5);
 }
 
+// Merges the CacheImageData values into the data of the thumbnail database
+void Thumbnail::saveCacheImageData ()
+{
+    std::string data;
+
+    if (!cachemgr->readCacheData (cfs.md5, ThumbnailDB::DATA, data)) {
+        data.clear ();
+    }
+
+    if (cfs.save (data) == 0) {
+        cachemgr->writeCacheData (cfs.md5, fname, ThumbnailDB::DATA, data);
+    }
+}
+
 void Thumbnail::setFileName (const Glib::ustring &fn)
 {
 
     fname = fn;
-    cfs.md5 = cachemgr->getMD5 (fname);
+    cfs.md5 = cachemgr->getMD5 (fname, &cfs.fileStamp);
 }
 
 void Thumbnail::addThumbnailListener (ThumbnailListener* tnl)
@@ -0,0 +1,792 @@
+/*
+ *  This file is part of RawTherapee.
+ *
+ *  RawTherapee is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  RawTherapee is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "thumbnaildb.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <glib/gstdio.h>
+#include <giomm.h>
+
+#ifdef WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "options.h"
+
+namespace
+{
+
+// Both files start with a magic number and a generation number, the index is only valid for the data file of the same generation.
+// The magic of the data file changed when the images got deflated, so that the databases of uncompressed images are started anew
+constexpr char dataMagic[4] = { 'R', 'T', 'D', 'Z' };
+constexpr char indexMagic[4] = { 'R', 'T', 'D', 'I' };
+constexpr guint64 headerSize = sizeof (dataMagic) + sizeof (guint32);
+
+// Value of the blob field of an index record for a removed entry
+constexpr guint8 removedEntry = 0xff;
+
+// Holes smaller than this are never worth a compaction
+constexpr guint64 minCompactionSize = 16 * 1024 * 1024;
+
+bool readHeader (const Glib::ustring& fileName, const char (&magic)[4], guint32& generation)
+{
+    FILE* const f = g_fopen (fileName.c_str (), "rb");
+
+    if (!f) {
+        return false;
+    }
+
+    char fileMagic[4];
+    const bool valid = fread (fileMagic, sizeof (fileMagic), 1, f) == 1 && !memcmp (fileMagic, magic, sizeof (fileMagic))
+                       && fread (&generation, sizeof (generation), 1, f) == 1;
+    fclose (f);
+
+    return valid;
+}
+
+bool writeHeader (const Glib::ustring& fileName, const char (&magic)[4], guint32 generation)
+{
+    FILE* const f = g_fopen (fileName.c_str (), "wb");
+
+    if (!f) {
+        return false;
+    }
+
+    const bool valid = fwrite (magic, sizeof (magic), 1, f) == 1 && fwrite (&generation, sizeof (generation), 1, f) == 1;
+
+    return fclose (f) == 0 && valid;
+}
+
+guint64 getFileSize (const Glib::ustring& fileName)
+{
+    try {
+        return Gio::File::create_for_path (fileName)->query_info (G_FILE_ATTRIBUTE_STANDARD_SIZE)->get_size ();
+    } catch (Glib::Exception&) {
+        return 0;
+    }
+}
+
+template<typename T>
+bool readValue (FILE* f, T& value)
+{
+    return fread (&value, sizeof (T), 1, f) == 1;
+}
+
+template<typename T>
+bool writeValue (FILE* f, const T& value)
+{
+    return fwrite (&value, sizeof (T), 1, f) == 1;
+}
+
+}
+
+ThumbnailDB::ThumbnailDB () :
+    generation (0),
+    dataFile (nullptr),
+    indexFile (nullptr),
+    dataSize (0),
+    usedSize (0),
+    mappedData (nullptr),
+    lockFile (-1),
+    readOnly (false),
+    compacting (false)
+{
+}
+
+ThumbnailDB::~ThumbnailDB ()
+{
+    closeFiles ();
+    unlockFiles ();
+}
+
+bool ThumbnailDB::open (const Glib::ustring& dirName)
+{
+    MyMutex::MyLock lock (mutex);
+
+    closeFiles ();
+    unlockFiles ();
+
+    dataFileName = Glib::build_filename (dirName, "thumbnails.db");
+    indexFileName = Glib::build_filename (dirName, "thumbnails.idx");
+
+    // the offsets of the blobs appended by two processes would collide
+    readOnly = !lockFiles ();
+
+    if (readOnly && options.rtSettings.verbose) {
+        std::cerr << "The thumbnail database is used by another instance, it is opened read only" << std::endl;
+    }
+
+    return openFiles () && loadIndex ();
+}
+
+void ThumbnailDB::close ()
+{
+    MyMutex::MyLock lock (mutex);
+
+    closeFiles ();
+    unlockFiles ();
+    entries.clear ();
+}
+
+bool ThumbnailDB::lockFiles ()
+{
+    const Glib::ustring lockFileName = Glib::build_filename (Glib::path_get_dirname (dataFileName), "thumbnails.lock");
+
+    lockFile = g_open (lockFileName.c_str (), O_RDWR | O_CREAT, 0644);
+
+    if (lockFile < 0) {
+        return false;
+    }
+
+    // advisory lock, released by the system if the process dies
+#ifdef WIN32
+    OVERLAPPED overlapped = {};
+    const bool locked = LockFileEx (reinterpret_cast<HANDLE> (_get_osfhandle (lockFile)), LOCKFILE_EXCLUSIVE_LOCK | LOCKFILE_FAIL_IMMEDIATELY, 0, 1, 0, &overlapped);
+#else
+    const bool locked = lockf (lockFile, F_TLOCK, 0) == 0;
+#endif
+
+    if (!locked) {
+        unlockFiles ();
+    }
+
+    return locked;
+}
+
+void ThumbnailDB::unlockFiles ()
+{
+    if (lockFile >= 0) {
+#ifdef WIN32
+        _close (lockFile);
+#else
+        ::close (lockFile);
+#endif
+        lockFile = -1;
+    }
+}
+
+bool ThumbnailDB::openFiles ()
+{
+    guint32 dataGeneration, indexGeneration;
+
+    if (!readHeader (dataFileName, dataMagic, dataGeneration) || !readHeader (indexFileName, indexMagic, indexGeneration) || dataGeneration != indexGeneration) {
+        if (readOnly) {
+            return false;
+        }
+
+        // missing or unmatched files: start a new database
+        generation = g_random_int ();
+
+        if (!writeHeader (dataFileName, dataMagic, generation) || !writeHeader (indexFileName, indexMagic, generation)) {
+            if (options.rtSettings.verbose) {
+                std::cerr << "Failed to create the thumbnail database in '" << Glib::path_get_dirname (dataFileName) << "': " << g_strerror (errno) << std::endl;
+            }
+
+            return false;
+        }
+    } else {
+        generation = dataGeneration;
+    }
+
+    if (!readOnly) {
+        dataFile = g_fopen (dataFileName.c_str (), "ab");
+        indexFile = g_fopen (indexFileName.c_str (), "ab");
+
+        if (!dataFile || !indexFile) {
+            closeFiles ();
+            return false;
+        }
+    }
+
+    dataSize = getFileSize (dataFileName);
+
+    return dataSize >= headerSize;
+}
+
+void ThumbnailDB::closeFiles ()
+{
+    if (mappedData) {
+        g_mapped_file_unref (mappedData);
+        mappedData = nullptr;
+    }
+
+    if (dataFile) {
+        fclose (dataFile);
+        dataFile = nullptr;
+    }
+
+    if (indexFile) {
+        fclose (indexFile);
+        indexFile = nullptr;
+    }
+
+    dataSize = usedSize = 0;
+}
+
+bool ThumbnailDB::loadIndex ()
+{
+    entries.clear ();
+    usedSize = 0;
+
+    FILE* const f = g_fopen (indexFileName.c_str (), "rb");
+
+    if (!f || fseek (f, headerSize, SEEK_SET) != 0) {
+        if (f) {
+            fclose (f);
+        }
+
+        return false;
+    }
+
+    // replay the journal; a truncated last record is the trace of an interrupted write and is ignored
+    while (true) {
+        char md5[32];
+        guint8 blob, present;
+        Location location;
+        gint64 time;
+        guint32 nameLength;
+
+        if (fread (md5, sizeof (md5), 1, f) != 1 || !readValue (f, blob) || !readValue (f, present)
+                || !readValue (f, location.offset) || !readValue (f, location.size) || !readValue (f, time) || !readValue (f, nameLength)) {
+            break;
+        }
+
+        std::string name (nameLength, '\0');
+
+        if (nameLength > 0 && fread (&name[0], nameLength, 1, f) != 1) {
+            break;
+        }
+
+        const std::string key (md5, sizeof (md5));
+
+        if (blob == removedEntry) {
+            entries.erase (key);
+            continue;
+        }
+
+        if (blob >= BLOB_COUNT) {
+            break;
+        }
+
+        location.present = present && location.offset >= headerSize && location.offset + location.size <= dataSize;
+
+        Entry& entry = entries[key];
+        entry.fname = name;
+        entry.time = time;
+        entry.blobs[blob] = location;
+    }
+
+    fclose (f);
+
+    for (auto entry = entries.begin (); entry != entries.end ();) {
+        bool empty = true;
+
+        for (const auto& location : entry->second.blobs) {
+            if (location.present) {
+                usedSize += location.size;
+                empty = false;
+            }
+        }
+
+        if (empty) {
+            entry = entries.erase (entry);
+        } else {
+            ++entry;
+        }
+    }
+
+    return true;
+}
+
+bool ThumbnailDB::mapData (guint64 size)
+{
+    if (mappedData && g_mapped_file_get_length (mappedData) >= size) {
+        return true;
+    }
+
+    // the data file has grown since it was mapped
+    if (mappedData) {
+        g_mapped_file_unref (mappedData);
+    }
+
+    GError* error = nullptr;
+    mappedData = g_mapped_file_new (dataFileName.c_str (), FALSE, &error);
+
+    if (!mappedData) {
+        if (options.rtSettings.verbose) {
+            std::cerr << "Failed to map the thumbnail database: " << error->message << std::endl;
+        }
+
+        g_error_free (error);
+        return false;
+    }
+
+    // a read only database may have been compacted by the process updating it, the offsets of the index are then wrong
+    const char* const data = g_mapped_file_get_contents (mappedData);
+    guint32 mappedGeneration = 0;
+
+    if (g_mapped_file_get_length (mappedData) >= headerSize && !memcmp (data, dataMagic, sizeof (dataMagic))) {
+        memcpy (&mappedGeneration, data + sizeof (dataMagic), sizeof (mappedGeneration));
+    }
+
+    if (mappedGeneration != generation) {
+        g_mapped_file_unref (mappedData);
+        mappedData = nullptr;
+        return false;
+    }
+
+    return g_mapped_file_get_length (mappedData) >= size;
+}
+
+bool ThumbnailDB::appendIndex (FILE* f, const std::string& md5, const Entry& entry, int blob)
+{
+    if (!f) {
+        return false;
+    }
+
+    const std::string name = entry.fname;
+    const Location location = blob < BLOB_COUNT ? entry.blobs[blob] : Location {0, 0, false};
+    const guint8 present = location.present;
+    const guint32 nameLength = name.size ();
+
+    bool success = fwrite (md5.data (), 32, 1, f) == 1;
+    success = success && writeValue (f, static_cast<guint8> (blob < BLOB_COUNT ? blob : removedEntry)) && writeValue (f, present);
+    success = success && writeValue (f, location.offset) && writeValue (f, location.size) && writeValue (f, entry.time);
+    success = success && writeValue (f, nameLength) && (nameLength == 0 || fwrite (name.data (), nameLength, 1, f) == 1);
+    success = success && fflush (f) == 0;
+
+    if (!success && options.rtSettings.verbose) {
+        std::cerr << "Failed to update the thumbnail database index: " << g_strerror (errno) << std::endl;
+    }
+
+    return success;
+}
+
+bool ThumbnailDB::read (const std::string& md5, Blob blob, std::string& data)
+{
+    return read (md5, blob, [&data] (const char* blobData, std::size_t size) {
+        data.assign (blobData, size);
+        return true;
+    });
+}
+
+bool ThumbnailDB::read (const std::string& md5, Blob blob, const std::function<bool (const char*, std::size_t)>& reader)
+{
+    GMappedFile* mapping;
+    const char* blobData;
+    std::size_t size;
+
+    {
+        MyMutex::MyLock lock (mutex);
+
+        const auto entry = entries.find (md5);
+
+        if (entry == entries.end () || !entry->second.blobs[blob].present) {
+            return false;
+        }
+
+        const Location& location = entry->second.blobs[blob];
+
+        if (!mapData (location.offset + location.size)) {
+            return false;
+        }
+
+        // the mapping is replaced when the data file grows or is compacted, this reference keeps the current one
+        // alive so that the blob can be read without the lock
+        mapping = g_mapped_file_ref (mappedData);
+        blobData = g_mapped_file_get_contents (mapping) + location.offset;
+        size = location.size;
+    }
+
+    const bool success = reader (blobData, size);
+    g_mapped_file_unref (mapping);
+
+    return success;
+}
+
+bool ThumbnailDB::write (const std::string& md5, const Glib::ustring& fname, Blob blob, const std::string& data)
+{
+    MyMutex::MyLock lock (mutex);
+
+    if (!dataFile || md5.size () != 32) {
+        return false;
+    }
+
+    const guint64 offset = dataSize;
+    const std::size_t written = data.empty () ? 0 : fwrite (data.data (), 1, data.size (), dataFile);
+    const bool success = fflush (dataFile) == 0 && written == data.size ();
+
+    // even a partial write moves the end of the file
+    dataSize += written;
+
+    if (!success) {
+        if (options.rtSettings.verbose) {
+            std::cerr << "Failed to write to the thumbnail database: " << g_strerror (errno) << std::endl;
+        }
+
+        return false;
+    }
+
+    Entry& entry = entries[md5];
+    Location& location = entry.blobs[blob];
+
+    if (location.present) {
+        usedSize -= location.size;
+    }
+
+    entry.fname = fname;
+    entry.time = g_get_real_time () / G_USEC_PER_SEC;
+    location = {offset, static_cast<guint32> (data.size ()), true};
+    usedSize += location.size;
+
+    appendIndex (indexFile, md5, entry, blob);
+    return true;
+}
+
+void ThumbnailDB::removeEntry (Entries::iterator entry, bool purgeData)
+{
+    bool empty = true;
+
+    for (int blob = 0; blob < BLOB_COUNT; blob++) {
+        Location& location = entry->second.blobs[blob];
+
+        if (blob == DATA && !purgeData) {
+            empty = empty && !location.present;
+        } else if (location.present) {
+            usedSize -= location.size;
+            location.present = false;
+
+            if (purgeData) {
+                continue;
+            }
+
+            appendIndex (indexFile, entry->first, entry->second, blob);
+        }
+    }
+
+    if (purgeData) {
+        appendIndex (indexFile, entry->first, entry->second, removedEntry);
+    }
+
+    if (empty) {
+        entries.erase (entry);
+    }
+}
+
+void ThumbnailDB::remove (const std::string& md5, bool purgeData)
+{
+    MyMutex::MyLock lock (mutex);
+
+    const auto entry = entries.find (md5);
+
+    if (entry != entries.end ()) {
+        removeEntry (entry, purgeData);
+    }
+}
+
+void ThumbnailDB::rename (const std::string& oldMd5, const std::string& newMd5, const Glib::ustring& newFName)
+{
+    MyMutex::MyLock lock (mutex);
+
+    const auto oldEntry = entries.find (oldMd5);
+
+    if (oldEntry == entries.end () || oldMd5 == newMd5 || newMd5.size () != 32) {
+        return;
+    }
+
+    // the blobs don't move, only the new key is recorded
+    Entry& entry = entries[newMd5];
+
+    for (const auto& location : entry.blobs) {
+        if (location.present) {
+            usedSize -= location.size;
+        }
+    }
+
+    entry = oldEntry->second;
+    entry.fname = newFName;
+
+    for (int blob = 0; blob < BLOB_COUNT; blob++) {
+        if (entry.blobs[blob].present) {
+            usedSize += entry.blobs[blob].size;
+            appendIndex (indexFile, newMd5, entry, blob);
+        }
+    }
+
+    removeEntry (oldEntry, true);
+}
+
+void ThumbnailDB::clear (bool purgeData)
+{
+    MyMutex::MyLock lock (mutex);
+
+    if (purgeData && readOnly) {
+        // the files belong to the process updating the database
+        entries.clear ();
+        return;
+    }
+
+    if (purgeData) {
+        // start a new, empty database
+        closeFiles ();
+        entries.clear ();
+        g_remove (dataFileName.c_str ());
+        g_remove (indexFileName.c_str ());
+        if (!openFiles () || !loadIndex ()) {
+            closeFiles ();
+        }
+
+        return;
+    }
+
+    for (auto entry = entries.begin (); entry != entries.end ();) {
+        const auto next = std::next (entry);
+        removeEntry (entry, false);
+        entry = next;
+    }
+}
+
+void ThumbnailDB::prefetch (const Glib::ustring& dirName)
+{
+#ifndef WIN32
+    MyMutex::MyLock lock (mutex);
+
+    std::vector<std::pair<guint64, guint64>> ranges;
+
+    for (const auto& entry : entries) {
+        if (Glib::path_get_dirname (entry.second.fname) != dirName) {
+            continue;
+        }
+
+        for (const auto& location : entry.second.blobs) {
+            if (location.present) {
+                ranges.emplace_back (location.offset, location.offset + location.size);
+            }
+        }
+    }
+
+    if (ranges.empty () || !mapData (dataSize)) {
+        return;
+    }
+
+    std::sort (ranges.begin (), ranges.end ());
+
+    // merge the neighbouring ranges, so that a directory imported at once takes a few calls
+    const guint64 pageSize = sysconf (_SC_PAGESIZE);
+    char* const data = g_mapped_file_get_contents (mappedData);
+    const guint64 mappedSize = g_mapped_file_get_length (mappedData);
+
+    for (std::size_t i = 0; i < ranges.size ();) {
+        const guint64 begin = ranges[i].first / pageSize * pageSize;
+        guint64 end = ranges[i].second;
+
+        for (++i; i < ranges.size () && ranges[i].first <= end + pageSize; ++i) {
+            end = std::max (end, ranges[i].second);
+        }
+
+        posix_madvise (data + begin, std::min (end, mappedSize) - begin, POSIX_MADV_WILLNEED);
+    }
+
+#endif
+}
+
+void ThumbnailDB::limitSize (std::size_t maxEntries)
+{
+    MyMutex::MyLock lock (mutex);
+
+    if (entries.size () <= maxEntries) {
+        return;
+    }
+
+    std::vector<std::pair<gint64, std::string>> times;
+    times.reserve (entries.size ());
+
+    for (const auto& entry : entries) {
+        times.emplace_back (entry.second.time, entry.first);
+    }
+
+    std::sort (times.begin (), times.end ());
+
+    for (std::size_t i = 0; i < times.size () - maxEntries; i++) {
+        removeEntry (entries.find (times[i].second), true);
+    }
+}
+
+bool ThumbnailDB::compact (bool force)
+{
+    // The blobs are copied from a reference on the current mapping without the lock, which is only taken back to copy
+    // the blobs written meanwhile, write the new index and replace the files
+    GMappedFile* mapping;
+    std::vector<Location> blobs;
+    Glib::ustring curDataFileName;
+    guint32 curGeneration;
+
+    {
+        MyMutex::MyLock lock (mutex);
+
+        if (!dataFile || compacting) {
+            return false;
+        }
+
+        const guint64 holesSize = dataSize - headerSize - usedSize;
+
+        if (!force && (holesSize < minCompactionSize || holesSize < usedSize)) {
+            return false;
+        }
+
+        if (!mapData (dataSize)) {
+            return false;
+        }
+
+        for (const auto& entry : entries) {
+            for (const auto& location : entry.second.blobs) {
+                if (location.present) {
+                    blobs.push_back (location);
+                }
+            }
+        }
+
+        mapping = g_mapped_file_ref (mappedData);
+        curDataFileName = dataFileName;
+        curGeneration = generation;
+        compacting = true;
+    }
+
+    const Glib::ustring newDataFileName = curDataFileName + ".tmp";
+    const guint32 newGeneration = curGeneration + 1;
+
+    // copy the blobs in their current order, which keeps the ones of a directory together
+    std::sort (blobs.begin (), blobs.end (), [] (const Location& lhs, const Location& rhs) {
+        return lhs.offset < rhs.offset;
+    });
+
+    // new offset of each blob, by its old one. An empty blob may share its offset with the next one, so only the
+    // blobs holding data are in there, the empty ones point at the end of the header
+    std::map<guint64, guint64> newOffsets;
+    guint64 offset = headerSize;
+
+    FILE* newDataFile = nullptr;
+    bool success = writeHeader (newDataFileName, dataMagic, newGeneration) && (newDataFile = g_fopen (newDataFileName.c_str (), "ab"));
+
+    const char* data = g_mapped_file_get_contents (mapping);
+
+    for (auto blob = blobs.cbegin (); success && blob != blobs.cend (); ++blob) {
+        if (blob->size > 0) {
+            success = fwrite (data + blob->offset, blob->size, 1, newDataFile) == 1;
+            newOffsets.emplace (blob->offset, offset);
+            offset += blob->size;
+        }
+    }
+
+    g_mapped_file_unref (mapping);
+
+    MyMutex::MyLock lock (mutex);
+
+    compacting = false;
+
+    // the database may have been cleared or closed meanwhile
+    const bool replaced = !dataFile || generation != curGeneration || dataFileName != curDataFileName;
+    success = success && !replaced;
+
+    if (success && !mapData (dataSize)) {
+        success = false;
+    }
+
+    // the blobs written meanwhile
+    if (success) {
+        data = g_mapped_file_get_contents (mappedData);
+
+        for (auto entry = entries.cbegin (); success && entry != entries.cend (); ++entry) {
+            for (const auto& location : entry->second.blobs) {
+                if (location.present && location.size > 0 && newOffsets.find (location.offset) == newOffsets.end ()) {
+                    success = fwrite (data + location.offset, location.size, 1, newDataFile) == 1;
+                    newOffsets.emplace (location.offset, offset);
+                    offset += location.size;
+                }
+            }
+        }
+    }
+
+    if (newDataFile) {
+        success = fclose (newDataFile) == 0 && success;
+    }
+
+    const Glib::ustring newIndexFileName = indexFileName + ".tmp";
+
+    if (success) {
+        success = writeHeader (newIndexFileName, indexMagic, newGeneration);
+
+        FILE* const newIndexFile = success ? g_fopen (newIndexFileName.c_str (), "ab") : nullptr;
+        success = newIndexFile;
+
+        for (auto entry = entries.cbegin (); success && entry != entries.cend (); ++entry) {
+            Entry newEntry = entry->second;
+
+            for (int blob = 0; success && blob < BLOB_COUNT; blob++) {
+                Location& location = newEntry.blobs[blob];
+
+                if (location.present) {
+                    location.offset = location.size > 0 ? newOffsets[location.offset] : headerSize;
+                    success = appendIndex (newIndexFile, entry->first, newEntry, blob);
+                }
+            }
+        }
+
+        if (newIndexFile) {
+            success = fclose (newIndexFile) == 0 && success;
+        }
+    }
+
+    if (!success) {
+        g_remove (newDataFileName.c_str ());
+        g_remove (newIndexFileName.c_str ());
+
+        if (!replaced && options.rtSettings.verbose) {
+            std::cerr << "Failed to compact the thumbnail database: " << g_strerror (errno) << std::endl;
+        }
+
+        return false;
+    }
+
+    // the mapping has to be released before replacing the files on Windows, where a reader still holding it
+    // makes the removal fail: the current database is then kept.
+    // If we are interrupted between the renames, the generations don't match and the database starts empty
+    closeFiles ();
+
+    if (g_remove (dataFileName.c_str ()) != 0) {
+        g_remove (newDataFileName.c_str ());
+        g_remove (newIndexFileName.c_str ());
+    } else {
+        g_remove (indexFileName.c_str ());
+        g_rename (newDataFileName.c_str (), dataFileName.c_str ());
+        g_rename (newIndexFileName.c_str (), indexFileName.c_str ());
+    }
+
+    return openFiles () && loadIndex ();
+}
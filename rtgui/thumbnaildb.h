@@ -0,0 +1,119 @@
+/*
+ *  This file is part of RawTherapee.
+ *
+ *  RawTherapee is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  RawTherapee is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with RawTherapee.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _THUMBNAILDB_
+#define _THUMBNAILDB_
+
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <string>
+
+#include <glib.h>
+#include <glibmm/ustring.h>
+
+#include "../rtengine/noncopyable.h"
+
+#include "threadutils.h"
+
+/**
+ * @brief Packed storage of the thumbnail cache
+ *
+ * All the cached blobs of all the images (thumbnail image, data, auto exposure histogram and embedded profile)
+ * are appended to a single data file, which is memory mapped for reading. The location of each blob is recorded
+ * in an index file, which is a journal replayed when the database is opened. Overwritten and removed blobs
+ * leave holes in the data file, which are reclaimed by compact().
+ *
+ * The entries are identified by the MD5 of CacheManager::getMD5. All the methods are thread safe. Only one process
+ * at a time can update a database: the other ones open it read only.
+ */
+class ThumbnailDB :
+    public rtengine::NonCopyable
+{
+public:
+    enum Blob {
+        IMAGE,
+        DATA,
+        AEHISTOGRAM,
+        EMBPROFILE,
+        BLOB_COUNT
+    };
+
+    ThumbnailDB ();
+    ~ThumbnailDB ();
+
+    bool open  (const Glib::ustring& dirName);
+    void close ();
+
+    bool read   (const std::string& md5, Blob blob, std::string& data);
+    // Hands the blob to reader where it lies in the mapped data file, without copying it nor locking the database
+    bool read   (const std::string& md5, Blob blob, const std::function<bool (const char*, std::size_t)>& reader);
+    bool write  (const std::string& md5, const Glib::ustring& fname, Blob blob, const std::string& data);
+    // removes the image, histogram and profile of the entry, and the data too if purgeData is true
+    void remove (const std::string& md5, bool purgeData);
+    void rename (const std::string& oldMd5, const std::string& newMd5, const Glib::ustring& newFName);
+    void clear  (bool purgeData);
+
+    // Tells the system that the blobs of the images of this directory are about to be read
+    void prefetch   (const Glib::ustring& dirName);
+    // Removes the least recently written entries above maxEntries
+    void limitSize  (std::size_t maxEntries);
+    // Rewrites the data file without its holes, if they take more than half of it or if force is true.
+    // The blobs are copied without locking the database
+    bool compact    (bool force);
+
+private:
+    struct Location {
+        guint64 offset;
+        guint32 size;
+        bool    present;
+    };
+
+    struct Entry {
+        Glib::ustring fname;
+        gint64        time;
+        Location      blobs[BLOB_COUNT];
+    };
+
+    using Entries = std::map<std::string, Entry>;
+
+    Glib::ustring dataFileName;
+    Glib::ustring indexFileName;
+    guint32       generation;
+
+    FILE*         dataFile;
+    FILE*         indexFile;
+    guint64       dataSize;
+    guint64       usedSize;
+    GMappedFile*  mappedData;
+    int           lockFile;   // descriptor of the lock file held by the process updating the database, or -1
+    bool          readOnly;
+    bool          compacting;
+
+    Entries       entries;
+    MyMutex       mutex;
+
+    bool lockFiles   ();
+    void unlockFiles ();
+    bool openFiles   ();
+    void closeFiles  ();
+    bool loadIndex   ();
+    bool mapData     (guint64 size);
+    bool appendIndex (FILE* f, const std::string& md5, const Entry& entry, int blob);
+    void removeEntry (Entries::iterator entry, bool purgeData);
+};
+
+#endif